@@ -0,0 +1,45 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <zmqpp/zmqpp.hpp>
+#include <zmqpp/capture_journal.hpp>
+#include <cstdlib>
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+// Replays the frontend to backend traffic of a journal recorded from a proxy's
+// capture, as a client of the proxy would have sent it.
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " <journal directory> <endpoint> [speed]" << endl;
+    cerr << "  speed 1 replays at the recorded pace, 2 twice as fast, 0 as fast as possible" << endl;
+    return 1;
+  }
+
+  const string directory = argv[1];
+  const string endpoint = argv[2];
+  const double speed = (argc > 3) ? atof(argv[3]) : 1.0;
+
+  zmqpp::context context;
+  zmqpp::socket socket (context, zmqpp::socket_type::dealer);
+
+  cout << "Opening connection to " << endpoint << "..." << endl;
+  socket.connect(endpoint);
+
+  zmqpp::journal_reader reader(directory);
+  cout << "Replaying " << directory << "..." << endl;
+
+  // backend to frontend traffic has no target, so it is skipped
+  const uint64_t sent = reader.replay(socket, nullptr, speed);
+
+  cout << "Sent " << sent << " messages." << endl;
+  cout << "Finished." << endl;
+}
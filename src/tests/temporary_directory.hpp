@@ -0,0 +1,53 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <string>
+
+#ifndef _WIN32
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// a fresh directory under /tmp, removed with the files in it when done
+struct temporary_directory
+{
+    std::string path;
+
+    explicit temporary_directory(std::string const& prefix)
+    {
+        std::string name = "/tmp/" + prefix + "-XXXXXX";
+        BOOST_REQUIRE(nullptr != mkdtemp(&name[0]));
+        path = name;
+    }
+
+    ~temporary_directory()
+    {
+        if (DIR* dir = opendir(path.c_str()))
+        {
+            while (dirent* entry = readdir(dir))
+                unlink((path + "/" + entry->d_name).c_str());
+            closedir(dir);
+        }
+        rmdir(path.c_str());
+    }
+
+    std::string write(std::string const& name, std::string const& content) const
+    {
+        std::string const file = path + "/" + name;
+        std::ofstream(file.c_str()) << content;
+        return file;
+    }
+};
+
+#endif
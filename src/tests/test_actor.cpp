@@ -14,6 +14,7 @@
 #include "zmqpp/context.hpp"
 #include "zmqpp/message.hpp"
 #include "zmqpp/actor.hpp"
+#include "zmqpp/actor_executor.hpp"
 #include "zmqpp/poller.hpp"
 #include <iostream>
 
@@ -258,4 +259,111 @@ BOOST_AUTO_TEST_CASE(test_sending_command)
     BOOST_CHECK_EQUAL(10, c);
 }
 
+BOOST_AUTO_TEST_CASE(actors_on_executor)
+{
+    zmqpp::actor_executor executor(2);
+
+    // more actors than workers over time, two at once
+    for (int i = 0; i < 20; i++)
+    {
+        auto lambda = [i](zmqpp::socket * pipe)
+        {
+            pipe->send(zmqpp::signal::ok);
+            zmqpp::message msg;
+            msg << i;
+            pipe->send(msg);
+            return true;
+        };
+        zmqpp::actor first(executor, lambda);
+        zmqpp::actor second(executor, lambda);
+
+        int a, b;
+        zmqpp::message msg;
+        first.pipe()->receive(msg);
+        msg >> a;
+        second.pipe()->receive(msg);
+        msg >> b;
+        BOOST_CHECK_EQUAL(i, a);
+        BOOST_CHECK_EQUAL(i, b);
+        BOOST_CHECK(first.stop(true));
+        BOOST_CHECK(second.stop(true));
+    }
+
+    zmqpp::context application_context;
+    BOOST_CHECK_THROW(zmqpp::actor actor(executor, std::bind(&count_echo_server, std::placeholders::_1,
+            &application_context, "InvalidEndpointForRouter")),
+            zmqpp::actor_initialization_exception);
+}
+
+BOOST_AUTO_TEST_CASE(actors_beyond_executor_workers)
+{
+    zmqpp::actor_executor executor(2);
+    auto until_stopped = [](zmqpp::socket * pipe)
+    {
+        pipe->send(zmqpp::signal::ok);
+        pipe->wait();
+        return true;
+    };
+
+    // an actor started from a pooled actor is refused rather than left waiting
+    auto spawner = [&executor, &until_stopped](zmqpp::socket * pipe)
+    {
+        pipe->send(zmqpp::signal::ok);
+        bool refused = false;
+        try
+        {
+            zmqpp::actor nested(executor, until_stopped);
+        }
+        catch (zmqpp::exception const&)
+        {
+            refused = true;
+        }
+        zmqpp::message msg;
+        msg << refused;
+        pipe->send(msg);
+        pipe->wait();
+        return true;
+    };
+
+    {
+        zmqpp::actor first(executor, spawner);
+        bool refused = false;
+        zmqpp::message msg;
+        first.pipe()->receive(msg);
+        msg >> refused;
+        BOOST_CHECK(refused);
+
+        // once every worker is held, another actor is refused too
+        zmqpp::actor second(executor, until_stopped);
+        BOOST_CHECK_THROW(zmqpp::actor third(executor, until_stopped), zmqpp::exception);
+        BOOST_CHECK(second.stop(true));
+
+        // and a stopped one gives its worker back
+        zmqpp::actor fourth(executor, until_stopped);
+        BOOST_CHECK(fourth.stop(true));
+        BOOST_CHECK(first.stop(true));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(actors_on_reserved_pipes)
+{
+    zmqpp::actor::reserve_pipes(4);
+
+    // uses up the spare pipes then goes back to creating them
+    for (int i = 0; i < 8; i++)
+    {
+        zmqpp::actor actor([](zmqpp::socket * pipe)
+        {
+            pipe->send(zmqpp::signal::ok);
+            pipe->send("ready");
+            return true;
+        });
+
+        std::string str;
+        actor.pipe()->receive(str);
+        BOOST_CHECK_EQUAL("ready", str);
+        BOOST_CHECK(actor.stop(true));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,111 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "zmqpp/actor_executor.hpp"
+#include "zmqpp/exception.hpp"
+
+BOOST_AUTO_TEST_SUITE( actor_executor )
+
+BOOST_AUTO_TEST_CASE(runs_every_task_before_destruction)
+{
+    std::atomic<size_t> ran(0);
+    {
+        zmqpp::actor_executor executor(4);
+        BOOST_CHECK_EQUAL(4, executor.size());
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            executor.submit([&ran]() { ++ran; });
+        }
+    }
+    BOOST_CHECK_EQUAL(1000, ran.load());
+
+    BOOST_CHECK_THROW(zmqpp::actor_executor executor(0), zmqpp::exception);
+
+    // one per core, at least one when the count isn't known
+    zmqpp::actor_executor sized;
+    BOOST_CHECK_EQUAL(std::max(1u, std::thread::hardware_concurrency()), sized.size());
+}
+
+BOOST_AUTO_TEST_CASE(workers_are_claimed_up_to_the_pool_size)
+{
+    zmqpp::actor_executor executor(2);
+    BOOST_CHECK(!executor.on_worker());
+
+    BOOST_CHECK(executor.claim());
+    BOOST_CHECK(executor.claim());
+    BOOST_CHECK(!executor.claim());
+    executor.release();
+    BOOST_CHECK(executor.claim());
+    executor.release();
+    executor.release();
+
+    std::atomic<bool> on_worker(false);
+    std::atomic<bool> done(false);
+    executor.submit([&]() {
+        on_worker = executor.on_worker();
+        done = true;
+    });
+    while (!done)
+        std::this_thread::yield();
+    BOOST_CHECK(on_worker);
+}
+
+BOOST_AUTO_TEST_CASE(idle_workers_steal_blocked_work)
+{
+    zmqpp::actor_executor executor(2);
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool child_ran = false;
+
+    // the child lands on the parent's own queue, only another worker can run it
+    executor.submit([&]() {
+        executor.submit([&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            child_ran = true;
+            changed.notify_all();
+        });
+
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait_for(lock, std::chrono::seconds(5), [&]() { return child_ran; });
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    BOOST_CHECK(changed.wait_for(lock, std::chrono::seconds(5), [&]() { return child_ran; }));
+}
+
+BOOST_AUTO_TEST_CASE(tasks_share_workers)
+{
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    {
+        zmqpp::actor_executor executor(2);
+        for (size_t i = 0; i < 100; ++i)
+        {
+            executor.submit([&]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                threads.insert(std::this_thread::get_id());
+            });
+        }
+    }
+    BOOST_CHECK(threads.size() <= 2);
+    BOOST_CHECK(threads.count(std::this_thread::get_id()) == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "zmqpp/actor.hpp"
+#include "zmqpp/actor_mailbox.hpp"
+#include "zmqpp/poller.hpp"
+
+#ifndef _WIN32
+
+#include <signal.h>
+#include <sys/time.h>
+
+namespace
+{
+    void ignore_signal(int) { }
+}
+
+BOOST_AUTO_TEST_SUITE( actor_mailbox )
+
+BOOST_AUTO_TEST_CASE(moves_values_between_threads)
+{
+    zmqpp::actor_mailbox<std::unique_ptr<size_t>> mailbox;
+
+    std::vector<std::thread> senders;
+    for (size_t sender = 0; sender < 4; ++sender)
+    {
+        senders.emplace_back([&mailbox]() {
+            for (size_t i = 1; i <= 1000; ++i)
+            {
+                std::unique_ptr<size_t> value(new size_t(i));
+                while (!mailbox.send(value))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    size_t total = 0;
+    std::unique_ptr<size_t> value;
+    for (size_t received = 0; received < 4000; ++received)
+    {
+        BOOST_REQUIRE(mailbox.receive(value, 5000));
+        total += *value;
+    }
+
+    for (std::thread& sender : senders)
+        sender.join();
+
+    BOOST_CHECK_EQUAL(4 * 500500, total);
+    BOOST_CHECK(!mailbox.try_receive(value));
+    BOOST_CHECK(!mailbox.receive(value, 0));
+}
+
+BOOST_AUTO_TEST_CASE(full_mailbox_refuses_values)
+{
+    zmqpp::actor_mailbox<std::unique_ptr<int>> mailbox(3);
+    BOOST_REQUIRE_EQUAL(4, mailbox.capacity());
+
+    for (int i = 0; i < 4; ++i)
+        BOOST_CHECK(mailbox.send(std::unique_ptr<int>(new int(i))));
+
+    // the sender keeps what didn't fit
+    std::unique_ptr<int> refused(new int(4));
+    BOOST_CHECK(!mailbox.send(refused));
+    BOOST_REQUIRE(refused);
+    BOOST_CHECK_EQUAL(4, *refused);
+
+    std::unique_ptr<int> value;
+    BOOST_REQUIRE(mailbox.try_receive(value));
+    BOOST_CHECK_EQUAL(0, *value);
+    BOOST_CHECK(mailbox.send(refused));
+    BOOST_CHECK(!refused);
+
+    for (int i = 1; i <= 4; ++i)
+    {
+        BOOST_REQUIRE(mailbox.try_receive(value));
+        BOOST_CHECK_EQUAL(i, *value);
+    }
+    BOOST_CHECK(!mailbox.try_receive(value));
+
+    // values still waiting are destroyed with the mailbox
+    mailbox.send(std::unique_ptr<int>(new int(5)));
+}
+
+BOOST_AUTO_TEST_CASE(pollable_descriptor)
+{
+    zmqpp::actor_mailbox<int> mailbox;
+    zmqpp::poller poller;
+    poller.add(mailbox.fd());
+
+    BOOST_CHECK(!poller.poll(0));
+
+    mailbox.send(1);
+    mailbox.send(2);
+    BOOST_REQUIRE(poller.poll(0));
+    BOOST_CHECK(poller.has_input(mailbox.fd()));
+
+    // stays readable until the receiver finds the mailbox empty
+    int value = 0;
+    BOOST_CHECK(mailbox.try_receive(value));
+    BOOST_CHECK_EQUAL(1, value);
+    BOOST_CHECK(poller.poll(0));
+    BOOST_CHECK(mailbox.try_receive(value));
+    BOOST_CHECK_EQUAL(2, value);
+    BOOST_CHECK(!mailbox.try_receive(value));
+    BOOST_CHECK(!poller.poll(0));
+}
+
+BOOST_AUTO_TEST_CASE(actor_replies_through_mailbox)
+{
+    zmqpp::actor_mailbox<std::vector<int>> mailbox;
+
+    zmqpp::actor actor([&mailbox](zmqpp::socket * pipe)
+    {
+        pipe->send(zmqpp::signal::ok);
+        mailbox.send(std::vector<int>(1000, 7));
+        pipe->wait();
+        return true;
+    });
+
+    std::vector<int> values;
+    BOOST_REQUIRE(mailbox.receive(values, 5000));
+    BOOST_CHECK_EQUAL(1000, values.size());
+    BOOST_CHECK_EQUAL(7, values.back());
+    BOOST_CHECK(actor.stop(true));
+}
+
+BOOST_AUTO_TEST_CASE(timeout_outlasts_interruptions)
+{
+    zmqpp::actor_mailbox<int> mailbox;
+
+    // interrupt the wait every 20ms, without restarting it
+    struct sigaction action = {};
+    action.sa_handler = ignore_signal;
+    struct sigaction previous;
+    BOOST_REQUIRE_EQUAL(0, sigaction(SIGALRM, &action, &previous));
+    struct itimerval interval = { { 0, 20000 }, { 0, 20000 } };
+    BOOST_REQUIRE_EQUAL(0, setitimer(ITIMER_REAL, &interval, nullptr));
+
+    auto const start = std::chrono::steady_clock::now();
+    int value = 0;
+    bool const received = mailbox.receive(value, 100);
+    auto const waited = std::chrono::steady_clock::now() - start;
+
+    struct itimerval stop = {};
+    setitimer(ITIMER_REAL, &stop, nullptr);
+    sigaction(SIGALRM, &previous, nullptr);
+
+    BOOST_CHECK(!received);
+    BOOST_CHECK(waited >= std::chrono::milliseconds(100));
+    BOOST_CHECK(waited < std::chrono::seconds(5));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -9,6 +9,7 @@
 
 
 #include <boost/test/unit_test.hpp>
+#include <chrono>
 #include <thread>
 
 #include "zmqpp/context.hpp"
@@ -18,8 +19,12 @@
 #include "zmqpp/curve.hpp"
 #include "zmqpp/zap_request.hpp"
 #include "zmqpp/auth.hpp"
+#include "zmqpp/z85.hpp"
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 #include <netinet/in.h>
 
 BOOST_AUTO_TEST_SUITE( auth )
@@ -334,6 +339,313 @@ BOOST_AUTO_TEST_CASE(ironhouse)
     BOOST_CHECK_EQUAL("Hello", response.get(0));
 }
 
+/*
+ * Send a ZAP request straight to the authenticator, as a libzmq session does.
+ */
+static void send_zap(zmqpp::socket& zap, std::string const& sequence, std::string const& address,
+        std::string const& mechanism, std::string const& username = "", std::string const& password = "") {
+    zmqpp::message request;
+    request << "" << "1.0" << sequence << "global" << address << "IDENT" << mechanism;
+    if ("PLAIN" == mechanism)
+        request << username << password;
+    zap.send(request);
+}
+
+BOOST_AUTO_TEST_CASE(zap_request_behind_a_router)
+{
+    zmqpp::context context;
+    zmqpp::socket router(context, zmqpp::socket_type::router);
+    router.bind("inproc://zap-request-router");
+    zmqpp::socket handler(context, zmqpp::socket_type::dealer);
+    handler.connect("inproc://zap-request-router");
+
+    zmqpp::message hello;
+    hello << "READY";
+    handler.send(hello);
+    zmqpp::message msg;
+    BOOST_REQUIRE(router.receive(msg));
+    std::string const handler_id = msg.get(0);
+
+    // a dealer gets the routing envelope and sends it back with the reply
+    zmqpp::message request;
+    request << handler_id << "client" << "" << "1.0" << "7" << "global" << "127.0.0.1" << "" << "PLAIN" << "admin" << "password";
+    router.send(request);
+
+    zmqpp::zap_request zap(handler, false);
+    BOOST_CHECK_EQUAL("1.0", zap.get_version());
+    BOOST_CHECK_EQUAL("127.0.0.1", zap.get_address());
+    BOOST_CHECK_EQUAL("admin", zap.get_username());
+    BOOST_CHECK_EQUAL("password", zap.get_password());
+    zap.reply("200", "OK", "admin");
+
+    zmqpp::message reply;
+    BOOST_REQUIRE(router.receive(reply));
+    BOOST_REQUIRE_EQUAL(9, reply.parts());
+    BOOST_CHECK_EQUAL(handler_id, reply.get(0));
+    BOOST_CHECK_EQUAL("client", reply.get(1));
+    BOOST_CHECK_EQUAL("", reply.get(2));
+    BOOST_CHECK_EQUAL("1.0", reply.get(3));
+    BOOST_CHECK_EQUAL("7", reply.get(4));
+    BOOST_CHECK_EQUAL("200", reply.get(5));
+    BOOST_CHECK_EQUAL("admin", reply.get(7));
+}
+
+BOOST_AUTO_TEST_CASE(worker_pool)
+{
+    zmqpp::context context;
+
+    // Answer ZAP requests from four worker threads
+    zmqpp::auth authenticator(context, 4);
+    authenticator.configure_domain("global");
+    authenticator.configure_plain("admin", "password");
+    authenticator.deny("10.0.0.1");
+
+    // Many sessions asking at once, each keeping several requests in flight
+    std::map<std::string, std::string> expected;
+    std::vector<std::unique_ptr<zmqpp::socket>> clients;
+    for (size_t i = 0; i < 8; ++i) {
+        clients.emplace_back(new zmqpp::socket(context, zmqpp::socket_type::dealer));
+        zmqpp::socket& client = *clients.back();
+        client.connect("inproc://zeromq.zap.01");
+
+        std::string const prefix = std::to_string(i) + "-";
+        send_zap(client, prefix + "null", "127.0.0.1", "NULL");
+        send_zap(client, prefix + "denied", "10.0.0.1", "NULL");
+        send_zap(client, prefix + "plain", "127.0.0.1", "PLAIN", "admin", "password");
+        send_zap(client, prefix + "wrong", "127.0.0.1", "PLAIN", "admin", "guess");
+        expected[prefix + "null"] = "200";
+        expected[prefix + "denied"] = "400";
+        expected[prefix + "plain"] = "200";
+        expected[prefix + "wrong"] = "400";
+    }
+
+    std::map<std::string, std::string> answered;
+    for (auto& client : clients) {
+        for (size_t i = 0; i < 4; ++i) {
+            zmqpp::message reply;
+            BOOST_REQUIRE(client->receive(reply));
+            BOOST_CHECK_EQUAL("1.0", reply.get(1));
+            answered[reply.get(2)] = reply.get(3);
+        }
+    }
+    BOOST_CHECK(expected == answered);
+
+    // Every worker sees configuration made after it started
+    authenticator.configure_plain("late", "comer");
+    for (auto& client : clients) {
+        send_zap(*client, "late", "127.0.0.1", "PLAIN", "late", "comer");
+    }
+    for (auto& client : clients) {
+        zmqpp::message reply;
+        BOOST_REQUIRE(client->receive(reply));
+        BOOST_CHECK_EQUAL("200", reply.get(3));
+        BOOST_CHECK_EQUAL("late", reply.get(5));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(address_ranges)
+{
+    zmqpp::context context;
+    zmqpp::auth authenticator(context);
+    authenticator.configure_domain("global");
+
+    // Whitelist ranges; any address outside them will be rejected
+    authenticator.allow("127.0.0.0/8");
+    authenticator.allow("2001:db8::/32");
+    BOOST_CHECK_THROW(authenticator.allow("10.0.0.0/40"), zmqpp::exception);
+
+    zmqpp::socket client(context, zmqpp::socket_type::dealer);
+    client.connect("inproc://zeromq.zap.01");
+
+    std::map<std::string, std::string> expected;
+    expected["127.1.2.3"] = "200";
+    expected["::ffff:127.0.0.1"] = "200";
+    expected["2001:db8:5::1"] = "200";
+    expected["10.0.0.1"] = "400";
+    expected["2001:db9::1"] = "400";
+    for (auto const& address : expected) {
+        send_zap(client, address.first, address.first, "NULL");
+    }
+
+    std::map<std::string, std::string> answered;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        zmqpp::message reply;
+        BOOST_REQUIRE(client.receive(reply));
+        answered[reply.get(2)] = reply.get(3);
+    }
+    BOOST_CHECK(expected == answered);
+}
+
+BOOST_AUTO_TEST_CASE(curve_keys_from_request_frames)
+{
+    zmqpp::context context;
+    zmqpp::auth authenticator(context);
+    authenticator.configure_domain("global");
+
+    std::string const allowed(32, 'a');
+    std::string const other(32, 'o');
+    authenticator.configure_curve(zmqpp::z85::encode(allowed));
+    BOOST_CHECK_THROW(authenticator.configure_curve("not a key"), zmqpp::exception);
+
+    zmqpp::socket client(context, zmqpp::socket_type::dealer);
+    client.connect("inproc://zeromq.zap.01");
+
+    for (auto const& key : { allowed, other }) {
+        zmqpp::message request;
+        request << "" << "1.0" << "1" << "global" << "127.0.0.1" << "IDENT" << "CURVE";
+        request.push_back(key.data(), key.size());
+        client.send(request);
+
+        zmqpp::message reply;
+        BOOST_REQUIRE(client.receive(reply));
+        if (allowed == key) {
+            BOOST_CHECK_EQUAL("200", reply.get(3));
+            BOOST_CHECK_EQUAL(zmqpp::z85::encode(allowed), reply.get(5));
+        } else {
+            BOOST_CHECK_EQUAL("400", reply.get(3));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bulk_configuration)
+{
+    zmqpp::context context;
+    zmqpp::auth authenticator(context, 2);
+    authenticator.configure_domain("global");
+
+    std::vector<std::string> const denied = { "10.0.0.0/8", "192.168.7.7", "not-an-ip" };
+    authenticator.deny(denied.begin(), denied.end());
+
+    std::map<std::string, std::string> users;
+    users["admin"] = "password";
+    users["guest"] = "guest";
+    authenticator.configure_plain(users.begin(), users.end());
+
+    std::vector<std::string> keys;
+    for (char c = 'a'; c < 'e'; ++c) {
+        keys.push_back(zmqpp::z85::encode(std::string(32, c)));
+    }
+    authenticator.configure_curve(keys.begin(), keys.end());
+
+    // a bad item fails the whole call before anything is sent
+    std::vector<std::string> const bad = { keys[0], "not a key" };
+    BOOST_CHECK_THROW(authenticator.configure_curve(bad.begin(), bad.end()), zmqpp::exception);
+
+    zmqpp::socket client(context, zmqpp::socket_type::dealer);
+    client.connect("inproc://zeromq.zap.01");
+
+    std::map<std::string, std::string> expected;
+    send_zap(client, "range", "10.1.2.3", "NULL");
+    expected["range"] = "400";
+    send_zap(client, "single", "192.168.7.7", "NULL");
+    expected["single"] = "400";
+    send_zap(client, "admin", "127.0.0.1", "PLAIN", "admin", "password");
+    expected["admin"] = "200";
+    send_zap(client, "guest", "127.0.0.1", "PLAIN", "guest", "guest");
+    expected["guest"] = "200";
+    for (char c = 'a'; c < 'f'; ++c) {
+        std::string const key(32, c);
+        zmqpp::message request;
+        request << "" << "1.0" << key.substr(0, 1) << "global" << "127.0.0.1" << "IDENT" << "CURVE";
+        request.push_back(key.data(), key.size());
+        client.send(request);
+        expected[key.substr(0, 1)] = ('e' == c) ? "400" : "200";
+    }
+
+    std::map<std::string, std::string> answered;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        zmqpp::message reply;
+        BOOST_REQUIRE(client.receive(reply));
+        answered[reply.get(2)] = reply.get(3);
+    }
+    BOOST_CHECK(expected == answered);
+}
+
+BOOST_AUTO_TEST_CASE(replace_policy)
+{
+    zmqpp::context context;
+    zmqpp::auth authenticator(context, 2);
+    authenticator.configure_domain("global");
+    authenticator.configure_plain("admin", "password");
+
+    zmqpp::socket client(context, zmqpp::socket_type::dealer);
+    client.connect("inproc://zeromq.zap.01");
+
+    send_zap(client, "before", "127.0.0.1", "PLAIN", "admin", "password");
+    zmqpp::message reply;
+    BOOST_REQUIRE(client.receive(reply));
+    BOOST_CHECK_EQUAL("200", reply.get(3));
+
+    // the new policy replaces all of the old one
+    zmqpp::auth_policy policy;
+    policy.configure_domain("global");
+    policy.configure_plain("operator", "secret");
+    policy.deny("10.0.0.0/8");
+    authenticator.configure(std::move(policy));
+
+    std::map<std::string, std::string> expected;
+    send_zap(client, "old", "127.0.0.1", "PLAIN", "admin", "password");
+    expected["old"] = "400";
+    send_zap(client, "new", "127.0.0.1", "PLAIN", "operator", "secret");
+    expected["new"] = "200";
+    send_zap(client, "denied", "10.0.0.1", "NULL");
+    expected["denied"] = "400";
+
+    std::map<std::string, std::string> answered;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        BOOST_REQUIRE(client.receive(reply));
+        answered[reply.get(2)] = reply.get(3);
+    }
+    BOOST_CHECK(expected == answered);
+
+    // and can still be changed one item at a time
+    authenticator.configure_plain("admin", "password");
+    send_zap(client, "again", "127.0.0.1", "PLAIN", "admin", "password");
+    BOOST_REQUIRE(client.receive(reply));
+    BOOST_CHECK_EQUAL("200", reply.get(3));
+}
+
+BOOST_AUTO_TEST_CASE(decision_cache)
+{
+    zmqpp::context context;
+    zmqpp::auth authenticator(context, 2);
+    authenticator.configure_domain("global");
+    authenticator.configure_plain("admin", "password");
+    authenticator.configure_cache(1024, std::chrono::seconds(60));
+
+    zmqpp::socket client(context, zmqpp::socket_type::dealer);
+    client.connect("inproc://zeromq.zap.01");
+
+    // asked twice, answered the same both times
+    std::map<std::string, std::string> expected;
+    for (std::string const round : { "1", "2" }) {
+        send_zap(client, "admin" + round, "127.0.0.1", "PLAIN", "admin", "password");
+        expected["admin" + round] = "200";
+        send_zap(client, "wrong" + round, "127.0.0.1", "PLAIN", "admin", "guess");
+        expected["wrong" + round] = "400";
+        send_zap(client, "null" + round, "10.0.0.1", "NULL");
+        expected["null" + round] = "200";
+    }
+
+    std::map<std::string, std::string> answered;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        zmqpp::message reply;
+        BOOST_REQUIRE(client.receive(reply));
+        answered[reply.get(2)] = reply.get(3);
+        if ("200" == reply.get(3) && 0 == reply.get(2).find("admin")) {
+            BOOST_CHECK_EQUAL("admin", reply.get(5));
+        }
+    }
+    BOOST_CHECK(expected == answered);
+
+    // a change of configuration isn't hidden by cached decisions
+    authenticator.deny("10.0.0.1");
+    send_zap(client, "denied", "10.0.0.1", "NULL");
+    zmqpp::message reply;
+    BOOST_REQUIRE(client.receive(reply));
+    BOOST_CHECK_EQUAL("400", reply.get(3));
+}
+
 /* 
  * The client task runs in its own context, and receives the 
  * client keypair and server public key as an argument.
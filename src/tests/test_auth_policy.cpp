@@ -0,0 +1,167 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "zmqpp/auth_policy.hpp"
+#include "zmqpp/exception.hpp"
+#include "zmqpp/z85.hpp"
+
+#if (ZMQ_VERSION_MAJOR > 3) && !defined(_WIN32)
+
+#include "temporary_directory.hpp"
+
+BOOST_AUTO_TEST_SUITE( auth_policy )
+
+namespace
+{
+    std::string key(char const c)
+    {
+        return zmqpp::z85::encode(std::string(32, c));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(loads_curve_keys_from_a_file)
+{
+    temporary_directory directory("zmqpp-auth");
+    std::string const file = directory.write("clients",
+            "# allowed clients\n"
+            "\n"
+            + key('a') + "\n"
+            "   " + key('b') + "\r\n"
+            + key('c'));
+
+    zmqpp::auth_policy policy;
+    BOOST_CHECK_EQUAL(3, policy.load_curve_keys(file));
+    BOOST_CHECK_EQUAL(3, policy.client_keys.size());
+    BOOST_CHECK(policy.client_keys.contains(std::string(32, 'b').data()));
+    BOOST_CHECK(!policy.client_keys.contains(std::string(32, 'd').data()));
+}
+
+BOOST_AUTO_TEST_CASE(keys_with_comment_and_separator_characters)
+{
+    // = and # are z85 digits, find keys holding them
+    std::mt19937 random(42);
+    std::string with_equals;
+    std::string with_hash;
+    while (with_equals.empty() || with_hash.empty())
+    {
+        std::string binary(32, '\0');
+        for (char& c : binary)
+            c = static_cast<char>(random());
+        std::string const text = zmqpp::z85::encode(binary);
+        if (std::string::npos != text.find('='))
+            with_equals = text;
+        else if (std::string::npos != text.find('#'))
+            with_hash = text;
+    }
+
+    temporary_directory directory("zmqpp-auth");
+    std::string const file = directory.write("clients",
+            "# allowed clients\n"
+            + with_equals + "\n"
+            + with_hash + "\n");
+
+    zmqpp::auth_policy policy;
+    BOOST_CHECK_EQUAL(2, policy.load_curve_keys(file));
+    zmqpp::curve_key_set::key_t key;
+    BOOST_REQUIRE(zmqpp::curve_key_set::parse(with_equals, key));
+    BOOST_CHECK(policy.client_keys.contains(key));
+    BOOST_REQUIRE(zmqpp::curve_key_set::parse(with_hash, key));
+    BOOST_CHECK(policy.client_keys.contains(key));
+
+    // in a certificate too
+    directory.write("certificate.key", "curve\n    public-key = \"" + with_equals + "\"\n");
+    zmqpp::auth_policy certificates;
+    BOOST_CHECK_EQUAL(1, certificates.load_curve_keys(directory.path + "/certificate.key"));
+    BOOST_REQUIRE(zmqpp::curve_key_set::parse(with_equals, key));
+    BOOST_CHECK(certificates.client_keys.contains(key));
+}
+
+BOOST_AUTO_TEST_CASE(loads_certificates_from_a_directory)
+{
+    temporary_directory directory("zmqpp-auth");
+    directory.write("first.key",
+            "#   ****  Generated certificate  ****\n"
+            "metadata\n"
+            "    name = \"first\"\n"
+            "curve\n"
+            "    public-key = \"" + key('1') + "\"\n");
+    directory.write("second.key",
+            "curve\n"
+            "    public-key = \"" + key('2') + "\"\n"
+            "    secret-key = \"" + key('s') + "\"\n");
+    directory.write("empty.key", "");
+    directory.write(".hidden", key('h') + "\n");
+
+    zmqpp::auth_policy policy;
+    BOOST_CHECK_EQUAL(2, policy.load_curve_keys(directory.path));
+    BOOST_CHECK(policy.client_keys.contains(std::string(32, '1').data()));
+    BOOST_CHECK(policy.client_keys.contains(std::string(32, '2').data()));
+    BOOST_CHECK(!policy.client_keys.contains(std::string(32, 's').data()));
+    BOOST_CHECK(!policy.client_keys.contains(std::string(32, 'h').data()));
+}
+
+BOOST_AUTO_TEST_CASE(bad_files_are_reported)
+{
+    temporary_directory directory("zmqpp-auth");
+    zmqpp::auth_policy policy;
+
+    std::string const keys = directory.write("keys", key('a') + "\n    public-key = \"short\"\n");
+    BOOST_CHECK_THROW(policy.load_curve_keys(keys), zmqpp::exception);
+    BOOST_CHECK_THROW(policy.load_curve_keys(directory.path + "/missing"), zmqpp::exception);
+
+    std::string const passwords = directory.write("passwords", "admin=password\nnobody\n");
+    BOOST_CHECK_THROW(policy.load_passwords(passwords), zmqpp::exception);
+}
+
+BOOST_AUTO_TEST_CASE(loads_passwords)
+{
+    temporary_directory directory("zmqpp-auth");
+    std::string const file = directory.write("passwords",
+            "# users\n"
+            "admin=password\n"
+            "guest=\n"
+            "url=http://host/?a=b\n");
+
+    zmqpp::auth_policy policy;
+    BOOST_CHECK_EQUAL(3, policy.load_passwords(file));
+    BOOST_CHECK_EQUAL("password", policy.passwords["admin"]);
+    BOOST_CHECK_EQUAL("", policy.passwords["guest"]);
+    BOOST_CHECK_EQUAL("http://host/?a=b", policy.passwords["url"]);
+}
+
+BOOST_AUTO_TEST_CASE(checks_addresses_and_keys)
+{
+    zmqpp::auth_policy policy;
+    policy.allow("10.0.0.0/8");
+    policy.allow("localhost");
+    BOOST_CHECK(policy.whitelist_ranges.contains(std::string("10.1.1.1")));
+    BOOST_CHECK_EQUAL(1, policy.whitelist.count("localhost"));
+    BOOST_CHECK_THROW(policy.deny("10.0.0.0/99"), zmqpp::exception);
+
+    policy.configure_curve("CURVE_ALLOW_ANY");
+    BOOST_CHECK(policy.curve_allow_any);
+    policy.configure_curve(key('k'));
+    BOOST_CHECK(!policy.curve_allow_any);
+    BOOST_CHECK_THROW(policy.configure_curve("not a key"), zmqpp::exception);
+
+    // a cache whose decisions never last is none
+    policy.configure_cache(100, std::chrono::seconds(1));
+    BOOST_CHECK_EQUAL(100, policy.cache_entries);
+    policy.configure_cache(100, std::chrono::milliseconds(0));
+    BOOST_CHECK_EQUAL(0, policy.cache_entries);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,271 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "zmqpp/capture_journal.hpp"
+#include "zmqpp/context.hpp"
+#include "zmqpp/exception.hpp"
+#include "zmqpp/message.hpp"
+#include "zmqpp/proxy_engine.hpp"
+#include "zmqpp/socket.hpp"
+
+#ifndef _WIN32
+
+#include <sys/stat.h>
+
+#include "temporary_directory.hpp"
+
+BOOST_AUTO_TEST_SUITE( capture_journal )
+
+namespace
+{
+    std::chrono::nanoseconds at(long const nanoseconds)
+    {
+        return std::chrono::nanoseconds(nanoseconds);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(records_read_back_across_segments)
+{
+    temporary_directory directory("zmqpp-journal");
+    {
+        zmqpp::journal_writer writer(directory.path, 256);
+        for (int i = 0; i < 50; ++i)
+        {
+            zmqpp::message msg;
+            msg << "message" << std::string(i, 'x');
+            writer.append(at(1000 + i), static_cast<uint8_t>(i % 2), msg);
+        }
+
+        zmqpp::message large;
+        large << std::string(1000, 'l');
+        writer.append(at(2000), zmqpp::journal_writer::untagged, large);
+        BOOST_CHECK_EQUAL(51, writer.records());
+    }
+
+    zmqpp::journal_reader reader(directory.path);
+    BOOST_REQUIRE(reader.segments().size() > 1);
+    BOOST_CHECK_EQUAL(1000, reader.segments().front().first_timestamp);
+    BOOST_CHECK_EQUAL(2000, reader.segments().back().last_timestamp);
+
+    zmqpp::journal_record record;
+    for (int i = 0; i < 50; ++i)
+    {
+        BOOST_REQUIRE(reader.next(record));
+        BOOST_CHECK_EQUAL(1000 + i, record.timestamp.count());
+        BOOST_CHECK_EQUAL(i % 2, record.direction);
+        BOOST_REQUIRE_EQUAL(2, record.msg.parts());
+        BOOST_CHECK_EQUAL("message", record.msg.get(0));
+        BOOST_CHECK_EQUAL(std::string(i, 'x'), record.msg.get(1));
+    }
+
+    // larger than a segment, so it was given one of its own
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL(zmqpp::journal_writer::untagged, record.direction);
+    BOOST_CHECK_EQUAL(std::string(1000, 'l'), record.msg.get(0));
+    BOOST_CHECK(!reader.next(record));
+
+    reader.seek(at(1030));
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL(1030, record.timestamp.count());
+
+    reader.seek(at(0));
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL(1000, record.timestamp.count());
+}
+
+BOOST_AUTO_TEST_CASE(reader_follows_a_live_journal)
+{
+    temporary_directory directory("zmqpp-journal");
+    zmqpp::journal_writer writer(directory.path, 256);
+
+    zmqpp::message first;
+    first << "first";
+    writer.append(zmqpp::journal_writer::untagged, first);
+
+    zmqpp::journal_reader reader(directory.path);
+    zmqpp::journal_record record;
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL("first", record.msg.get(0));
+    BOOST_CHECK(!reader.next(record));
+
+    // enough to roll over into new segments
+    for (int i = 0; i < 20; ++i)
+    {
+        zmqpp::message msg;
+        msg << i;
+        writer.append(zmqpp::journal_writer::untagged, msg);
+    }
+
+    for (int i = 0; i < 20; ++i)
+    {
+        BOOST_REQUIRE(reader.next(record));
+        BOOST_CHECK_EQUAL(i, record.msg.get<int>(0));
+    }
+    BOOST_CHECK(!reader.next(record));
+}
+
+BOOST_AUTO_TEST_CASE(new_writer_appends_after_existing_segments)
+{
+    temporary_directory directory("zmqpp-journal");
+    {
+        zmqpp::journal_writer writer(directory.path);
+        zmqpp::message msg;
+        msg << "before";
+        writer.append(at(1000), 0, msg);
+    }
+    {
+        zmqpp::journal_writer writer(directory.path);
+        zmqpp::message msg;
+        msg << "after";
+        writer.append(at(2000), 0, msg);
+    }
+
+    zmqpp::journal_reader reader(directory.path);
+    BOOST_CHECK_EQUAL(2, reader.segments().size());
+
+    zmqpp::journal_record record;
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL("before", record.msg.get(0));
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL("after", record.msg.get(0));
+}
+
+BOOST_AUTO_TEST_CASE(closed_segments_are_cut_to_their_records)
+{
+    temporary_directory directory("zmqpp-journal");
+    zmqpp::journal_writer writer(directory.path, 64 * 1024);
+
+    zmqpp::message first;
+    first << "first";
+    writer.append(at(1000), 0, first);
+
+    // following the segment as it is cut back
+    zmqpp::journal_reader reader(directory.path);
+    zmqpp::journal_record record;
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK(!reader.next(record));
+
+    writer.close();
+    zmqpp::message second;
+    second << "second";
+    writer.append(at(2000), 0, second);
+    writer.close();
+
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL("second", record.msg.get(0));
+    BOOST_CHECK(!reader.next(record));
+
+    zmqpp::journal_reader closed(directory.path);
+    BOOST_REQUIRE_EQUAL(2, closed.segments().size());
+    for (zmqpp::journal_segment const& segment : closed.segments())
+    {
+        std::string name = std::to_string(segment.number);
+        name.insert(0, 20 - name.size(), '0');
+
+        struct stat info;
+        BOOST_REQUIRE_EQUAL(0, stat((directory.path + "/" + name + ".segment").c_str(), &info));
+        BOOST_CHECK_EQUAL(segment.size, static_cast<uint64_t>(info.st_size));
+        BOOST_CHECK(segment.size < 64 * 1024);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(empty_directory_is_not_a_journal)
+{
+    temporary_directory directory("zmqpp-journal");
+    BOOST_CHECK_THROW(zmqpp::journal_reader reader(directory.path), zmqpp::exception);
+}
+
+BOOST_AUTO_TEST_CASE(records_tagged_proxy_capture_and_replays_it)
+{
+    temporary_directory directory("zmqpp-journal");
+    zmqpp::context context;
+
+    zmqpp::socket frontend(context, zmqpp::socket_type::pair);
+    zmqpp::socket backend(context, zmqpp::socket_type::pair);
+    zmqpp::socket capture(context, zmqpp::socket_type::push);
+    frontend.bind("inproc://journal-frontend");
+    backend.bind("inproc://journal-backend");
+    capture.bind("inproc://journal-capture");
+
+    zmqpp::socket client(context, zmqpp::socket_type::pair);
+    zmqpp::socket worker(context, zmqpp::socket_type::pair);
+    zmqpp::socket sink(context, zmqpp::socket_type::pull);
+    client.connect("inproc://journal-frontend");
+    worker.connect("inproc://journal-backend");
+    sink.connect("inproc://journal-capture");
+
+    zmqpp::proxy_engine engine(frontend, backend);
+    engine.set_capture(capture, true);
+    std::thread proxy([&]() { engine.run(); });
+
+    zmqpp::journal_writer writer(directory.path);
+    std::thread recorder([&]() { writer.record(sink, true); });
+
+    for (int i = 0; i < 5; ++i)
+    {
+        zmqpp::message request;
+        request << "request" << i;
+        BOOST_REQUIRE(client.send(request));
+
+        zmqpp::message received;
+        BOOST_REQUIRE(worker.receive(received));
+        BOOST_REQUIRE(worker.send("reply"));
+
+        std::string reply;
+        BOOST_REQUIRE(client.receive(reply));
+    }
+
+    engine.stop();
+    proxy.join();
+
+    // let the recorder drain the capture
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    writer.stop();
+    recorder.join();
+    BOOST_CHECK_EQUAL(10, writer.records());
+    writer.close();
+
+    zmqpp::journal_reader reader(directory.path);
+    zmqpp::journal_record record;
+    for (int i = 0; i < 5; ++i)
+    {
+        BOOST_REQUIRE(reader.next(record));
+        BOOST_CHECK_EQUAL(static_cast<uint8_t>(zmqpp::proxy_engine::direction::frontend_to_backend), record.direction);
+        BOOST_REQUIRE_EQUAL(2, record.msg.parts());
+        BOOST_CHECK_EQUAL(i, record.msg.get<int>(1));
+
+        BOOST_REQUIRE(reader.next(record));
+        BOOST_CHECK_EQUAL(static_cast<uint8_t>(zmqpp::proxy_engine::direction::backend_to_frontend), record.direction);
+        BOOST_CHECK_EQUAL("reply", record.msg.get(0));
+    }
+
+    // replay both sides as fast as possible, as if the proxy ran again
+    reader.seek(at(0));
+    BOOST_CHECK_EQUAL(10, reader.replay(client, &worker, 0));
+
+    for (int i = 0; i < 5; ++i)
+    {
+        zmqpp::message request;
+        BOOST_REQUIRE(frontend.receive(request));
+        BOOST_CHECK_EQUAL(i, request.get<int>(1));
+
+        std::string reply;
+        BOOST_REQUIRE(backend.receive(reply));
+        BOOST_CHECK_EQUAL("reply", reply);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
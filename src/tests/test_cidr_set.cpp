@@ -0,0 +1,115 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+#include "zmqpp/cidr_set.hpp"
+#include "zmqpp/exception.hpp"
+
+BOOST_AUTO_TEST_SUITE( cidr_set )
+
+BOOST_AUTO_TEST_CASE(parses_addresses_and_ranges)
+{
+    zmqpp::cidr_set::address_t address;
+    size_t prefix_length = 0;
+
+    BOOST_REQUIRE(zmqpp::cidr_set::parse("192.168.1.0/24", address, prefix_length));
+    BOOST_CHECK_EQUAL(96 + 24, prefix_length);
+    BOOST_CHECK_EQUAL(0xff, address[10]);
+    BOOST_CHECK_EQUAL(192, address[12]);
+
+    BOOST_REQUIRE(zmqpp::cidr_set::parse("2001:db8::/32", address, prefix_length));
+    BOOST_CHECK_EQUAL(32, prefix_length);
+    BOOST_CHECK_EQUAL(0x20, address[0]);
+
+    BOOST_REQUIRE(zmqpp::cidr_set::parse("::1", address, prefix_length));
+    BOOST_CHECK_EQUAL(128, prefix_length);
+
+    BOOST_CHECK(!zmqpp::cidr_set::parse("10.0.0.0/33", address, prefix_length));
+    BOOST_CHECK(!zmqpp::cidr_set::parse("10.0.0.0/", address, prefix_length));
+    BOOST_CHECK(!zmqpp::cidr_set::parse("10.0.0.0/8x", address, prefix_length));
+    BOOST_CHECK(!zmqpp::cidr_set::parse("localhost", address, prefix_length));
+
+    // a zone is ignored in a single address
+    BOOST_CHECK(zmqpp::cidr_set::parse("fe80::1%eth0", address));
+}
+
+BOOST_AUTO_TEST_CASE(matches_ipv4_and_ipv6_ranges)
+{
+    zmqpp::cidr_set ranges;
+    BOOST_CHECK(ranges.insert("10.0.0.0/8"));
+    BOOST_CHECK(ranges.insert("192.168.1.0/24"));
+    BOOST_CHECK(ranges.insert("127.0.0.1"));
+    BOOST_CHECK(ranges.insert("2001:db8::/32"));
+    BOOST_CHECK(!ranges.insert("not an address"));
+    BOOST_CHECK_EQUAL(4, ranges.size());
+
+    BOOST_CHECK(ranges.contains(std::string("10.200.3.4")));
+    BOOST_CHECK(ranges.contains(std::string("192.168.1.255")));
+    BOOST_CHECK(!ranges.contains(std::string("192.168.2.1")));
+    BOOST_CHECK(ranges.contains(std::string("127.0.0.1")));
+    BOOST_CHECK(!ranges.contains(std::string("127.0.0.2")));
+    BOOST_CHECK(ranges.contains(std::string("2001:db8:1::5")));
+    BOOST_CHECK(!ranges.contains(std::string("2001:db9::5")));
+    BOOST_CHECK(!ranges.contains(std::string("not an address")));
+
+    // IPv4 also matches in its mapped form
+    BOOST_CHECK(ranges.contains(std::string("::ffff:10.0.0.1")));
+}
+
+BOOST_AUTO_TEST_CASE(covered_ranges_are_not_kept)
+{
+    zmqpp::cidr_set ranges;
+    ranges.insert("10.1.0.0/16");
+    ranges.insert("10.2.3.0/24");
+    ranges.insert("172.16.0.0/12");
+    BOOST_CHECK_EQUAL(3, ranges.size());
+
+    // inside an existing range
+    ranges.insert("172.16.5.5");
+    BOOST_CHECK_EQUAL(3, ranges.size());
+
+    // covering the first two
+    ranges.insert("10.0.0.0/8");
+    BOOST_CHECK_EQUAL(2, ranges.size());
+    BOOST_CHECK(ranges.contains(std::string("10.99.0.1")));
+
+    // every IPv4 address, not IPv6
+    ranges.insert("0.0.0.0/0");
+    BOOST_CHECK_EQUAL(1, ranges.size());
+    BOOST_CHECK(ranges.contains(std::string("8.8.8.8")));
+    BOOST_CHECK(!ranges.contains(std::string("::1")));
+
+    ranges.clear();
+    BOOST_CHECK(ranges.empty());
+    BOOST_CHECK(!ranges.contains(std::string("8.8.8.8")));
+}
+
+BOOST_AUTO_TEST_CASE(many_ranges)
+{
+    zmqpp::cidr_set ranges;
+    ranges.reserve(256 * 256);
+    for (size_t i = 0; i < 256; ++i)
+    {
+        for (size_t j = 0; j < 256; j += 2)
+        {
+            ranges.insert(std::to_string(i) + "." + std::to_string(j) + ".0.0/16");
+        }
+    }
+    BOOST_CHECK_EQUAL(256 * 128, ranges.size());
+
+    BOOST_CHECK(ranges.contains(std::string("200.100.1.1")));
+    BOOST_CHECK(!ranges.contains(std::string("200.101.1.1")));
+
+    zmqpp::cidr_set::address_t address;
+    BOOST_CHECK_THROW(ranges.insert(address, 129), zmqpp::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -15,6 +15,8 @@
 #include <boost/test/unit_test.hpp>
 
 #include "zmqpp/context.hpp"
+#include "zmqpp/socket.hpp"
+#include "zmqpp/thread_placement.hpp"
 
 BOOST_AUTO_TEST_SUITE( context )
 
@@ -52,6 +54,20 @@ BOOST_AUTO_TEST_CASE( validaty )
 	BOOST_CHECK_THROW(context.get(zmqpp::context_option::io_threads), zmqpp::invalid_instance);
 }
 
+#if (ZMQ_VERSION_MAJOR > 4) || ((ZMQ_VERSION_MAJOR == 4) && (ZMQ_VERSION_MINOR >= 3))
+BOOST_AUTO_TEST_CASE( io_thread_placement )
+{
+	zmqpp::context context;
+	BOOST_CHECK_NO_THROW(context.set(zmqpp::context_option::thread_name_prefix, 7));
+	BOOST_CHECK_NO_THROW(zmqpp::thread_placement().add_cpu(0).apply(context));
+	BOOST_CHECK_NO_THROW(zmqpp::thread_topology().set_io_threads(zmqpp::thread_placement().add_cpu(0)).apply(context));
+
+	// the I/O threads start with the first socket
+	zmqpp::socket socket(context, zmqpp::socket_type::pull);
+	socket.bind("inproc://placed");
+}
+#endif
+
 BOOST_AUTO_TEST_CASE( throws_exception )
 {
 #if (ZMQ_VERSION_MAJOR < 3) || ((ZMQ_VERSION_MAJOR == 3) && (ZMQ_VERSION_MINOR < 2))
@@ -0,0 +1,101 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "zmqpp/coroutine.hpp"
+
+#ifdef ZMQPP_HAVE_COROUTINES
+
+#include <stdexcept>
+#include <string>
+
+#include "zmqpp/context.hpp"
+#include "zmqpp/loop.hpp"
+#include "zmqpp/message.hpp"
+#include "zmqpp/socket.hpp"
+
+BOOST_AUTO_TEST_SUITE( coroutine )
+
+zmqpp::task<> send_slowly(zmqpp::loop& loop, zmqpp::socket& pusher, int const count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        co_await zmqpp::async_sleep(loop, std::chrono::milliseconds(1));
+        zmqpp::message message;
+        message << std::to_string(i);
+        co_await zmqpp::async_send(loop, pusher, std::move(message));
+    }
+}
+
+zmqpp::task<int> sum_received(zmqpp::loop& loop, zmqpp::socket& puller, int const count)
+{
+    int sum = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        zmqpp::message message = co_await zmqpp::async_receive(loop, puller);
+        sum += std::stoi(message.get(0));
+    }
+    co_return sum;
+}
+
+zmqpp::task<> receive_then_stop(zmqpp::loop& loop, zmqpp::socket& puller, int const count, int& result)
+{
+    result = co_await sum_received(loop, puller, count);
+    loop.add(std::chrono::microseconds(0), 1, []() -> bool { return false; });
+}
+
+BOOST_AUTO_TEST_CASE(send_and_receive)
+{
+    zmqpp::context context;
+
+    zmqpp::socket puller(context, zmqpp::socket_type::pull);
+    puller.bind("inproc://test");
+    zmqpp::socket pusher(context, zmqpp::socket_type::push);
+    pusher.connect("inproc://test");
+
+    zmqpp::loop loop;
+    loop.add(std::chrono::milliseconds(1000), 1, []() -> bool { return false; });
+
+    int result = -1;
+    zmqpp::spawn(receive_then_stop(loop, puller, 5, result));
+    zmqpp::spawn(send_slowly(loop, pusher, 5));
+
+    BOOST_CHECK_NO_THROW(loop.start());
+    BOOST_CHECK_EQUAL(0 + 1 + 2 + 3 + 4, result);
+}
+
+zmqpp::task<int> fails()
+{
+    throw std::runtime_error("failed");
+    co_return 0;
+}
+
+zmqpp::task<> catch_failure(bool& caught)
+{
+    try
+    {
+        co_await fails();
+    }
+    catch (std::runtime_error const&)
+    {
+        caught = true;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(exceptions_reach_the_awaiter)
+{
+    bool caught = false;
+    zmqpp::spawn(catch_failure(caught));
+    BOOST_CHECK(caught);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
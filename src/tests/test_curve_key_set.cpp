@@ -0,0 +1,93 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <string>
+
+#include "zmqpp/curve_key_set.hpp"
+#include "zmqpp/z85.hpp"
+
+BOOST_AUTO_TEST_SUITE( curve_key_set )
+
+#if (ZMQ_VERSION_MAJOR >= 4)
+
+namespace
+{
+    zmqpp::curve_key_set::key_t numbered(size_t const number)
+    {
+        zmqpp::curve_key_set::key_t key;
+        key.fill(0x5a);
+        key[0] = static_cast<uint8_t>(number);
+        key[17] = static_cast<uint8_t>(number >> 8);
+        key[31] = static_cast<uint8_t>(number >> 16);
+        return key;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(parses_binary_and_z85_keys)
+{
+    std::string const binary(32, 'k');
+    zmqpp::curve_key_set::key_t key;
+
+    BOOST_REQUIRE(zmqpp::curve_key_set::parse(binary, key));
+    BOOST_CHECK_EQUAL('k', key[31]);
+
+    key.fill(0);
+    BOOST_REQUIRE(zmqpp::curve_key_set::parse(zmqpp::z85::encode(binary), key));
+    BOOST_CHECK_EQUAL('k', key[0]);
+
+    BOOST_CHECK(!zmqpp::curve_key_set::parse("too short", key));
+    BOOST_CHECK(!zmqpp::curve_key_set::parse(std::string(40, '~'), key));
+}
+
+BOOST_AUTO_TEST_CASE(finds_keys_in_binary)
+{
+    zmqpp::curve_key_set keys;
+    BOOST_CHECK(keys.empty());
+    BOOST_CHECK(!keys.contains(numbered(1)));
+
+    std::string const binary(32, 'k');
+    BOOST_CHECK(keys.insert(zmqpp::z85::encode(binary)));
+    BOOST_CHECK(!keys.insert("not a key"));
+    BOOST_CHECK(keys.contains(binary.data()));
+
+    keys.insert(numbered(1));
+    keys.insert(numbered(1));
+    BOOST_CHECK_EQUAL(2, keys.size());
+    BOOST_CHECK(keys.contains(numbered(1)));
+    BOOST_CHECK(!keys.contains(numbered(2)));
+
+    keys.clear();
+    BOOST_CHECK(keys.empty());
+    BOOST_CHECK(!keys.contains(binary.data()));
+}
+
+BOOST_AUTO_TEST_CASE(grows_to_many_keys)
+{
+    size_t const count = 100000;
+
+    zmqpp::curve_key_set keys;
+    keys.reserve(count / 2);
+    for (size_t i = 0; i < count; ++i)
+    {
+        keys.insert(numbered(i));
+    }
+    BOOST_CHECK_EQUAL(count, keys.size());
+
+    size_t found = 0;
+    for (size_t i = 0; i < 2 * count; ++i)
+    {
+        found += keys.contains(numbered(i)) ? 1 : 0;
+    }
+    BOOST_CHECK_EQUAL(count, found);
+}
+
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
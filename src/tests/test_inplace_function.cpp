@@ -0,0 +1,89 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <array>
+#include <functional>
+#include <memory>
+
+#include "zmqpp/inplace_function.hpp"
+
+BOOST_AUTO_TEST_SUITE( inplace_function )
+
+typedef zmqpp::inplace_function<int (int)> function_t;
+
+BOOST_AUTO_TEST_CASE(empty)
+{
+    function_t empty;
+    BOOST_CHECK(!empty);
+    BOOST_CHECK_THROW(empty(1), std::bad_function_call);
+
+    function_t from_null(nullptr);
+    BOOST_CHECK(!from_null);
+
+    function_t from_empty_function(std::function<int (int)>{});
+    BOOST_CHECK(!from_empty_function);
+}
+
+BOOST_AUTO_TEST_CASE(inline_capture)
+{
+    std::array<int, 8> values = {{ 1, 2, 3, 4, 5, 6, 7, 8 }};
+    auto lambda = [values](int index) { return values[index]; };
+    BOOST_CHECK(function_t::stored_inline<decltype(lambda)>());
+
+    function_t function(lambda);
+    BOOST_REQUIRE(function);
+    BOOST_CHECK_EQUAL(8, function(7));
+}
+
+BOOST_AUTO_TEST_CASE(heap_capture)
+{
+    std::array<int, 64> values;
+    values.fill(3);
+    auto lambda = [values](int index) { return values[index]; };
+    BOOST_CHECK(!function_t::stored_inline<decltype(lambda)>());
+
+    function_t function(lambda);
+    BOOST_REQUIRE(function);
+    BOOST_CHECK_EQUAL(3, function(63));
+
+    function_t moved(std::move(function));
+    BOOST_CHECK(!function);
+    BOOST_CHECK_EQUAL(3, moved(0));
+}
+
+struct move_only_adder
+{
+    std::shared_ptr<int> counter;
+    std::unique_ptr<int> owned;
+
+    int operator()(int add) { *counter += add; return *owned; }
+};
+
+BOOST_AUTO_TEST_CASE(move_only_capture)
+{
+    std::shared_ptr<int> counter = std::make_shared<int>(0);
+    std::weak_ptr<int> watch = counter;
+
+    function_t function(move_only_adder{counter, std::unique_ptr<int>(new int(5))});
+    counter.reset();
+
+    BOOST_CHECK_EQUAL(5, function(2));
+
+    function_t moved;
+    moved = std::move(function);
+    BOOST_CHECK(!function);
+    BOOST_CHECK_EQUAL(5, moved(3));
+    BOOST_CHECK_EQUAL(5, *watch.lock());
+
+    moved = nullptr;
+    BOOST_CHECK(watch.expired());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
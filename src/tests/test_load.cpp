@@ -16,10 +16,25 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
 #include <boost/thread.hpp>
 #include <boost/timer.hpp>
 
 #include "zmqpp/zmqpp.hpp"
+#include "zmqpp/cidr_set.hpp"
+#include "zmqpp/curve_key_set.hpp"
+#include "zmqpp/proxy.hpp"
+#include "zmqpp/proxy_engine.hpp"
+#include "zmqpp/sharded_broker.hpp"
+#include "zmqpp/z85.hpp"
 
 
 BOOST_AUTO_TEST_SUITE( load )
@@ -159,6 +174,533 @@ BOOST_AUTO_TEST_CASE( push_messages )
 	BOOST_TEST_MESSAGE("\n");
 }
 
+// Number of request reply round trips to time
+const size_t round_trips = 1e5;
+
+// Ping pong a short message over a pair of sockets, both sides waiting through a poller
+// with the given spin policy, and report round trip latency percentiles
+void round_trip_latency(std::string const& name, std::string const& endpoint, zmqpp::poller::spin_policy const& policy)
+{
+	zmqpp::context context;
+	zmqpp::socket server(context, zmqpp::socket_type::pair);
+	server.bind(endpoint);
+
+	zmqpp::socket client(context, zmqpp::socket_type::pair);
+	client.connect(endpoint);
+
+	auto echo_func = [&server, &policy](void) {
+		zmqpp::poller poller;
+		poller.set_spin_policy(policy);
+		poller.add(server);
+
+		zmqpp::message message;
+		for(size_t i = 0; i < round_trips; ++i)
+		{
+			while(!poller.poll(max_poll_timeout)) { }
+			server.receive(message);
+			server.send(message);
+		}
+	};
+
+	zmqpp::poller poller;
+	poller.set_spin_policy(policy);
+	poller.add(client);
+
+	boost::thread thread(echo_func);
+
+	std::vector<std::chrono::nanoseconds> latencies;
+	latencies.reserve(round_trips);
+
+	zmqpp::message message;
+	for(size_t i = 0; i < round_trips; ++i)
+	{
+		auto const start = std::chrono::steady_clock::now();
+
+		client.send(short_message);
+		BOOST_REQUIRE(poller.poll(max_poll_timeout));
+		client.receive(message);
+
+		latencies.push_back(std::chrono::steady_clock::now() - start);
+	}
+
+	BOOST_CHECK_MESSAGE(thread.timed_join(boost::posix_time::milliseconds(max_poll_timeout)), "hung while joining echo thread");
+
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&latencies](double const fraction) {
+		size_t const index = std::min(latencies.size() - 1, static_cast<size_t>(fraction * latencies.size()));
+		return std::chrono::duration_cast<std::chrono::microseconds>(latencies[index]).count();
+	};
+
+	BOOST_TEST_MESSAGE(name);
+	BOOST_TEST_MESSAGE("Round trips        : " << latencies.size());
+	BOOST_TEST_MESSAGE("p50 latency        : " << percentile(0.5) << " microseconds");
+	BOOST_TEST_MESSAGE("p99 latency        : " << percentile(0.99) << " microseconds");
+	BOOST_TEST_MESSAGE("p99.9 latency      : " << percentile(0.999) << " microseconds");
+	BOOST_TEST_MESSAGE("\n");
+}
+
+BOOST_AUTO_TEST_CASE( round_trip_latency_inproc )
+{
+	round_trip_latency("Inproc: Blocking", "inproc://latency", zmqpp::poller::spin_policy());
+	round_trip_latency("Inproc: Spinning", "inproc://latency", zmqpp::poller::spin_policy(std::chrono::microseconds(50), false));
+	round_trip_latency("Inproc: Adaptive Spinning", "inproc://latency", zmqpp::poller::spin_policy(std::chrono::microseconds(50)));
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE( round_trip_latency_ipc )
+{
+	round_trip_latency("IPC: Blocking", "ipc://zmqpp-latency", zmqpp::poller::spin_policy());
+	round_trip_latency("IPC: Spinning", "ipc://zmqpp-latency", zmqpp::poller::spin_policy(std::chrono::microseconds(50), false));
+	round_trip_latency("IPC: Adaptive Spinning", "ipc://zmqpp-latency", zmqpp::poller::spin_policy(std::chrono::microseconds(50)));
+}
+#endif
+
+// Number of messages to pass through a proxy
+const uint64_t proxied_messages = 1e6;
+
+// Push short messages through a proxy between two inproc pipes, either zmq_proxy
+// or a proxy_engine with or without a pass through hook, and report throughput
+static void proxy_throughput(std::string const& name, bool const native, bool const hooked)
+{
+	zmqpp::context context;
+	std::atomic<bool> ready(false);
+
+	auto proxy_func = [&context, &ready, native, hooked](void) {
+		zmqpp::socket frontend(context, zmqpp::socket_type::pull);
+		zmqpp::socket backend(context, zmqpp::socket_type::push);
+		frontend.bind("inproc://proxy-frontend");
+		backend.bind("inproc://proxy-backend");
+		ready = true;
+
+		if (!native)
+		{
+			zmqpp::proxy proxy(frontend, backend);
+			return;
+		}
+
+		zmqpp::proxy_engine engine(frontend, backend);
+		if (hooked)
+			engine.set_hook(zmqpp::proxy_engine::direction::frontend_to_backend, [](zmqpp::message&) { return true; });
+		engine.run(); // returns once the context is terminated
+	};
+
+	boost::thread proxy_thread(proxy_func);
+	while (!ready)
+		boost::this_thread::yield();
+
+	zmqpp::socket pusher(context, zmqpp::socket_type::push);
+	zmqpp::socket puller(context, zmqpp::socket_type::pull);
+	pusher.connect("inproc://proxy-frontend");
+	puller.connect("inproc://proxy-backend");
+
+	auto pusher_func = [&pusher](void) {
+		for (uint64_t i = 0; i < proxied_messages; ++i)
+			pusher.send(short_message);
+	};
+
+	boost::timer t;
+	boost::thread pusher_thread(pusher_func);
+
+	std::string message;
+	uint64_t processed = 0;
+	while (processed < proxied_messages && puller.receive(message))
+		++processed;
+
+	double elapsed_run = t.elapsed();
+	pusher_thread.join();
+
+	pusher.close();
+	puller.close();
+	context.terminate();
+	BOOST_CHECK_MESSAGE(proxy_thread.timed_join(boost::posix_time::milliseconds(max_poll_timeout)), "hung while joining proxy thread");
+	BOOST_CHECK_EQUAL(processed, proxied_messages);
+
+	BOOST_TEST_MESSAGE(name);
+	BOOST_TEST_MESSAGE("Messages proxied   : " << processed);
+	BOOST_TEST_MESSAGE("Run time           : " << elapsed_run << " seconds");
+	BOOST_TEST_MESSAGE("Messages per second: " << processed / elapsed_run);
+	BOOST_TEST_MESSAGE("\n");
+}
+
+BOOST_AUTO_TEST_CASE( proxy_throughput_comparison )
+{
+	proxy_throughput("Proxy: zmq_proxy", false, false);
+	proxy_throughput("Proxy: proxy_engine", true, false);
+	proxy_throughput("Proxy: proxy_engine with hook", true, true);
+}
+
+#ifndef _WIN32
+// Requests each broker client makes, and how many it keeps in flight
+const size_t brokered_requests = 1e5;
+const size_t brokered_window = 100;
+
+// Run request reply traffic from several clients through a sharded_broker to
+// echo workers, two per shard, and report the request rate
+static void broker_throughput(size_t const shards, size_t const clients)
+{
+	zmqpp::context context;
+
+	std::vector<std::string> backends;
+	for (size_t i = 0; i < shards; ++i)
+		backends.push_back("inproc://broker-backend-" + std::to_string(i));
+
+	std::unique_ptr<zmqpp::sharded_broker> broker(new zmqpp::sharded_broker(context, "inproc://broker-frontend", backends));
+
+	auto worker_func = [&context](std::string const& endpoint) {
+		zmqpp::socket worker(context, zmqpp::socket_type::request);
+		worker.connect(endpoint);
+		worker.send(zmqpp::sharded_broker::ready);
+
+		zmqpp::message msg;
+		try
+		{
+			while (worker.receive(msg))
+				worker.send(msg);
+		}
+		catch (zmqpp::zmq_internal_exception const&)
+		{
+			// context terminated
+		}
+	};
+
+	boost::thread_group workers;
+	for (size_t i = 0; i < shards * 2; ++i)
+		workers.create_thread(std::bind(worker_func, backends[i % shards]));
+
+	// keep a window of requests in flight, a client's identity picks its shard
+	auto client_func = [&context]() {
+		zmqpp::socket client(context, zmqpp::socket_type::dealer);
+		client.connect("inproc://broker-frontend");
+
+		size_t sent = 0;
+		for (; sent < brokered_window; ++sent)
+		{
+			zmqpp::message request;
+			request << "" << short_message;
+			client.send(request);
+		}
+
+		zmqpp::message reply;
+		for (size_t received = 0; received < brokered_requests && client.receive(reply); ++received)
+		{
+			if (sent < brokered_requests)
+			{
+				client.send(reply);
+				++sent;
+			}
+		}
+	};
+
+	auto const start = std::chrono::steady_clock::now();
+	boost::thread_group client_threads;
+	for (size_t i = 0; i < clients; ++i)
+		client_threads.create_thread(client_func);
+	client_threads.join_all();
+	auto const elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	BOOST_CHECK_NO_THROW(broker->stop());
+	broker.reset();
+	context.terminate();
+	workers.join_all();
+
+	size_t const total = brokered_requests * clients;
+	BOOST_TEST_MESSAGE("Broker: " << shards << " shards, " << clients << " clients");
+	BOOST_TEST_MESSAGE("Requests           : " << total);
+	BOOST_TEST_MESSAGE("Run time           : " << elapsed.count() / 1e6 << " seconds");
+	BOOST_TEST_MESSAGE("Requests per second: " << (total * 1e6 / elapsed.count()));
+	BOOST_TEST_MESSAGE("\n");
+}
+
+BOOST_AUTO_TEST_CASE( sharded_broker_scaling )
+{
+	for (size_t shards = 1; shards <= 4; shards *= 2)
+		broker_throughput(shards, 8);
+}
+#endif
+
+#if (ZMQ_VERSION_MAJOR > 3)
+// ZAP requests each client makes, and how many it keeps in flight
+const size_t zap_requests = 1e5;
+const size_t zap_window = 16;
+
+// Send ZAP requests for one mechanism straight to an auth actor from several
+// clients, as libzmq sessions do when many peers reconnect at once, and report
+// the rate they are answered at
+static void zap_throughput(std::string const& mechanism, size_t const workers, size_t const clients, bool const cached = false)
+{
+	zmqpp::context context;
+	zmqpp::auth authenticator(context, workers);
+	authenticator.configure_domain("*");
+	if (cached)
+		authenticator.configure_cache(4096, std::chrono::seconds(60));
+
+	// a thousand of each credential, the clients use the last ones
+	std::string const client_key(32, 'k');
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		std::string key(client_key);
+		key[0] = static_cast<char>(i & 0xff);
+		key[1] = static_cast<char>(i >> 8);
+		authenticator.configure_plain("user" + std::to_string(i), "password");
+		authenticator.configure_curve(zmqpp::z85::encode(key));
+	}
+	authenticator.configure_plain("admin", "password");
+	authenticator.configure_curve(zmqpp::z85::encode(client_key));
+
+	std::atomic<size_t> denied(0);
+	auto client_func = [&context, &mechanism, &client_key, &denied]() {
+		zmqpp::socket client(context, zmqpp::socket_type::dealer);
+		client.connect("inproc://zeromq.zap.01");
+
+		auto send_request = [&]() {
+			zmqpp::message request;
+			request << "" << "1.0" << "1" << "global" << "127.0.0.1" << "" << mechanism;
+			if ("PLAIN" == mechanism)
+				request << "admin" << "password";
+			else if ("CURVE" == mechanism)
+				request.push_back(client_key.data(), client_key.size());
+			client.send(request);
+		};
+
+		size_t sent = 0;
+		for (; sent < zap_window; ++sent)
+			send_request();
+
+		zmqpp::message reply;
+		for (size_t received = 0; received < zap_requests && client.receive(reply); ++received)
+		{
+			if ("200" != reply.get(3))
+				++denied;
+			if (sent < zap_requests)
+			{
+				send_request();
+				++sent;
+			}
+		}
+	};
+
+	auto const start = std::chrono::steady_clock::now();
+	boost::thread_group client_threads;
+	for (size_t i = 0; i < clients; ++i)
+		client_threads.create_thread(client_func);
+	client_threads.join_all();
+	auto const elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	BOOST_CHECK_EQUAL(0, denied);
+
+	size_t const total = zap_requests * clients;
+	BOOST_TEST_MESSAGE("ZAP: " << mechanism << ", " << workers << " workers, " << clients << " clients" << (cached ? ", cached" : ""));
+	BOOST_TEST_MESSAGE("Requests           : " << total);
+	BOOST_TEST_MESSAGE("Run time           : " << elapsed.count() / 1e6 << " seconds");
+	BOOST_TEST_MESSAGE("Requests per second: " << (total * 1e6 / elapsed.count()));
+	BOOST_TEST_MESSAGE("\n");
+}
+
+BOOST_AUTO_TEST_CASE( zap_handler_throughput )
+{
+	for (std::string const mechanism : { "NULL", "PLAIN", "CURVE" })
+	{
+		for (size_t workers = 1; workers <= 4; workers *= 2)
+			zap_throughput(mechanism, workers, 8);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( zap_handler_throughput_cached )
+{
+	for (std::string const mechanism : { "PLAIN", "CURVE" })
+	{
+		zap_throughput(mechanism, 1, 8, false);
+		zap_throughput(mechanism, 1, 8, true);
+	}
+}
+#endif
+
+// Address ranges to load and addresses to look up
+const size_t cidr_ranges = 2e5;
+const size_t cidr_lookups = 1e7;
+
+BOOST_AUTO_TEST_CASE( cidr_set_load_and_lookup )
+{
+	std::mt19937 random(42);
+	auto random_address = [&random]() {
+		zmqpp::cidr_set::address_t address = { { 0 } };
+		address[10] = 0xff;
+		address[11] = 0xff;
+		uint32_t const ipv4 = random();
+		for (size_t i = 0; i < 4; ++i)
+			address[12 + i] = static_cast<uint8_t>(ipv4 >> (24 - 8 * i));
+		return address;
+	};
+
+	zmqpp::cidr_set ranges;
+	auto start = std::chrono::steady_clock::now();
+	ranges.reserve(cidr_ranges);
+	for (size_t i = 0; i < cidr_ranges; ++i)
+		ranges.insert(random_address(), 96 + 16 + random() % 17);
+	auto const loaded = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	std::vector<zmqpp::cidr_set::address_t> addresses;
+	for (size_t i = 0; i < 1024; ++i)
+		addresses.push_back(random_address());
+
+	size_t matched = 0;
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < cidr_lookups; ++i)
+		matched += ranges.contains(addresses[i % addresses.size()]);
+	auto const looked_up = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	BOOST_TEST_MESSAGE("CIDR set: " << cidr_ranges << " random IPv4 ranges, " << ranges.size() << " kept");
+	BOOST_TEST_MESSAGE("Load time          : " << loaded.count() / 1e6 << " seconds");
+	BOOST_TEST_MESSAGE("Lookups            : " << cidr_lookups << ", " << matched << " matched");
+	BOOST_TEST_MESSAGE("Lookups per second : " << (cidr_lookups * 1e6 / looked_up.count()));
+	BOOST_TEST_MESSAGE("\n");
+}
+
+#if (ZMQ_VERSION_MAJOR >= 4)
+// CURVE keys to load and look up
+const size_t curve_keys = 1e6;
+const size_t curve_lookups = 1e7;
+
+BOOST_AUTO_TEST_CASE( curve_key_set_lookup )
+{
+	std::mt19937_64 random(42);
+	std::vector<zmqpp::curve_key_set::key_t> keys(curve_keys);
+	for (zmqpp::curve_key_set::key_t& key : keys)
+	{
+		for (size_t i = 0; i < key.size(); i += 8)
+		{
+			uint64_t const bits = random();
+			std::memcpy(&key[i], &bits, sizeof(bits));
+		}
+	}
+
+	zmqpp::curve_key_set set;
+	auto start = std::chrono::steady_clock::now();
+	set.reserve(curve_keys);
+	for (zmqpp::curve_key_set::key_t const& key : keys)
+		set.insert(key);
+	auto const loaded = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	// half of the keys looked up are unknown
+	size_t found = 0;
+	zmqpp::curve_key_set::key_t unknown = keys[0];
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < curve_lookups; ++i)
+	{
+		zmqpp::curve_key_set::key_t const& key = keys[(i * 7919) % keys.size()];
+		if (i & 1)
+		{
+			unknown[i % unknown.size()] ^= 1;
+			found += set.contains(unknown) ? 1 : 0;
+		}
+		else
+			found += set.contains(key) ? 1 : 0;
+	}
+	auto const looked_up = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	BOOST_TEST_MESSAGE("CURVE key set: " << set.size() << " keys");
+	BOOST_TEST_MESSAGE("Load time          : " << loaded.count() / 1e6 << " seconds");
+	BOOST_TEST_MESSAGE("Lookups            : " << curve_lookups << ", " << found << " found");
+	BOOST_TEST_MESSAGE("Lookups per second : " << (curve_lookups * 1e6 / looked_up.count()));
+	BOOST_TEST_MESSAGE("\n");
+}
+
+// CURVE keys to configure one call at a time and in bulk
+const size_t auth_single_keys = 1e4;
+const size_t auth_bulk_keys = 5e5;
+
+BOOST_AUTO_TEST_CASE( auth_bulk_configure )
+{
+	std::mt19937_64 random(7);
+	std::vector<std::string> keys(auth_bulk_keys);
+	for (std::string& key : keys)
+	{
+		std::string binary(32, '\0');
+		for (size_t i = 0; i < binary.size(); i += 8)
+		{
+			uint64_t const bits = random();
+			std::memcpy(&binary[i], &bits, sizeof(bits));
+		}
+		key = zmqpp::z85::encode(binary);
+	}
+
+	zmqpp::context context;
+	zmqpp::auth single(context);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < auth_single_keys; ++i)
+		single.configure_curve(keys[i]);
+	auto const one_by_one = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	zmqpp::auth bulk(context);
+	start = std::chrono::steady_clock::now();
+	bulk.configure_curve(keys.begin(), keys.end());
+	auto const at_once = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	zmqpp::auth replaced(context);
+	start = std::chrono::steady_clock::now();
+	zmqpp::auth_policy policy;
+	policy.client_keys.reserve(keys.size());
+	for (std::string const& key : keys)
+		policy.configure_curve(key);
+	replaced.configure(std::move(policy));
+	auto const swapped = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	BOOST_TEST_MESSAGE("Auth: configuring CURVE keys");
+	BOOST_TEST_MESSAGE("One call per key   : " << (auth_single_keys * 1e6 / one_by_one.count()) << " keys per second");
+	BOOST_TEST_MESSAGE("One bulk call      : " << (auth_bulk_keys * 1e6 / at_once.count()) << " keys per second");
+	BOOST_TEST_MESSAGE("Policy replaced    : " << (auth_bulk_keys * 1e6 / swapped.count()) << " keys per second");
+	BOOST_TEST_MESSAGE("\n");
+}
+#endif
+
+// Number of actors to start and stop
+const size_t actor_spawns = 1e4;
+
+static void actor_spawn_rate(std::string const& name, zmqpp::actor_executor* executor)
+{
+	auto routine = [](zmqpp::socket* pipe) {
+		pipe->send(zmqpp::signal::ok);
+		pipe->wait();
+		return true;
+	};
+
+	auto const start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < actor_spawns; ++i)
+	{
+		if (executor)
+		{
+			zmqpp::actor actor(*executor, routine);
+			BOOST_REQUIRE(actor.stop(true));
+		}
+		else
+		{
+			zmqpp::actor actor(routine);
+			BOOST_REQUIRE(actor.stop(true));
+		}
+	}
+	auto const elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	BOOST_TEST_MESSAGE(name);
+	BOOST_TEST_MESSAGE("Actors             : " << actor_spawns);
+	BOOST_TEST_MESSAGE("Run time           : " << elapsed.count() / 1e6 << " seconds");
+	BOOST_TEST_MESSAGE("Spawn and stop rate: " << (actor_spawns * 1e6 / elapsed.count()) << " actors per second");
+	BOOST_TEST_MESSAGE("\n");
+}
+
+BOOST_AUTO_TEST_CASE( actor_spawn_rate_thread_per_actor )
+{
+	actor_spawn_rate("Actors: Thread per actor", nullptr);
+}
+
+BOOST_AUTO_TEST_CASE( actor_spawn_rate_executor )
+{
+	zmqpp::actor_executor executor(4);
+	actor_spawn_rate("Actors: Executor with 4 workers", &executor);
+
+	zmqpp::actor::reserve_pipes(actor_spawns);
+	actor_spawn_rate("Actors: Executor with reserved pipes", &executor);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif // LOADTEST
@@ -10,6 +10,10 @@
 #include <boost/test/unit_test.hpp>
 #include <thread>
 #include <exception>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <string>
 
 #include "zmqpp/context.hpp"
 #include "zmqpp/message.hpp"
@@ -219,5 +223,175 @@ BOOST_AUTO_TEST_CASE(remove_socket_in_handler)
     BOOST_CHECK_EQUAL(2, test2);
 }
 
+BOOST_AUTO_TEST_CASE(sub_millisecond_timer)
+{
+    zmqpp::loop loop;
+
+    size_t fired = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point last = start;
+
+    loop.add(std::chrono::microseconds(250), 8, [&fired, &last]() -> bool {
+        last = std::chrono::steady_clock::now();
+        return ++fired < 8;
+    });
+    loop.add(std::chrono::milliseconds(1000), 1, []() -> bool { return false; });
+
+    BOOST_CHECK_NO_THROW(loop.start());
+
+    BOOST_CHECK_EQUAL(8, fired);
+    // eight 250us periods never fire early and should finish well before the safety timer
+    BOOST_CHECK(last - start >= std::chrono::microseconds(2000));
+    BOOST_CHECK(last - start < std::chrono::milliseconds(500));
+}
+
+BOOST_AUTO_TEST_CASE(timers_coalesce_within_slack)
+{
+    zmqpp::loop loop;
+
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point early_fired, late_fired;
+
+    // the early timer may wait for the late one, so both share a wakeup at 25ms
+    loop.add(std::chrono::milliseconds(10), 1, [&early_fired]() -> bool {
+        early_fired = std::chrono::steady_clock::now();
+        return true;
+    }, std::chrono::milliseconds(20));
+    loop.add(std::chrono::milliseconds(25), 1, [&late_fired]() -> bool {
+        late_fired = std::chrono::steady_clock::now();
+        return true;
+    });
+    loop.add(std::chrono::milliseconds(50), 1, []() -> bool { return false; });
+
+    BOOST_CHECK_NO_THROW(loop.start());
+
+    BOOST_CHECK(early_fired - start >= std::chrono::milliseconds(25));
+    BOOST_CHECK(late_fired - early_fired < std::chrono::milliseconds(1));
+}
+
+BOOST_AUTO_TEST_CASE(budgeted_round_robin)
+{
+    zmqpp::context context;
+
+    zmqpp::socket puller1(context, zmqpp::socket_type::pull);
+    puller1.bind("inproc://test1");
+    zmqpp::socket pusher1(context, zmqpp::socket_type::push);
+    pusher1.connect("inproc://test1");
+
+    zmqpp::socket puller2(context, zmqpp::socket_type::pull);
+    puller2.bind("inproc://test2");
+    zmqpp::socket pusher2(context, zmqpp::socket_type::push);
+    pusher2.connect("inproc://test2");
+
+    for (int i = 0; i < 10; ++i)
+    {
+        BOOST_CHECK(pusher1.send("one"));
+        BOOST_CHECK(pusher2.send("two"));
+    }
+
+    zmqpp::loop loop;
+    std::vector<int> order;
+    auto receive_one = [&order](zmqpp::socket *socket, int id) -> bool
+    {
+        std::string message;
+        BOOST_CHECK(socket->receive(message, true));
+        order.push_back(id);
+        return order.size() < 20;
+    };
+
+    loop.add(puller1, std::bind(receive_one, &puller1, 1), zmqpp::poller::poll_in, zmqpp::dispatch_budget(3));
+    loop.add(puller2, std::bind(receive_one, &puller2, 2), zmqpp::poller::poll_in, zmqpp::dispatch_budget(3));
+    loop.add(std::chrono::milliseconds(1000), 1, []() -> bool { return false; });
+
+    BOOST_CHECK_NO_THROW(loop.start());
+    BOOST_REQUIRE_EQUAL(20, order.size());
+
+    // each socket drains at most its budget per wakeup, so both progress evenly
+    BOOST_CHECK_EQUAL(6, std::count(order.begin(), order.begin() + 12, 1));
+    BOOST_CHECK_EQUAL(6, std::count(order.begin(), order.begin() + 12, 2));
+    BOOST_CHECK_EQUAL(10, std::count(order.begin(), order.end(), 1));
+}
+
+BOOST_AUTO_TEST_CASE(registration_churn_in_handler)
+{
+    zmqpp::context context;
+
+    std::vector<std::unique_ptr<zmqpp::socket>> pullers;
+    std::vector<std::unique_ptr<zmqpp::socket>> pushers;
+    for (int i = 0; i < 3; ++i)
+    {
+        std::string const endpoint = "inproc://test" + std::to_string(i);
+        pullers.emplace_back(new zmqpp::socket(context, zmqpp::socket_type::pull));
+        pullers.back()->bind(endpoint);
+        pushers.emplace_back(new zmqpp::socket(context, zmqpp::socket_type::push));
+        pushers.back()->connect(endpoint);
+        BOOST_CHECK(pushers.back()->send("hello"));
+    }
+
+    zmqpp::loop loop;
+    std::vector<int> calls;
+    auto receive = [&](int id) -> bool
+    {
+        std::string message;
+        BOOST_CHECK(pullers[id]->receive(message, true));
+        calls.push_back(id);
+        return id != 2;
+    };
+
+    // the first handler drops both registrations, including a ready one not yet
+    // dispatched, and adds a third which must still be served
+    loop.add(*pullers[0], [&]() -> bool {
+        loop.remove(*pullers[0]);
+        loop.remove(*pullers[1]);
+        loop.add(*pullers[2], std::bind(receive, 2));
+        return receive(0);
+    });
+    loop.add(*pullers[1], std::bind(receive, 1));
+    loop.add(std::chrono::milliseconds(1000), 1, []() -> bool { return false; });
+
+    BOOST_CHECK_NO_THROW(loop.start());
+
+    BOOST_REQUIRE_EQUAL(2, calls.size());
+    BOOST_CHECK_EQUAL(0, calls[0]);
+    BOOST_CHECK_EQUAL(2, calls[1]);
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE(post_from_other_threads)
+{
+    zmqpp::loop loop;
+
+    const size_t producers = 4;
+    const size_t posts_per_producer = 1000;
+    size_t handled = 0;
+    std::thread::id loop_thread;
+
+    loop.add(std::chrono::milliseconds(5000), 1, []() -> bool { return false; });
+    loop.add(std::chrono::milliseconds(0), 1, [&loop_thread]() -> bool {
+        loop_thread = std::this_thread::get_id();
+        return true;
+    });
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (size_t j = 0; j < posts_per_producer; ++j)
+            {
+                loop.post([&]() -> bool {
+                    BOOST_CHECK(std::this_thread::get_id() == loop_thread);
+                    return ++handled < producers * posts_per_producer;
+                });
+            }
+        });
+    }
+
+    BOOST_CHECK_NO_THROW(loop.start());
+    for (std::thread &thread : threads)
+        thread.join();
+
+    BOOST_CHECK_EQUAL(producers * posts_per_producer, handled);
+}
+#endif
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,205 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zmqpp/context.hpp"
+#include "zmqpp/exception.hpp"
+#include "zmqpp/loop_group.hpp"
+#include "zmqpp/socket.hpp"
+
+#ifndef _WIN32
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+BOOST_AUTO_TEST_SUITE( loop_group )
+
+BOOST_AUTO_TEST_CASE(posts_run_on_shard_threads)
+{
+    zmqpp::loop_group group(4);
+    BOOST_CHECK_EQUAL(4, group.size());
+
+    std::mutex mutex;
+    std::vector<std::set<std::thread::id>> seen(group.size());
+    std::atomic<size_t> handled(0);
+
+    for (size_t i = 0; i < 100; ++i)
+    {
+        size_t const shard = i % group.size();
+        group.post(shard, [&, shard]() -> bool {
+            std::lock_guard<std::mutex> lock(mutex);
+            seen[shard].insert(std::this_thread::get_id());
+            ++handled;
+            return true;
+        });
+    }
+
+    BOOST_CHECK_NO_THROW(group.stop());
+    BOOST_CHECK_EQUAL(100, handled.load());
+
+    // each shard is served by exactly one thread, none of them this one
+    std::set<std::thread::id> threads;
+    for (std::set<std::thread::id> const& ids : seen)
+    {
+        BOOST_REQUIRE_EQUAL(1, ids.size());
+        threads.insert(*ids.begin());
+    }
+    BOOST_CHECK_EQUAL(4, threads.size());
+    BOOST_CHECK(threads.count(std::this_thread::get_id()) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(assignment)
+{
+    zmqpp::loop_group group(3);
+
+    for (size_t i = 0; i < 9; ++i)
+        group.assign();
+    for (size_t i = 0; i < group.size(); ++i)
+        BOOST_CHECK_EQUAL(3, group.load(i));
+
+    group.release(1);
+    BOOST_CHECK_EQUAL(1, group.assign());
+
+    size_t const shard = group.assign(std::string("client-42"));
+    BOOST_CHECK_EQUAL(shard, group.assign(std::string("client-42")));
+    BOOST_CHECK_EQUAL(5, group.load(shard));
+}
+
+BOOST_AUTO_TEST_CASE(sockets_owned_by_shards)
+{
+    zmqpp::context context;
+    zmqpp::loop_group group(2);
+
+    size_t const messages = 10;
+    std::vector<std::unique_ptr<zmqpp::socket>> pullers(group.size());
+    std::vector<size_t> received(group.size(), 0);
+    std::atomic<size_t> bound(0);
+    std::atomic<size_t> done(0);
+
+    // sockets are created, used and closed on their shard's thread only
+    for (size_t shard = 0; shard < group.size(); ++shard)
+    {
+        group.post(shard, [&, shard]() -> bool {
+            pullers[shard].reset(new zmqpp::socket(context, zmqpp::socket_type::pull));
+            pullers[shard]->bind("inproc://shard" + std::to_string(shard));
+            group.at(shard).add(*pullers[shard], [&, shard]() -> bool {
+                std::string message;
+                BOOST_CHECK(pullers[shard]->receive(message));
+                if (++received[shard] == messages)
+                {
+                    group.at(shard).remove(*pullers[shard]);
+                    pullers[shard].reset();
+                    ++done;
+                }
+                return true;
+            });
+            ++bound;
+            return true;
+        });
+    }
+
+    while (bound < group.size())
+        std::this_thread::yield();
+
+    for (size_t shard = 0; shard < group.size(); ++shard)
+    {
+        zmqpp::socket pusher(context, zmqpp::socket_type::push);
+        pusher.connect("inproc://shard" + std::to_string(shard));
+        for (size_t i = 0; i < messages; ++i)
+            BOOST_CHECK(pusher.send("hello"));
+    }
+
+    while (done < group.size())
+        std::this_thread::yield();
+
+    BOOST_CHECK_NO_THROW(group.stop());
+    for (size_t shard = 0; shard < group.size(); ++shard)
+        BOOST_CHECK_EQUAL(messages, received[shard]);
+}
+
+#if defined(__linux__)
+BOOST_AUTO_TEST_CASE(shards_apply_placement)
+{
+    cpu_set_t allowed;
+    BOOST_REQUIRE_EQUAL(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+    unsigned int cpu = 0;
+    while (!CPU_ISSET(cpu, &allowed))
+        ++cpu;
+
+    std::vector<zmqpp::thread_placement> placements(2);
+    placements[0].add_cpu(cpu).set_name("zmqpp-shard-0");
+    placements[1].set_name("zmqpp-shard-1");
+    zmqpp::loop_group group(placements);
+
+    std::vector<std::string> names(group.size());
+    cpu_set_t placed;
+    CPU_ZERO(&placed);
+    for (size_t shard = 0; shard < group.size(); ++shard)
+    {
+        group.post(shard, [&, shard]() -> bool {
+            char name[16] = { 0 };
+            pthread_getname_np(pthread_self(), name, sizeof(name));
+            names[shard] = name;
+            if (0 == shard)
+                sched_getaffinity(0, sizeof(placed), &placed);
+            return true;
+        });
+    }
+
+    BOOST_CHECK_NO_THROW(group.stop());
+    BOOST_CHECK_EQUAL("zmqpp-shard-0", names[0]);
+    BOOST_CHECK_EQUAL("zmqpp-shard-1", names[1]);
+    BOOST_CHECK_EQUAL(1, CPU_COUNT(&placed));
+    BOOST_CHECK(CPU_ISSET(cpu, &placed));
+
+    // a cpu that can't be used stops the shard, the error surfaces on stop
+    std::vector<zmqpp::thread_placement> invalid(1);
+    invalid[0].add_cpu(CPU_SETSIZE);
+    zmqpp::loop_group failed(invalid);
+    BOOST_CHECK_THROW(failed.stop(), zmqpp::exception);
+}
+
+BOOST_AUTO_TEST_CASE(shards_from_topology)
+{
+    zmqpp::thread_topology topology;
+    topology.set_actors(zmqpp::thread_placement().set_name("zmqpp-actor"))
+        .add_shard(zmqpp::thread_placement().set_name("zmqpp-shard-0"))
+        .add_shard(zmqpp::thread_placement().set_name("zmqpp-shard-1"));
+    BOOST_CHECK_EQUAL("zmqpp-actor", topology.get_actors().get_name());
+
+    zmqpp::loop_group group(topology);
+    BOOST_REQUIRE_EQUAL(2, group.size());
+
+    std::string name;
+    group.post(1, [&name]() -> bool {
+        char buffer[16] = { 0 };
+        pthread_getname_np(pthread_self(), buffer, sizeof(buffer));
+        name = buffer;
+        return true;
+    });
+    BOOST_CHECK_NO_THROW(group.stop());
+    BOOST_CHECK_EQUAL("zmqpp-shard-1", name);
+
+    BOOST_CHECK_THROW(zmqpp::loop_group empty((zmqpp::thread_topology())), zmqpp::exception);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,92 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <thread>
+
+#include "zmqpp/loop.hpp"
+#include "zmqpp/loop_metrics.hpp"
+
+BOOST_AUTO_TEST_SUITE( loop_metrics )
+
+BOOST_AUTO_TEST_CASE(histogram_percentiles)
+{
+    zmqpp::latency_histogram histogram;
+    BOOST_CHECK_EQUAL(0, histogram.snapshot().total());
+    BOOST_CHECK(std::chrono::nanoseconds::zero() == histogram.snapshot().percentile(0.5));
+
+    for (int i = 1; i <= 1000; ++i)
+        histogram.record(std::chrono::microseconds(i));
+    histogram.record(std::chrono::nanoseconds(-5));
+
+    zmqpp::histogram_snapshot const snapshot = histogram.snapshot();
+    BOOST_CHECK_EQUAL(1001, snapshot.total());
+    BOOST_CHECK(std::chrono::microseconds(1000) == snapshot.max());
+    BOOST_CHECK(std::chrono::microseconds(1000) == snapshot.percentile(1.0));
+
+    // never under reported, never more than a bucket width over
+    std::chrono::nanoseconds const median = snapshot.percentile(0.5);
+    BOOST_CHECK(median >= std::chrono::microseconds(500));
+    BOOST_CHECK(median <= std::chrono::microseconds(563));
+
+    std::chrono::nanoseconds const tail = snapshot.percentile(0.99);
+    BOOST_CHECK(tail >= std::chrono::microseconds(990));
+    BOOST_CHECK(tail <= std::chrono::microseconds(1000));
+}
+
+BOOST_AUTO_TEST_CASE(histogram_bucket_bounds)
+{
+    // every value lands in the first bucket whose bound covers it
+    uint64_t previous = 0;
+    for (size_t bucket = 1; bucket < zmqpp::latency_histogram::bucket_count; ++bucket)
+    {
+        uint64_t const bound = zmqpp::latency_histogram::bucket_upper_bound(bucket);
+        BOOST_REQUIRE(bound > previous);
+        previous = bound;
+    }
+    BOOST_CHECK_EQUAL(UINT64_MAX, previous);
+
+    zmqpp::latency_histogram histogram;
+    histogram.record(std::chrono::nanoseconds(1024));
+    BOOST_CHECK(std::chrono::nanoseconds(1024) == histogram.snapshot().percentile(0.5));
+}
+
+#ifdef ZMQPP_LOOP_METRICS
+BOOST_AUTO_TEST_CASE(loop_records_timers_and_posts)
+{
+    zmqpp::loop loop;
+    std::shared_ptr<zmqpp::loop_metrics const> metrics = loop.metrics();
+
+    loop.add(std::chrono::milliseconds(1), 1, []() -> bool {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        return true;
+    });
+    loop.add(std::chrono::milliseconds(10), 1, []() -> bool { return false; });
+    loop.post([]() -> bool { return true; });
+
+    loop.start();
+
+    BOOST_CHECK(metrics->iterations.load() >= 2);
+    BOOST_CHECK(metrics->poll_wait.snapshot().total() >= 2);
+    BOOST_CHECK_EQUAL(1, metrics->posted_callbacks.snapshot().total());
+    BOOST_CHECK_EQUAL(2, metrics->timer_callbacks.snapshot().total());
+    BOOST_CHECK_EQUAL(2, metrics->timer_lateness.snapshot().total());
+    BOOST_CHECK(metrics->timer_callbacks.snapshot().max() >= std::chrono::milliseconds(2));
+}
+#else
+BOOST_AUTO_TEST_CASE(loop_without_metrics)
+{
+    zmqpp::loop loop;
+    BOOST_CHECK(nullptr == loop.metrics());
+    BOOST_CHECK(nullptr == loop.callback_latency(zmqpp::raw_socket_t(0)));
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -14,7 +14,15 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 #include "zmqpp/context.hpp"
+#include "zmqpp/exception.hpp"
 #include "zmqpp/message.hpp"
 #include "zmqpp/poller.hpp"
 #include "zmqpp/socket.hpp"
@@ -231,4 +239,77 @@ BOOST_AUTO_TEST_CASE(poller_remove_fd)
     poller.remove(fd);
 }
 
+BOOST_AUTO_TEST_CASE( spin_then_block )
+{
+	zmqpp::context context;
+
+	zmqpp::socket puller(context, zmqpp::socket_type::pull);
+	puller.bind("inproc://test");
+
+	zmqpp::socket pusher(context, zmqpp::socket_type::push);
+	pusher.connect("inproc://test");
+
+	zmqpp::poller poller;
+	poller.set_spin_policy(zmqpp::poller::spin_policy(std::chrono::microseconds(200), false));
+	poller.add(puller);
+
+	// nothing arrives, spin runs out then the blocking poll times out
+	BOOST_CHECK(!poller.poll(1));
+
+	// arrives after the spin, picked up by the blocking poll
+	std::thread late([&pusher]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		pusher.send("late");
+	});
+	BOOST_CHECK(poller.poll(max_poll_timeout));
+	BOOST_CHECK(poller.has_input(puller));
+	late.join();
+
+	std::string message;
+	BOOST_CHECK(puller.receive(message));
+	BOOST_CHECK_EQUAL("late", message);
+
+	// already waiting, picked up while spinning
+	pusher.send("early");
+	BOOST_CHECK(poller.poll(max_poll_timeout));
+	BOOST_CHECK(poller.has_input(puller));
+	BOOST_CHECK(puller.receive(message));
+	BOOST_CHECK_EQUAL("early", message);
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE( spin_checks_standard_sockets )
+{
+	zmqpp::context context;
+	zmqpp::socket puller(context, zmqpp::socket_type::pull);
+	puller.bind("inproc://test");
+
+	// nothing is ever written, only the check says the pipe is readable
+	int pipe_fds[2];
+	BOOST_REQUIRE_EQUAL(0, pipe(pipe_fds));
+	const int fd = pipe_fds[0];
+	bool signalled = false;
+
+	zmqpp::poller poller;
+	poller.set_spin_policy(zmqpp::poller::spin_policy(std::chrono::milliseconds(50), false));
+	poller.add(puller);
+	poller.add(fd);
+	BOOST_CHECK_THROW(poller.set_spin_check(pipe_fds[1], []() { return true; }), zmqpp::exception);
+	poller.set_spin_check(fd, [&signalled]() { return signalled; });
+
+	signalled = true;
+	BOOST_CHECK(poller.poll(max_poll_timeout));
+	BOOST_CHECK(poller.has_input(fd));
+	BOOST_CHECK(!poller.has_input(puller));
+
+	// a removed descriptor takes its check along
+	poller.remove(fd);
+	poller.add(fd);
+	poller.set_spin_check(fd, std::function<bool (void)>());
+
+	close(pipe_fds[0]);
+	close(pipe_fds[1]);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
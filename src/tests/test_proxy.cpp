@@ -10,8 +10,12 @@
 #include <boost/test/unit_test.hpp>
 #include <thread>
 #include "zmqpp/context.hpp"
+#include "zmqpp/exception.hpp"
 #include "zmqpp/message.hpp"
 #include "zmqpp/proxy.hpp"
+#include "zmqpp/proxy_controller.hpp"
+#include "zmqpp/proxy_engine.hpp"
+#include "zmqpp/proxy_steerable.hpp"
 
 BOOST_AUTO_TEST_SUITE( proxy )
 
@@ -52,4 +56,255 @@ BOOST_AUTO_TEST_CASE(simple_direction)
   t1.join();
 }
 
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE(engine_forwards_both_ways)
+{
+  zmqpp::context ctx;
+
+  zmqpp::socket frontend(ctx, zmqpp::socket_type::pair);
+  zmqpp::socket backend(ctx, zmqpp::socket_type::pair);
+  frontend.bind("inproc://engine-frontend");
+  backend.bind("inproc://engine-backend");
+
+  zmqpp::socket client(ctx, zmqpp::socket_type::pair);
+  zmqpp::socket worker(ctx, zmqpp::socket_type::pair);
+  client.connect("inproc://engine-frontend");
+  worker.connect("inproc://engine-backend");
+
+  zmqpp::proxy_engine engine(frontend, backend);
+  engine.set_batch_size(4);
+  std::thread t([&]() { engine.run(); });
+
+  for (int i = 0; i < 10; ++i)
+  {
+    zmqpp::message request;
+    request << "request" << i;
+    BOOST_REQUIRE(client.send(request));
+
+    zmqpp::message received;
+    BOOST_REQUIRE(worker.receive(received));
+    BOOST_REQUIRE_EQUAL(2, received.parts());
+    BOOST_CHECK_EQUAL(i, received.get<int>(1));
+    BOOST_REQUIRE(worker.send("reply"));
+
+    std::string reply;
+    BOOST_REQUIRE(client.receive(reply));
+    BOOST_CHECK_EQUAL("reply", reply);
+  }
+
+  engine.stop();
+  t.join();
+
+  zmqpp::proxy_counters const forward = engine.counters(zmqpp::proxy_engine::direction::frontend_to_backend);
+  BOOST_CHECK_EQUAL(10, forward.messages_received);
+  BOOST_CHECK_EQUAL(10, forward.messages_sent);
+  BOOST_CHECK_EQUAL(10 * (7 + sizeof(int)), forward.bytes_sent);
+
+  zmqpp::proxy_counters const back = engine.counters(zmqpp::proxy_engine::direction::backend_to_frontend);
+  BOOST_CHECK_EQUAL(10, back.messages_sent);
+  BOOST_CHECK_EQUAL(10 * 5, back.bytes_sent);
+}
+
+BOOST_AUTO_TEST_CASE(engine_hooks_drop_and_rewrite)
+{
+  zmqpp::context ctx;
+
+  zmqpp::socket frontend(ctx, zmqpp::socket_type::pull);
+  zmqpp::socket backend(ctx, zmqpp::socket_type::push);
+  zmqpp::socket capture(ctx, zmqpp::socket_type::push);
+  frontend.bind("inproc://hooked-frontend");
+  backend.bind("inproc://hooked-backend");
+  capture.bind("inproc://hooked-capture");
+
+  zmqpp::socket pusher(ctx, zmqpp::socket_type::push);
+  zmqpp::socket puller(ctx, zmqpp::socket_type::pull);
+  zmqpp::socket captured(ctx, zmqpp::socket_type::pull);
+  pusher.connect("inproc://hooked-frontend");
+  puller.connect("inproc://hooked-backend");
+  captured.connect("inproc://hooked-capture");
+
+  zmqpp::proxy_engine engine(frontend, backend);
+  engine.set_capture(capture);
+  engine.set_hook(zmqpp::proxy_engine::direction::frontend_to_backend, [](zmqpp::message& msg) -> bool {
+    if (msg.get(0) == "drop")
+      return false;
+    msg << "seen";
+    return true;
+  });
+  std::thread t([&]() { engine.run(); });
+
+  BOOST_REQUIRE(pusher.send("drop"));
+  BOOST_REQUIRE(pusher.send("keep"));
+
+  zmqpp::message received;
+  BOOST_REQUIRE(puller.receive(received));
+  BOOST_REQUIRE_EQUAL(2, received.parts());
+  BOOST_CHECK_EQUAL("keep", received.get(0));
+  BOOST_CHECK_EQUAL("seen", received.get(1));
+
+  // the capture sees traffic as it arrived, before the hook
+  std::string copy;
+  BOOST_REQUIRE(captured.receive(copy));
+  BOOST_CHECK_EQUAL("drop", copy);
+  BOOST_REQUIRE(captured.receive(copy));
+  BOOST_CHECK_EQUAL("keep", copy);
+
+  engine.stop();
+  t.join();
+
+  zmqpp::proxy_counters const forward = engine.counters(zmqpp::proxy_engine::direction::frontend_to_backend);
+  BOOST_CHECK_EQUAL(2, forward.messages_received);
+  BOOST_CHECK_EQUAL(1, forward.messages_sent);
+}
+
+BOOST_AUTO_TEST_CASE(engine_takes_controller_commands)
+{
+  zmqpp::context ctx;
+
+  zmqpp::socket frontend(ctx, zmqpp::socket_type::pull);
+  zmqpp::socket backend(ctx, zmqpp::socket_type::push);
+  zmqpp::socket control(ctx, zmqpp::socket_type::rep);
+  frontend.bind("inproc://controlled-frontend");
+  backend.bind("inproc://controlled-backend");
+  control.bind("inproc://controlled-control");
+
+  zmqpp::socket pusher(ctx, zmqpp::socket_type::push);
+  zmqpp::socket puller(ctx, zmqpp::socket_type::pull);
+  zmqpp::socket commands(ctx, zmqpp::socket_type::req);
+  pusher.connect("inproc://controlled-frontend");
+  puller.connect("inproc://controlled-backend");
+  commands.connect("inproc://controlled-control");
+
+  zmqpp::proxy_engine engine(frontend, backend);
+  engine.set_control(control);
+  std::thread t([&]() { engine.run(); });
+
+  zmqpp::proxy_controller controller(commands);
+  zmqpp::proxy_sampler sampler(controller);
+
+  BOOST_REQUIRE(pusher.send("first"));
+  std::string received;
+  BOOST_REQUIRE(puller.receive(received));
+  BOOST_CHECK_EQUAL("first", received);
+
+  // nothing is forwarded while paused
+  controller.pause();
+  BOOST_REQUIRE(pusher.send("second"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BOOST_CHECK(!puller.receive(received, true));
+
+  controller.resume();
+  BOOST_REQUIRE(puller.receive(received));
+  BOOST_CHECK_EQUAL("second", received);
+
+  zmqpp::proxy_stats const stats = controller.statistics();
+  BOOST_CHECK_EQUAL(2, stats.frontend.messages_in);
+  BOOST_CHECK_EQUAL(11, stats.frontend.bytes_in);
+  BOOST_CHECK_EQUAL(0, stats.frontend.messages_out);
+  BOOST_CHECK_EQUAL(0, stats.backend.messages_in);
+  BOOST_CHECK_EQUAL(2, stats.backend.messages_out);
+  BOOST_CHECK_EQUAL(11, stats.backend.bytes_out);
+
+  zmqpp::proxy_rates const rates = sampler.sample();
+  BOOST_CHECK(rates.period.count() > 0);
+  BOOST_CHECK(rates.frontend.messages_in > 0);
+  BOOST_CHECK_EQUAL(0, rates.backend.messages_in);
+  BOOST_CHECK_EQUAL(2, sampler.last().backend.messages_out);
+
+  controller.terminate();
+  t.join();
+}
+
+BOOST_AUTO_TEST_CASE(sampler_watches_from_a_loop)
+{
+  zmqpp::context ctx;
+
+  zmqpp::socket frontend(ctx, zmqpp::socket_type::pull);
+  zmqpp::socket backend(ctx, zmqpp::socket_type::push);
+  zmqpp::socket control(ctx, zmqpp::socket_type::pair);
+  frontend.bind("inproc://sampled-frontend");
+  backend.bind("inproc://sampled-backend");
+  control.bind("inproc://sampled-control");
+
+  zmqpp::socket commands(ctx, zmqpp::socket_type::pair);
+  commands.connect("inproc://sampled-control");
+
+  zmqpp::proxy_engine engine(frontend, backend);
+  engine.set_control(control);
+  std::thread t([&]() { engine.run(); });
+
+  zmqpp::proxy_controller controller(commands);
+  zmqpp::proxy_sampler sampler(controller);
+
+  zmqpp::loop loop;
+  int samples = 0;
+  sampler.watch(loop, std::chrono::milliseconds(10), [&samples](zmqpp::proxy_rates const& rates) {
+    BOOST_CHECK(rates.period.count() > 0);
+    return ++samples < 3;
+  });
+  loop.start();
+  BOOST_CHECK_EQUAL(3, samples);
+
+  controller.terminate();
+  t.join();
+}
+
+BOOST_AUTO_TEST_CASE(statistics_encoding)
+{
+  zmqpp::proxy_stats stats = { { 1, 2, 3, 4 }, { 5, 6, 7, 8 } };
+
+  zmqpp::message reply;
+  zmqpp::proxy_controller::encode(stats, reply);
+  BOOST_REQUIRE_EQUAL(8, reply.parts());
+
+  zmqpp::proxy_stats const decoded = zmqpp::proxy_controller::decode(reply);
+  BOOST_CHECK_EQUAL(1, decoded.frontend.messages_in);
+  BOOST_CHECK_EQUAL(4, decoded.frontend.bytes_out);
+  BOOST_CHECK_EQUAL(5, decoded.backend.messages_in);
+  BOOST_CHECK_EQUAL(8, decoded.backend.bytes_out);
+
+  reply.pop_back();
+  BOOST_CHECK_THROW(zmqpp::proxy_controller::decode(reply), zmqpp::exception);
+}
+#endif
+
+#if (ZMQ_VERSION_MAJOR >= 4)
+BOOST_AUTO_TEST_CASE(steerable_takes_controller_commands)
+{
+  zmqpp::context ctx;
+
+  std::thread t([&]()
+                {
+                  zmqpp::socket sa(ctx, zmqpp::socket_type::pull);
+                  zmqpp::socket sb(ctx, zmqpp::socket_type::push);
+                  zmqpp::socket control(ctx, zmqpp::socket_type::pair);
+                  sa.bind("inproc://steered-frontend");
+                  sb.bind("inproc://steered-backend");
+                  control.bind("inproc://steered-control");
+                  zmqpp::proxy_steerable p(sa, sb, control);
+                });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  zmqpp::socket pusher(ctx, zmqpp::socket_type::push);
+  zmqpp::socket puller(ctx, zmqpp::socket_type::pull);
+  zmqpp::socket commands(ctx, zmqpp::socket_type::pair);
+  pusher.connect("inproc://steered-frontend");
+  puller.connect("inproc://steered-backend");
+  commands.connect("inproc://steered-control");
+
+  zmqpp::proxy_controller controller(commands);
+  controller.pause();
+  controller.resume();
+
+  BOOST_REQUIRE(pusher.send("Hello"));
+  std::string ret;
+  BOOST_REQUIRE(puller.receive(ret));
+  BOOST_CHECK_EQUAL("Hello", ret);
+
+  controller.terminate();
+  t.join();
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
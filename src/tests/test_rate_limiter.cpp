@@ -0,0 +1,230 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <string>
+
+#include "zmqpp/context.hpp"
+#include "zmqpp/exception.hpp"
+#include "zmqpp/message.hpp"
+#include "zmqpp/rate_limiter.hpp"
+#include "zmqpp/socket.hpp"
+
+BOOST_AUTO_TEST_SUITE( rate_limiter )
+
+namespace
+{
+    zmqpp::rate_limit messages(double const per_second, double const burst)
+    {
+        zmqpp::rate_limit limit = { per_second, burst, 0, 0 };
+        return limit;
+    }
+
+    zmqpp::rate_limit bytes(double const per_second, double const burst)
+    {
+        zmqpp::rate_limit limit = { 0, 0, per_second, burst };
+        return limit;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(burst_then_steady_rate)
+{
+    zmqpp::rate_limiter limiter(messages(10, 5));
+    zmqpp::rate_limiter::clock::time_point const start = zmqpp::rate_limiter::clock::now();
+    limiter.tick(start);
+
+    for (int i = 0; i < 5; ++i)
+    {
+        BOOST_CHECK(limiter.admit("", 1));
+    }
+    BOOST_CHECK(!limiter.admit("", 1));
+
+    std::chrono::nanoseconds const delay = limiter.delay("", 1);
+    BOOST_CHECK(delay > std::chrono::milliseconds(99));
+    BOOST_CHECK(delay <= std::chrono::milliseconds(101));
+
+    limiter.tick(start + std::chrono::milliseconds(100));
+    BOOST_CHECK(limiter.admit("", 1));
+    BOOST_CHECK(!limiter.admit("", 1));
+
+    // refills stop at the burst size
+    limiter.tick(start + std::chrono::seconds(10));
+    for (int i = 0; i < 5; ++i)
+    {
+        BOOST_CHECK(limiter.admit("", 1));
+    }
+    BOOST_CHECK(!limiter.admit("", 1));
+}
+
+BOOST_AUTO_TEST_CASE(byte_limit_lets_large_messages_through_in_debt)
+{
+    zmqpp::rate_limiter limiter(bytes(1000, 100));
+    zmqpp::rate_limiter::clock::time_point const start = zmqpp::rate_limiter::clock::now();
+    limiter.tick(start);
+
+    BOOST_CHECK(limiter.admit("", 60));
+    BOOST_CHECK(!limiter.admit("", 60));
+    limiter.tick(start + std::chrono::milliseconds(20));
+    BOOST_CHECK(limiter.admit("", 60));
+
+    // larger than the burst, let through once the bucket is full then repaid
+    limiter.tick(start + std::chrono::seconds(1));
+    BOOST_CHECK(limiter.admit("", 500));
+    limiter.tick(start + std::chrono::milliseconds(1300));
+    BOOST_CHECK(!limiter.admit("", 1));
+    limiter.tick(start + std::chrono::milliseconds(1402));
+    BOOST_CHECK(limiter.admit("", 1));
+}
+
+BOOST_AUTO_TEST_CASE(keys_have_their_own_buckets)
+{
+    zmqpp::rate_limiter limiter(messages(1, 1));
+    limiter.set_limit("busy", messages(1, 3));
+    limiter.tick();
+
+    BOOST_CHECK(limiter.admit("first", 10));
+    BOOST_CHECK(!limiter.admit("first", 10));
+    BOOST_CHECK(limiter.admit("second", 10));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        BOOST_CHECK(limiter.admit("busy", 10));
+    }
+    BOOST_CHECK(!limiter.admit("busy", 10));
+    BOOST_CHECK_EQUAL(3, limiter.keys());
+
+    // a forgotten key starts over with a full bucket
+    limiter.forget("first");
+    BOOST_CHECK_EQUAL(2, limiter.keys());
+    BOOST_CHECK(limiter.admit("first", 10));
+}
+
+#if (ZMQ_VERSION_MAJOR > 3) || ((ZMQ_VERSION_MAJOR == 3) && (ZMQ_VERSION_MINOR >= 2))
+BOOST_AUTO_TEST_CASE(proxy_hook_limits_each_route)
+{
+    zmqpp::rate_limiter limiter(messages(1, 2));
+    limiter.tick();
+    zmqpp::proxy_engine::Hook hook = limiter.hook(zmqpp::overflow_policy::drop, true);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        zmqpp::message msg;
+        msg << "peer-a" << "request";
+        BOOST_CHECK(hook(msg));
+    }
+
+    zmqpp::message over;
+    over << "peer-a" << "request";
+    BOOST_CHECK(!hook(over));
+
+    zmqpp::message other;
+    other << "peer-b" << "request";
+    BOOST_CHECK(hook(other));
+
+    BOOST_CHECK_THROW(limiter.hook(zmqpp::overflow_policy::queue, true), zmqpp::exception);
+}
+
+BOOST_AUTO_TEST_CASE(proxy_hook_drops_idle_routes)
+{
+    zmqpp::rate_limiter limiter(messages(1000, 1));
+    zmqpp::rate_limiter::clock::time_point now = zmqpp::rate_limiter::clock::now();
+    zmqpp::proxy_engine::Hook hook = limiter.hook(zmqpp::overflow_policy::drop, true);
+
+    // a new identity for every reconnect, each idle long enough to refill
+    for (int i = 0; i < 10000; ++i)
+    {
+        now += std::chrono::milliseconds(1);
+        limiter.tick(now);
+
+        zmqpp::message msg;
+        msg << ("peer-" + std::to_string(i)) << "request";
+        BOOST_CHECK(hook(msg));
+    }
+    BOOST_CHECK(limiter.keys() <= 128);
+
+    // a route still in debt is kept through the sweeps
+    limiter.set_limit("slow", messages(1, 1));
+    zmqpp::message slow;
+    slow << "slow" << "request";
+    BOOST_CHECK(hook(slow));
+    for (int i = 0; i < 1000; ++i)
+    {
+        now += std::chrono::microseconds(100);
+        limiter.tick(now);
+
+        zmqpp::message msg;
+        msg << ("late-" + std::to_string(i)) << "request";
+        BOOST_CHECK(hook(msg));
+    }
+    zmqpp::message again;
+    again << "slow" << "request";
+    BOOST_CHECK(!hook(again));
+    BOOST_CHECK(limiter.keys() <= 128);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(shaped_socket_drops_or_queues)
+{
+    zmqpp::context context;
+    zmqpp::socket sender(context, zmqpp::socket_type::pair);
+    zmqpp::socket receiver(context, zmqpp::socket_type::pair);
+    sender.bind("inproc://shaped");
+    receiver.connect("inproc://shaped");
+
+    zmqpp::rate_limiter limiter(messages(1, 1));
+    zmqpp::rate_limiter::clock::time_point const start = zmqpp::rate_limiter::clock::now();
+    limiter.tick(start);
+
+    zmqpp::shaped_socket dropping(sender, limiter, zmqpp::overflow_policy::drop);
+    zmqpp::message first;
+    first << "first";
+    BOOST_CHECK(dropping.send(first));
+    zmqpp::message dropped;
+    dropped << "dropped";
+    BOOST_CHECK(!dropping.send(dropped));
+
+    zmqpp::shaped_socket queueing(sender, limiter, zmqpp::overflow_policy::queue, 2);
+    for (int i = 0; i < 3; ++i)
+    {
+        zmqpp::message msg;
+        msg << i;
+        BOOST_CHECK_EQUAL(i < 2, queueing.send(msg));
+    }
+    BOOST_CHECK_EQUAL(2, queueing.queued());
+    BOOST_CHECK(queueing.next_flush() > std::chrono::milliseconds(900));
+
+    // another key isn't held up by the first
+    zmqpp::message other;
+    other << "other";
+    BOOST_CHECK(queueing.send(other, "other"));
+    BOOST_CHECK_EQUAL(2, queueing.queued());
+
+    BOOST_CHECK_EQUAL(0, queueing.flush());
+    limiter.tick(start + std::chrono::seconds(1));
+    BOOST_CHECK_EQUAL(1, queueing.flush());
+    limiter.tick(start + std::chrono::seconds(2));
+    BOOST_CHECK_EQUAL(1, queueing.flush());
+    BOOST_CHECK_EQUAL(0, queueing.queued());
+
+    std::string text;
+    BOOST_REQUIRE(receiver.receive(text));
+    BOOST_CHECK_EQUAL("first", text);
+    BOOST_REQUIRE(receiver.receive(text));
+    BOOST_CHECK_EQUAL("other", text);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        zmqpp::message msg;
+        BOOST_REQUIRE(receiver.receive(msg));
+        BOOST_CHECK_EQUAL(i, msg.get<int>(0));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -168,5 +168,92 @@ BOOST_AUTO_TEST_CASE(remove_socket_in_handler)
     BOOST_CHECK_EQUAL(2, test2);
 }
 
+BOOST_AUTO_TEST_CASE(replace_handler_in_handler)
+{
+    zmqpp::context context;
+
+    zmqpp::socket puller(context, zmqpp::socket_type::pull);
+    puller.bind("inproc://test");
+
+    zmqpp::socket pusher(context, zmqpp::socket_type::push);
+    pusher.connect("inproc://test");
+
+    zmqpp::reactor reactor;
+    int first = 0;
+    int second = 0;
+    reactor.add(puller, [&]() -> void
+    {
+        std::string message;
+        BOOST_CHECK(puller.receive(message));
+        ++first;
+
+        reactor.remove(puller);
+        BOOST_CHECK(!reactor.has(puller));
+        reactor.add(puller, [&]() -> void
+        {
+            std::string message;
+            BOOST_CHECK(puller.receive(message));
+            ++second;
+        });
+    });
+
+    BOOST_CHECK(pusher.send("hello world!"));
+    BOOST_CHECK(reactor.poll(max_poll_timeout));
+    BOOST_CHECK(pusher.send("hello world!"));
+    BOOST_CHECK(reactor.poll(max_poll_timeout));
+
+    BOOST_CHECK_EQUAL(1, first);
+    BOOST_CHECK_EQUAL(1, second);
+
+    // registering and dropping many sockets keeps reusing the freed slots
+    for (int i = 0; i < 1000; ++i)
+    {
+        reactor.remove(puller);
+        reactor.add(puller, [&]() -> void
+        {
+            std::string message;
+            BOOST_CHECK(puller.receive(message));
+            ++second;
+        });
+    }
+
+    BOOST_CHECK(pusher.send("hello world!"));
+    BOOST_CHECK(reactor.poll(max_poll_timeout));
+    BOOST_CHECK_EQUAL(2, second);
+}
+
+BOOST_AUTO_TEST_CASE(budgeted_draining)
+{
+    zmqpp::context context;
+
+    zmqpp::socket puller(context, zmqpp::socket_type::pull);
+    puller.bind("inproc://test");
+
+    zmqpp::socket pusher(context, zmqpp::socket_type::push);
+    pusher.connect("inproc://test");
+
+    for (int i = 0; i < 10; ++i)
+        BOOST_CHECK(pusher.send("hello world!"));
+
+    zmqpp::reactor reactor;
+    int received = 0;
+    reactor.add(puller, [&]() -> void
+    {
+        std::string message;
+        BOOST_CHECK(puller.receive(message));
+        ++received;
+    }, zmqpp::poller::poll_in, zmqpp::dispatch_budget(4));
+
+    BOOST_CHECK(reactor.poll(max_poll_timeout));
+    BOOST_CHECK_EQUAL(4, received);
+
+    // budget was spent with messages left, so these polls must not wait
+    BOOST_CHECK(reactor.poll(zmqpp::poller::wait_forever));
+    BOOST_CHECK_EQUAL(8, received);
+    BOOST_CHECK(reactor.poll(zmqpp::poller::wait_forever));
+    BOOST_CHECK_EQUAL(10, received);
+
+    BOOST_CHECK(!reactor.poll(0));
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,150 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zmqpp/context.hpp"
+#include "zmqpp/exception.hpp"
+#include "zmqpp/message.hpp"
+#include "zmqpp/sharded_broker.hpp"
+#include "zmqpp/socket.hpp"
+
+#ifndef _WIN32
+
+BOOST_AUTO_TEST_SUITE( sharded_broker )
+
+namespace
+{
+    // answer a number of requests with the request followed by the worker's name
+    void serve(zmqpp::context& context, std::string const& endpoint, std::string const& name, size_t const requests)
+    {
+        zmqpp::socket worker(context, zmqpp::socket_type::request);
+        worker.connect(endpoint);
+        worker.send(zmqpp::sharded_broker::ready);
+
+        for (size_t i = 0; i < requests; ++i)
+        {
+            zmqpp::message msg;
+            worker.receive(msg);
+            msg.push_back(name);
+            worker.send(msg);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(clients_stick_to_their_shard)
+{
+    zmqpp::context context;
+    std::vector<std::string> const backends = { "inproc://broker-backend-0", "inproc://broker-backend-1" };
+    zmqpp::sharded_broker broker(context, "inproc://broker-frontend", backends);
+    BOOST_CHECK_EQUAL(2, broker.size());
+
+    size_t const clients = 8;
+    size_t const requests = 3;
+
+    std::vector<size_t> per_shard(broker.size(), 0);
+    for (size_t i = 0; i < clients; ++i)
+    {
+        per_shard[broker.shard_for("client-" + std::to_string(i))] += requests;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t shard = 0; shard < broker.size(); ++shard)
+    {
+        workers.emplace_back(serve, std::ref(context), backends[shard], std::to_string(shard), per_shard[shard]);
+    }
+
+    std::vector<std::unique_ptr<zmqpp::socket>> sockets;
+    for (size_t i = 0; i < clients; ++i)
+    {
+        sockets.emplace_back(new zmqpp::socket(context, zmqpp::socket_type::request));
+        sockets.back()->set(zmqpp::socket_option::identity, "client-" + std::to_string(i));
+        sockets.back()->connect("inproc://broker-frontend");
+    }
+
+    for (size_t round = 0; round < requests; ++round)
+    {
+        for (size_t i = 0; i < clients; ++i)
+        {
+            sockets[i]->send("request-" + std::to_string(round));
+        }
+
+        for (size_t i = 0; i < clients; ++i)
+        {
+            zmqpp::message reply;
+            BOOST_REQUIRE(sockets[i]->receive(reply));
+            BOOST_REQUIRE_EQUAL(2, reply.parts());
+            BOOST_CHECK_EQUAL("request-" + std::to_string(round), reply.get(0));
+            BOOST_CHECK_EQUAL(std::to_string(broker.shard_for("client-" + std::to_string(i))), reply.get(1));
+        }
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    BOOST_CHECK_NO_THROW(broker.stop());
+}
+
+BOOST_AUTO_TEST_CASE(requests_go_to_least_recently_used_worker)
+{
+    zmqpp::context context;
+    zmqpp::sharded_broker broker(context, "inproc://broker-frontend", { "inproc://broker-backend" });
+
+    std::thread first(serve, std::ref(context), "inproc://broker-backend", "first", 2);
+    std::thread second(serve, std::ref(context), "inproc://broker-backend", "second", 2);
+
+    zmqpp::socket client(context, zmqpp::socket_type::dealer);
+    client.connect("inproc://broker-frontend");
+
+    // wait for both workers before queueing requests, so both are ready
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        zmqpp::message request;
+        request << "" << "request";
+        client.send(request);
+    }
+
+    size_t handled_by_first = 0;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        zmqpp::message reply;
+        BOOST_REQUIRE(client.receive(reply));
+        BOOST_REQUIRE_EQUAL(3, reply.parts());
+        if ("first" == reply.get(2))
+            ++handled_by_first;
+    }
+    BOOST_CHECK_EQUAL(2, handled_by_first);
+
+    first.join();
+    second.join();
+    BOOST_CHECK_NO_THROW(broker.stop());
+}
+
+BOOST_AUTO_TEST_CASE(bind_errors_reach_the_caller)
+{
+    zmqpp::context context;
+    std::vector<std::string> const none;
+    BOOST_CHECK_THROW(zmqpp::sharded_broker(context, "inproc://broker-frontend", none), zmqpp::exception);
+
+    zmqpp::socket taken(context, zmqpp::socket_type::pair);
+    taken.bind("inproc://broker-taken");
+    BOOST_CHECK_THROW(zmqpp::sharded_broker(context, "inproc://broker-frontend", { "inproc://broker-taken" }), zmqpp::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "zmqpp/context.hpp"
+#include "zmqpp/message.hpp"
+#include "zmqpp/socket.hpp"
+#include "zmqpp/socket_watcher.hpp"
+
+#ifdef ZMQPP_HAVE_EPOLL
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+BOOST_AUTO_TEST_SUITE( socket_watcher )
+
+BOOST_AUTO_TEST_CASE(drain_queued_messages)
+{
+    zmqpp::context context;
+
+    zmqpp::socket puller(context, zmqpp::socket_type::pull);
+    puller.bind("inproc://test");
+    zmqpp::socket pusher(context, zmqpp::socket_type::push);
+    pusher.connect("inproc://test");
+
+    size_t received = 0;
+    zmqpp::socket_watcher watcher(puller, [&](short const events) {
+        BOOST_CHECK(events & zmqpp::poller::poll_in);
+        std::string message;
+        BOOST_CHECK(puller.receive(message, true));
+        ++received;
+    }, zmqpp::poller::poll_in, 4);
+
+    BOOST_CHECK(watcher.fd() >= 0);
+    BOOST_CHECK_EQUAL(zmqpp::poller::poll_none, watcher.pending());
+    BOOST_CHECK(!watcher.on_readable());
+
+    for (int i = 0; i < 10; ++i)
+        BOOST_CHECK(pusher.send("hello"));
+
+    // the budget stops each call short while messages remain
+    BOOST_CHECK(watcher.on_readable());
+    BOOST_CHECK_EQUAL(4, received);
+    BOOST_CHECK(watcher.on_readable());
+    BOOST_CHECK_EQUAL(8, received);
+    BOOST_CHECK(!watcher.on_readable());
+    BOOST_CHECK_EQUAL(10, received);
+
+    for (int i = 0; i < 10; ++i)
+        BOOST_CHECK(pusher.send("hello"));
+    BOOST_CHECK_EQUAL(10, watcher.drain());
+    BOOST_CHECK_EQUAL(20, received);
+}
+
+#ifdef ZMQPP_HAVE_EPOLL
+// Echo every message on the same socket from inside an external epoll loop. Sends
+// from the handler consume the descriptor's edge, which is where naive bridges stall.
+BOOST_AUTO_TEST_CASE(epoll_echo_without_missed_wakeups)
+{
+    zmqpp::context context;
+
+    zmqpp::socket server(context, zmqpp::socket_type::pair);
+    server.bind("inproc://test");
+    zmqpp::socket client(context, zmqpp::socket_type::pair);
+    client.connect("inproc://test");
+
+    size_t const messages = 100000;
+    size_t const window = 1000;
+
+    std::atomic<size_t> echoed(0);
+    std::atomic<bool> abandon(false);
+    client.set(zmqpp::socket_option::receive_timeout, 100);
+    std::thread peer([&]() {
+        size_t sent = 0;
+        std::string reply;
+        while (echoed < messages && !abandon)
+        {
+            // keep a window of messages in flight so the server sees bursts
+            while (sent < messages && sent - echoed < window)
+            {
+                client.send("ping");
+                ++sent;
+            }
+            if (client.receive(reply))
+                ++echoed;
+        }
+    });
+
+    zmqpp::epoll_adapter adapter;
+    size_t handled = 0;
+    zmqpp::socket_watcher watcher(server, [&](short const) {
+        std::string message;
+        if (server.receive(message, true))
+        {
+            BOOST_REQUIRE(server.send(message));
+            ++handled;
+        }
+    }, zmqpp::poller::poll_in, 16);
+    adapter.add(watcher);
+
+    int const application = epoll_create1(EPOLL_CLOEXEC);
+    BOOST_REQUIRE(application >= 0);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = adapter.fd();
+    BOOST_REQUIRE_EQUAL(0, epoll_ctl(application, EPOLL_CTL_ADD, adapter.fd(), &event));
+
+    size_t stalls = 0;
+    while (handled < messages)
+    {
+        epoll_event ready[4];
+        // a missed wakeup would leave queued messages unserved until this times out
+        int const count = epoll_wait(application, ready, 4, 1000);
+        if (0 == count)
+        {
+            if (++stalls >= 3)
+                break;
+            continue;
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            if (ready[i].data.fd == adapter.fd())
+                adapter.process();
+        }
+    }
+
+    abandon = true;
+    peer.join();
+    adapter.remove(watcher);
+    close(application);
+
+    BOOST_CHECK_EQUAL(0, stalls);
+    BOOST_CHECK_EQUAL(messages, handled);
+    BOOST_CHECK_EQUAL(messages, echoed.load());
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,88 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <string>
+
+#include "zmqpp/zap_cache.hpp"
+
+BOOST_AUTO_TEST_SUITE( zap_cache )
+
+#if (ZMQ_VERSION_MAJOR > 3)
+
+namespace
+{
+    zmqpp::zap_cache::key_t numbered(uint64_t const number)
+    {
+        zmqpp::zap_cache::key_t key = { number * 0x9e3779b97f4a7c15ULL, number };
+        return key;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(decisions_last_until_they_expire)
+{
+    zmqpp::zap_cache cache(16, std::chrono::seconds(10));
+    zmqpp::zap_cache::clock::time_point const now = zmqpp::zap_cache::clock::now();
+
+    cache.insert(numbered(1), now, true, "admin");
+    cache.insert(numbered(2), now, false, "");
+
+    zmqpp::zap_cache::decision_t const* decision = cache.find(numbered(1), now + std::chrono::seconds(9));
+    BOOST_REQUIRE(nullptr != decision);
+    BOOST_CHECK(decision->allowed);
+    BOOST_CHECK_EQUAL("admin", decision->user_id);
+
+    decision = cache.find(numbered(2), now);
+    BOOST_REQUIRE(nullptr != decision);
+    BOOST_CHECK(!decision->allowed);
+
+    BOOST_CHECK(nullptr == cache.find(numbered(3), now));
+    BOOST_CHECK(nullptr == cache.find(numbered(1), now + std::chrono::seconds(10)));
+
+    // a decision made again replaces the old one
+    cache.insert(numbered(1), now + std::chrono::seconds(10), false, "");
+    decision = cache.find(numbered(1), now + std::chrono::seconds(11));
+    BOOST_REQUIRE(nullptr != decision);
+    BOOST_CHECK(!decision->allowed);
+
+    cache.clear();
+    BOOST_CHECK(nullptr == cache.find(numbered(2), now));
+}
+
+BOOST_AUTO_TEST_CASE(size_is_bounded)
+{
+    BOOST_CHECK_EQUAL(4, zmqpp::zap_cache(0, std::chrono::seconds(1)).capacity());
+    BOOST_CHECK_EQUAL(8, zmqpp::zap_cache(10, std::chrono::seconds(1)).capacity());
+    BOOST_CHECK_EQUAL(1024, zmqpp::zap_cache(1024, std::chrono::seconds(1)).capacity());
+
+    zmqpp::zap_cache cache(64, std::chrono::seconds(10));
+    zmqpp::zap_cache::clock::time_point const now = zmqpp::zap_cache::clock::now();
+    for (uint64_t i = 0; i < 1000; ++i)
+        cache.insert(numbered(i), now + std::chrono::milliseconds(i), true, std::to_string(i));
+
+    size_t kept = 0;
+    for (uint64_t i = 0; i < 1000; ++i)
+    {
+        if (zmqpp::zap_cache::decision_t const* decision = cache.find(numbered(i), now))
+        {
+            BOOST_CHECK_EQUAL(std::to_string(i), decision->user_id);
+            ++kept;
+        }
+    }
+    BOOST_CHECK_EQUAL(cache.capacity(), kept);
+
+    // the newest decisions are the ones kept
+    BOOST_CHECK(nullptr != cache.find(numbered(999), now));
+    BOOST_CHECK(nullptr == cache.find(numbered(0), now));
+}
+
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
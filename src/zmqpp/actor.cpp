@@ -14,11 +14,15 @@
  * Created on May 20, 2014, 10:51 PM
  */
 
+#include <atomic>
 #include <cassert>
-#include <cstdlib>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include "actor.hpp"
+#include "actor_executor.hpp"
 #include "socket.hpp"
 #include "message.hpp"
 #include "exception.hpp"
@@ -29,21 +33,106 @@ zmqpp::context zmqpp::actor::actor_pipe_ctx_;
 namespace zmqpp
 {
 
+  namespace
+  {
+    // nothing but actors binds on actor_pipe_ctx_, so a counter is enough to
+    // keep endpoints unique
+    std::atomic<uint64_t> next_pipe_id(0);
+
+    struct spare_pipes_t
+    {
+      std::mutex mutex;
+      std::vector<std::pair<socket *, socket *>> pipes;
+
+      ~spare_pipes_t()
+      {
+        for (auto const &pipe : pipes)
+        {
+          delete pipe.first;
+          delete pipe.second;
+        }
+      }
+    };
+
+    // defined after actor_pipe_ctx_ so the sockets are closed before it terminates
+    spare_pipes_t spare_pipes;
+  }
+
   actor::actor(ActorStartRoutine routine)
       : parent_pipe_(nullptr)
       , child_pipe_(nullptr)
       , stopped_(false)
   {
-    std::string pipe_endpoint;
+    start(nullptr, routine);
+  }
 
-    parent_pipe_  = new socket(actor_pipe_ctx_, socket_type::pair);
-    pipe_endpoint = bind_parent();
+  actor::actor(actor_executor &executor, ActorStartRoutine routine)
+      : parent_pipe_(nullptr)
+      , child_pipe_(nullptr)
+      , stopped_(false)
+  {
+    start(&executor, routine);
+  }
 
-    child_pipe_ = new socket(actor_pipe_ctx_, socket_type::pair);
-    child_pipe_->connect(pipe_endpoint);
+  actor::actor(thread_placement const &placement, ActorStartRoutine routine)
+      : parent_pipe_(nullptr)
+      , child_pipe_(nullptr)
+      , stopped_(false)
+  {
+    start(nullptr, [placement, routine](socket *pipe) {
+      placement.apply();
+      return routine(pipe);
+    });
+  }
 
-    std::thread t(&actor::start_routine, this, child_pipe_, routine);
-    t.detach();
+  void actor::start(actor_executor *executor, ActorStartRoutine routine)
+  {
+    // a routine holds its worker until it ends, so waiting for a worker could
+    // be waiting forever
+    if (executor)
+    {
+      if (executor->on_worker())
+        throw exception("an actor can't be started from a worker of its own executor");
+      if (!executor->claim())
+        throw exception("every worker of the actor executor is taken");
+    }
+
+    try
+    {
+      take_pipe();
+    }
+    catch (...)
+    {
+      if (executor)
+        executor->release();
+      throw;
+    }
+
+    if (executor)
+    {
+      // the worker is given back before the routine's result is sent, so an
+      // actor can be started again as soon as another has stopped
+      socket *child = child_pipe_;
+      ActorStartRoutine claimed = [executor, routine](socket *pipe) {
+        try
+        {
+          bool const result = routine(pipe);
+          executor->release();
+          return result;
+        }
+        catch (...)
+        {
+          executor->release();
+          throw;
+        }
+      };
+      executor->submit([this, child, claimed]() { start_routine(child, claimed); });
+    }
+    else
+    {
+      std::thread t(&actor::start_routine, this, child_pipe_, routine);
+      t.detach();
+    }
 
     signal sig;
     sig = parent_pipe_->wait();
@@ -145,24 +234,59 @@ namespace zmqpp
     return parent_pipe_;
   }
 
-  std::string actor::bind_parent()
+  void actor::reserve_pipes(size_t count)
   {
-    std::string base_endpoint =
-        "inproc://zmqpp::actor::" +
-        std::to_string(reinterpret_cast<ptrdiff_t>(this));
+    std::vector<std::pair<socket *, socket *>> created;
+    created.reserve(count);
+    try
+    {
+      for (size_t i = 0; i < count; ++i)
+        created.push_back(create_pipe());
 
-    for (;;)
+      std::lock_guard<std::mutex> lg(spare_pipes.mutex);
+      spare_pipes.pipes.insert(spare_pipes.pipes.end(), created.begin(), created.end());
+    }
+    catch (...)
     {
-      try
+      for (auto const &pipe : created)
       {
-        std::string endpoint = base_endpoint + std::to_string(std::rand());
-        parent_pipe_->bind(endpoint);
-        return endpoint;
+        delete pipe.first;
+        delete pipe.second;
       }
-      catch (zmq_internal_exception const &)
+      throw;
+    }
+  }
+
+  void actor::take_pipe()
+  {
+    {
+      std::lock_guard<std::mutex> lg(spare_pipes.mutex);
+      if (!spare_pipes.pipes.empty())
       {
-        // endpoint already taken.
+        parent_pipe_ = spare_pipes.pipes.back().first;
+        child_pipe_  = spare_pipes.pipes.back().second;
+        spare_pipes.pipes.pop_back();
+        return;
       }
     }
+
+    std::pair<socket *, socket *> pipe = create_pipe();
+    parent_pipe_ = pipe.first;
+    child_pipe_  = pipe.second;
+  }
+
+  std::pair<socket *, socket *> actor::create_pipe()
+  {
+    std::string const endpoint =
+        "inproc://zmqpp::actor::" +
+        std::to_string(next_pipe_id.fetch_add(1, std::memory_order_relaxed));
+
+    std::unique_ptr<socket> parent(new socket(actor_pipe_ctx_, socket_type::pair));
+    parent->bind(endpoint);
+
+    std::unique_ptr<socket> child(new socket(actor_pipe_ctx_, socket_type::pair));
+    child->connect(endpoint);
+
+    return std::make_pair(parent.release(), child.release());
   }
 }
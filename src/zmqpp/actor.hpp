@@ -12,11 +12,14 @@
 #include <thread>
 #include <functional>
 #include <mutex>
+#include <utility>
 #include "context.hpp"
 #include "socket.hpp"
+#include "thread_placement.hpp"
 
 namespace zmqpp
 {
+  class actor_executor;
 
   /**
    * An actor is a thread with a pair socket connected to its parent.
@@ -67,6 +70,29 @@ namespace zmqpp
      * @param routine to be executed.
      */
     actor(ActorStartRoutine routine);
+
+    /**
+     * Create a new actor that runs on one of an executor's workers instead of
+     * its own thread. It behaves as any other actor, holding its worker until
+     * it stops.
+     *
+     * Throws zmqpp::exception if every worker is already held by an actor, or
+     * if called from one of the executor's workers.
+     *
+     * The executor must outlive the actor.
+     * @param executor the pool to run the routine on.
+     * @param routine to be executed.
+     */
+    actor(actor_executor &executor, ActorStartRoutine routine);
+
+    /**
+     * Create a new actor whose thread is placed before running the routine.
+     * If the placement can't be applied the constructor throws as if the
+     * routine had failed to start.
+     * @param placement cpus, numa node and name for the actor's thread.
+     * @param routine to be executed.
+     */
+    actor(thread_placement const &placement, ActorStartRoutine routine);
     actor(const actor &) = delete;
 
     /**
@@ -116,7 +142,25 @@ namespace zmqpp
      */
     bool stop(bool block = false);
 
+    /**
+     * Create pipes ahead of time for actors yet to be started, so that many
+     * actors can then be started without the cost of creating and connecting
+     * their sockets. Safe to call from any thread.
+     *
+     * @param count number of pipes to add to the spare ones.
+     */
+    static void reserve_pipes(size_t count);
+
   private:
+    /**
+     * Create the pipe, start the routine on the executor or on a new detached
+     * thread if there is none, then wait for its first signal.
+     *
+     * @param executor the pool to use, may be null.
+     * @param routine user routine that will be called
+     */
+    void start(actor_executor *executor, ActorStartRoutine routine);
+
     /**
      * Call a user defined function and performs cleanup once it returns.
      * We use a copy of child_pipe_ here; this is to avoid a race condition
@@ -131,11 +175,18 @@ namespace zmqpp
     void start_routine(socket *child, ActorStartRoutine routine);
 
     /**
-    * Bind the parent socket and return the endpoint used.
-    * Since endpoint are generated and have to be tested for availability
-    * this method is responsible for finding a valid endpoint to bind to.
-    */
-    std::string bind_parent();
+     * Take a spare pipe if there is one, otherwise create one.
+     * Sets parent_pipe_ and child_pipe_.
+     */
+    void take_pipe();
+
+    /**
+     * Create a connected pair of sockets. Each pipe binds its own endpoint,
+     * numbered from a counter so the bind never collides.
+     *
+     * @return the parent and child ends.
+     */
+    static std::pair<socket *, socket *> create_pipe();
 
     /**
      * The parent thread socket.
@@ -0,0 +1,177 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include "actor_executor.hpp"
+#include "exception.hpp"
+
+namespace zmqpp
+{
+
+    namespace
+    {
+        // the executor and worker index of the calling thread, if it is a worker
+        thread_local actor_executor const* current_executor = nullptr;
+        thread_local size_t current_worker = 0;
+    }
+
+    actor_executor::actor_executor(size_t const workers /* = max(1, hardware_concurrency) */) :
+    workers_(),
+    next_(0),
+    claimed_(0),
+    idle_mutex_(),
+    wakeup_(),
+    queued_(0),
+    stopping_(false)
+    {
+        if (0 == workers)
+        {
+            throw exception("actor executor needs at least one worker");
+        }
+
+        for (size_t i = 0; i < workers; ++i)
+        {
+            workers_.emplace_back(new worker_t());
+        }
+
+        try
+        {
+            for (size_t i = 0; i < workers; ++i)
+            {
+                workers_[i]->thread = std::thread(&actor_executor::run, this, i);
+            }
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard<std::mutex> lock(idle_mutex_);
+                stopping_ = true;
+            }
+            wakeup_.notify_all();
+            for (std::unique_ptr<worker_t> const& worker : workers_)
+            {
+                if (worker->thread.joinable())
+                    worker->thread.join();
+            }
+            throw;
+        }
+    }
+
+    actor_executor::~actor_executor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+            stopping_ = true;
+        }
+        wakeup_.notify_all();
+
+        for (std::unique_ptr<worker_t> const& worker : workers_)
+        {
+            worker->thread.join();
+        }
+    }
+
+    size_t actor_executor::size() const
+    {
+        return workers_.size();
+    }
+
+    void actor_executor::submit(Callable task)
+    {
+        size_t const index = (this == current_executor) ? current_worker : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+
+        {
+            worker_t& worker = *workers_[index];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+            queued_.fetch_add(1, std::memory_order_relaxed);
+        }
+        wakeup_.notify_one();
+    }
+
+    bool actor_executor::claim()
+    {
+        size_t claimed = claimed_.load(std::memory_order_relaxed);
+        do
+        {
+            if (claimed >= workers_.size())
+                return false;
+        }
+        while (!claimed_.compare_exchange_weak(claimed, claimed + 1, std::memory_order_relaxed));
+        return true;
+    }
+
+    void actor_executor::release()
+    {
+        claimed_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    bool actor_executor::on_worker() const
+    {
+        return this == current_executor;
+    }
+
+    void actor_executor::run(size_t const index)
+    {
+        current_executor = this;
+        current_worker = index;
+
+        Callable task;
+        for (;;)
+        {
+            if (pop(index, task))
+            {
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(idle_mutex_);
+            wakeup_.wait(lock, [this]() { return stopping_ || queued_.load(std::memory_order_relaxed) > 0; });
+            if (stopping_ && queued_.load(std::memory_order_relaxed) <= 0)
+                return;
+        }
+    }
+
+    bool actor_executor::pop(size_t const index, Callable& task)
+    {
+        // own queue first, oldest task first so actors start in the order they were created
+        {
+            worker_t& worker = *workers_[index];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (!worker.tasks.empty())
+            {
+                task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        // then steal the newest task of another worker, leaving its owner the older ones
+        for (size_t i = 1; i < workers_.size(); ++i)
+        {
+            worker_t& victim = *workers_[(index + i) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+}
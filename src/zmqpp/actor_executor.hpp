@@ -0,0 +1,124 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "compatibility.hpp"
+#include "inplace_function.hpp"
+
+namespace zmqpp
+{
+
+    /**
+     * A fixed pool of worker threads that actors can run on instead of each
+     * starting its own thread.
+     *
+     * Every worker has its own queue. Tasks submitted from outside the pool are
+     * spread over the queues in turn, tasks submitted from a worker go to that
+     * worker's queue, and a worker whose queue is empty steals from the back of
+     * the others before going to sleep.
+     *
+     * A task holds its worker until it returns, so an actor routine occupies a
+     * worker for the actor's whole life. Each actor claims a worker before it
+     * is queued, and starting an actor while every worker is claimed throws
+     * rather than waiting for one that may never be freed. Starting an actor
+     * from one of the pool's own workers, such as from another pooled actor,
+     * always throws, as its task could end up queued behind the busy worker.
+     * Size the pool for the number of actors expected to be alive at once, the
+     * pool only saves the cost of starting and ending a thread per actor.
+     */
+    class actor_executor
+    {
+    public:
+        /**
+         * Task type run by the workers.
+         */
+        typedef inplace_function<void (void)> Callable;
+
+        /**
+         * Start the workers.
+         *
+         * \param workers number of threads, at least one. Defaults to one per
+         *        core, or one where the number of cores isn't known.
+         */
+        ZMQPP_EXPORT explicit actor_executor(size_t const workers = std::max(1u, std::thread::hardware_concurrency()));
+
+        /**
+         * Run every queued task then stop the workers. Actors still running on the
+         * pool must have been stopped first.
+         */
+        ZMQPP_EXPORT ~actor_executor();
+
+        /**
+         * \return the number of workers.
+         */
+        ZMQPP_EXPORT size_t size() const;
+
+        /**
+         * Queue a task, safe to call from any thread including the workers.
+         *
+         * \param task the function to run, exceptions escaping it terminate the program.
+         */
+        ZMQPP_EXPORT void submit(Callable task);
+
+        /**
+         * Claim a worker for a task that holds it until told to stop, such as
+         * an actor routine. Tasks submitted without a claim aren't counted.
+         *
+         * \return false if every worker is already claimed.
+         */
+        ZMQPP_EXPORT bool claim();
+
+        /**
+         * Give back a worker claimed with claim(), once its task is about to
+         * return.
+         */
+        ZMQPP_EXPORT void release();
+
+        /**
+         * \return true if the calling thread is one of this pool's workers.
+         */
+        ZMQPP_EXPORT bool on_worker() const;
+
+    private:
+        struct worker_t
+        {
+            std::mutex mutex;
+            std::deque<Callable> tasks;
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<worker_t>> workers_;
+        std::atomic<size_t> next_;
+        std::atomic<size_t> claimed_;
+
+        // queued_ only goes up while holding idle_mutex_ so sleeping workers can't miss a task
+        std::mutex idle_mutex_;
+        std::condition_variable wakeup_;
+        std::atomic<long> queued_;
+        bool stopping_;
+
+        void run(size_t const index);
+        bool pop(size_t const index, Callable& task);
+
+        // No copy - private and not implemented
+        actor_executor(actor_executor const&) ZMQPP_EXPLICITLY_DELETED;
+        actor_executor& operator=(actor_executor const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
@@ -0,0 +1,171 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <utility>
+
+#include "compatibility.hpp"
+
+#ifndef _WIN32
+
+#include <poll.h>
+
+#include "event_notifier.hpp"
+#include "exception.hpp"
+#include "mpsc_ring.hpp"
+
+namespace zmqpp
+{
+
+    /**
+     * Typed in process channel between threads, typically an actor and its parent.
+     *
+     * Values are moved through a lock free ring rather than serialised into
+     * messages, so ownership of a buffer or object can be handed over without
+     * copying it. The ring's slots are allocated with the mailbox, sending and
+     * receiving only move the value. Any number of threads may send, one thread
+     * at a time receives.
+     *
+     * Like a zmq socket at its high water mark, a full mailbox refuses values
+     * rather than making the sender wait, and the sender keeps the value.
+     *
+     * The descriptor from fd() is readable whenever values may be waiting and can
+     * be added to a poller or loop next to zmq sockets. It is only signalled by
+     * the first send after the receiver found the mailbox empty, so a busy
+     * receiver costs senders no system calls.
+     */
+    template<typename T>
+    class actor_mailbox
+    {
+    public:
+        /**
+         * Values held by a mailbox unless told otherwise.
+         */
+        static const size_t default_capacity = 1024;
+
+        /**
+         * \param capacity most values waiting at once, rounded up to a power of two.
+         */
+        explicit actor_mailbox(size_t const capacity = default_capacity) :
+        queue_(capacity),
+        notifier_(),
+        signalled_(false)
+        {
+        }
+
+        /**
+         * \return the descriptor to poll for input.
+         */
+        raw_socket_t fd() const { return notifier_.fd(); }
+
+        /**
+         * Queue a value, safe to call from any thread and never blocks.
+         *
+         * \param value the value, moved from if it is queued.
+         * \return true if it was queued, false if the mailbox is full.
+         */
+        bool send(T& value)
+        {
+            if (!queue_.push(value))
+                return false;
+
+            // only the first send since the receiver last emptied the mailbox needs to wake it
+            if (!signalled_.exchange(true, std::memory_order_acq_rel))
+                notifier_.notify();
+            return true;
+        }
+
+        /**
+         * Queue a temporary value, safe to call from any thread and never blocks.
+         *
+         * \param value the value, moved from if it is queued.
+         * \return true if it was queued, false if the mailbox is full.
+         */
+        bool send(T&& value)
+        {
+            return send(value);
+        }
+
+        /**
+         * \return the most values waiting at once.
+         */
+        size_t capacity() const { return queue_.capacity(); }
+
+        /**
+         * Take the oldest value without blocking. Must only be called by the receiver.
+         *
+         * \param value set to the received value on success.
+         * \return true if a value was received.
+         */
+        bool try_receive(T& value)
+        {
+            if (queue_.pop(value))
+                return true;
+
+            notifier_.consume();
+            // acquire pairs with the senders' exchange, a send that saw the flag
+            // still raised didn't notify so its value must be visible now
+            signalled_.exchange(false, std::memory_order_acq_rel);
+            if (!queue_.pop(value))
+                return false;
+
+            if (!queue_.empty() && !signalled_.exchange(true, std::memory_order_acq_rel))
+                notifier_.notify();
+            return true;
+        }
+
+        /**
+         * Wait for a value. Must only be called by the receiver.
+         *
+         * \param value set to the received value on success.
+         * \param timeout most milliseconds to wait, -1 to wait forever.
+         * \return true if a value was received, false on timeout.
+         */
+        bool receive(T& value, long const timeout = -1)
+        {
+            typedef std::chrono::steady_clock clock;
+            clock::time_point const deadline = clock::now() + std::chrono::milliseconds(timeout);
+
+            while (!try_receive(value))
+            {
+                // a wakeup may find nothing, so each wait is only for what is left
+                long remaining = -1;
+                if (timeout >= 0)
+                {
+                    clock::duration const left = deadline - clock::now();
+                    if (left <= clock::duration::zero())
+                        return false;
+                    // rounded up so the last wait doesn't end just short of the deadline
+                    remaining = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(left + std::chrono::milliseconds(1) - clock::duration(1)).count());
+                }
+
+                struct pollfd item = { fd(), POLLIN, 0 };
+                if (::poll(&item, 1, static_cast<int>(remaining)) < 0 && EINTR != errno)
+                    throw exception("unable to poll actor mailbox");
+            }
+            return true;
+        }
+
+    private:
+        mpsc_ring<T> queue_;
+        event_notifier notifier_;
+        std::atomic<bool> signalled_;
+
+        // No copy - private and not implemented
+        actor_mailbox(actor_mailbox const&) ZMQPP_EXPLICITLY_DELETED;
+        actor_mailbox& operator=(actor_mailbox const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
+
+#endif
@@ -14,8 +14,11 @@
  * \author Prem Shankar Kumar (\@meprem)
  */
 
+#include <atomic>
+#include <deque>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "auth.hpp"
 #include "message.hpp"
@@ -32,17 +35,56 @@
 
 namespace zmqpp
 {
-auth::auth(context& ctx) :
-  curve_allow_any(false),
+
+namespace
+{
+    // worker endpoints share the caller's context, the counter keeps the
+    // endpoints of several auth actors apart
+    std::atomic<uint64_t> next_auth_id(0);
+
+    // most requests or replies moved from one socket before polling again
+    size_t const batch_size = 64;
+
+    // sent by a worker once it is connected, it is then given requests
+    char const* const worker_ready = "READY";
+
+    // addresses that aren't IPs, such as those of ipc peers, are matched as text
+    bool listed(std::unordered_set<std::string> const& addresses, cidr_set const& ranges, std::string const& address)
+    {
+        return ranges.contains(address) || (addresses.end() != addresses.find(address));
+    }
+
+    // the decision cache a policy asks for, if any
+    zap_cache* new_cache(auth_policy const& policy)
+    {
+        if (0 == policy.cache_entries)
+            return nullptr;
+        return new zap_cache(policy.cache_entries, policy.cache_ttl);
+    }
+}
+
+auth::auth(context& ctx, size_t workers /* = 1 */) :
+  policy(std::make_shared<auth_policy>()),
+  policy_changed(false),
+  policy_published(true),
+  published_policy(policy),
+  policy_generation(0),
   terminated(false),
   verbose(false)
   {
-    auto zap_auth_server = [this] (socket * pipe, context& auth_ctx) -> bool {
-        // spawn ZAP handler
-        socket zap_handler(auth_ctx, socket_type::reply);
+    if (0 == workers) {
+        throw exception("auth needs at least one worker");
+    }
+
+    auto zap_auth_server = [this, workers] (socket * pipe, context& auth_ctx) -> bool {
+        // spawn ZAP handler, requests are handed out to the workers through a router
+        socket zap_handler(auth_ctx, socket_type::router);
+        socket zap_workers(auth_ctx, socket_type::router);
+        std::string const workers_endpoint = "inproc://zmqpp::auth-" +
+            std::to_string(next_auth_id.fetch_add(1, std::memory_order_relaxed));
         try {
             zap_handler.bind(zap_endpoint_);
-            pipe->send(signal::ok);
+            zap_workers.bind(workers_endpoint);
         }
         catch (zmq_internal_exception const&) {
             // by returning false here, the actor will send signal::ko
@@ -51,12 +93,48 @@ auth::auth(context& ctx) :
             return false;
         }
 
+        // the workers are stopped when they go out of scope, before the sockets
+        std::vector<actor> handlers;
+        handlers.reserve(workers);
+        for (size_t i = 0; i < workers; ++i) {
+            handlers.emplace_back(std::bind(&auth::serve, this, std::placeholders::_1, std::ref(auth_ctx), workers_endpoint));
+        }
+        pipe->send(signal::ok);
+
         auth_poller.add(*pipe);
         auth_poller.add(zap_handler);
-
-        while (!terminated && auth_poller.poll()) {
-            if (auth_poller.has_input(zap_handler)) {
-                authenticate(zap_handler);
+        auth_poller.add(zap_workers);
+
+        // workers waiting for a request, the one idle longest first. A worker
+        // only gets one request at a time, so a slow check holds up no other
+        std::deque<std::string> ready;
+
+        while (!terminated) {
+            // requests stay queued in the router until a worker is free
+            auth_poller.check_for(zap_handler, ready.empty() ? 0 : poller::poll_in);
+            if (!auth_poller.poll())
+                break;
+
+            if (auth_poller.has_input(zap_workers)) {
+                // [worker, READY] or [worker, client, "", reply...]
+                message msg;
+                for (size_t i = 0; i < batch_size && zap_workers.receive(msg, true); ++i) {
+                    ready.push_back(msg.get(0));
+                    if (2 == msg.parts() && msg.get(1) == worker_ready)
+                        continue;
+                    msg.pop_front();
+                    zap_handler.send(msg);
+                }
+            }
+            if (!ready.empty() && auth_poller.has_input(zap_handler)) {
+                // workers see every change made before the request came in
+                publish();
+                message msg;
+                for (size_t i = 0; i < batch_size && !ready.empty() && zap_handler.receive(msg, true); ++i) {
+                    msg.push_front(ready.front());
+                    ready.pop_front();
+                    zap_workers.send(msg);
+                }
             }
             if (auth_poller.has_input(*pipe)) {
                 handle_command(*pipe);
@@ -79,25 +157,18 @@ auth::~auth() {
 }
 
 void auth::allow(const std::string &address) {
-	message msg;
-	msg << "ALLOW" << address;
-	authenticator->pipe()->send(msg);
-	authenticator->pipe()->wait();
+	allow(&address, &address + 1);
 }
 
 void auth::deny(const std::string &address) {
-	message msg;
-	msg << "DENY" << address;
-	authenticator->pipe()->send(msg);
-	authenticator->pipe()->wait();
+	deny(&address, &address + 1);
 }
 
 void auth::configure_domain(const std::string &domain) {
 	message msg;
 	assert(!domain.empty());
 	msg << "DOMAIN" << domain;
-	authenticator->pipe()->send(msg);
-	authenticator->pipe()->wait();
+	command(msg);
 }
 
 void auth::configure_plain(const std::string &username, const std::string &password) {
@@ -110,20 +181,39 @@ void auth::configure_plain(const std::string &username, const std::string &passw
         std::cout << "auth: configure PLAIN - username:" << username << " password:" << password << std::endl; 
     }
 
-    authenticator->pipe()->send(msg);
-    authenticator->pipe()->wait();
+    command(msg);
 }
 
 void auth::configure_curve(const std::string &client_public_key) {
-	message msg;
 	assert(!client_public_key.empty());
-	msg << "CURVE" << client_public_key;
 
     if (verbose) {
         std::cout << "auth: configure CURVE - client public key:" << client_public_key << std::endl; 
     }
 
-    authenticator->pipe()->send(msg);
+	configure_curve(&client_public_key, &client_public_key + 1);
+}
+
+void auth::configure(auth_policy policy) {
+	message msg;
+	msg << "POLICY";
+	msg.move(new auth_policy(std::move(policy)));
+	command(msg);
+}
+
+void auth::configure_cache(size_t entries, std::chrono::milliseconds ttl) {
+	message msg;
+	msg << "CACHE" << static_cast<uint64_t>(entries) << static_cast<int64_t>(ttl.count());
+
+    if (verbose) {
+        std::cout << "auth: configure cache - entries:" << entries << " ttl:" << ttl.count() << "ms" << std::endl; 
+    }
+
+    command(msg);
+}
+
+void auth::command(message& msg) {
+	authenticator->pipe()->send(msg);
 	authenticator->pipe()->wait();
 }
 
@@ -167,21 +257,25 @@ void auth::handle_command(socket& pipe) {
     }
 
     if("ALLOW" == command) {
-    	std::string address = msg.get(1);
-    	if(verbose) {
-    		std::cout << "auth: whitelisting ipaddress=" << address << std::endl;
+    	auth_policy& editable = editable_policy();
+    	for (size_t i = 1; i < msg.parts(); ++i) {
+    		std::string address = msg.get(i);
+    		if(verbose) {
+    			std::cout << "auth: whitelisting ipaddress=" << address << std::endl;
+    		}
+    		editable.allow(address);
     	}
-
-    	whitelist.insert(address);
     	pipe.send(signal::ok); 
 
     } else if("DENY" == command) {
-    	std::string address = msg.get(1);
-    	if(verbose) {
-    		std::cout << "auth: blacklisting ipaddress=" << address << std::endl;
+    	auth_policy& editable = editable_policy();
+    	for (size_t i = 1; i < msg.parts(); ++i) {
+    		std::string address = msg.get(i);
+    		if(verbose) {
+    			std::cout << "auth: blacklisting ipaddress=" << address << std::endl;
+    		}
+    		editable.deny(address);
     	}
-
-    	blacklist.insert(address);
     	pipe.send(signal::ok); 
     	
     } else if("DOMAIN" == command) {
@@ -190,39 +284,64 @@ void auth::handle_command(socket& pipe) {
     		std::cout << "auth: domain=" << domain << std::endl;
     	}
 
-    	this->domain = domain;
+    	editable_policy().configure_domain(domain);
     	pipe.send(signal::ok); 
     	
     } else if("PLAIN" == command) {
-    	std::string user = msg.get(1);
-    	std::string pass = msg.get(2);
+    	auth_policy& editable = editable_policy();
+    	for (size_t i = 1; i + 1 < msg.parts(); i += 2) {
+    		std::string user = msg.get(i);
+    		std::string pass = msg.get(i + 1);
 
-        if (verbose) {
-            std::cout << "auth: configured PLAIN - user:" << user << std::endl; 
-        }
-
-    	passwords.insert(std::make_pair(user, pass));
+    		if (verbose) {
+    			std::cout << "auth: configured PLAIN - user:" << user << std::endl; 
+    		}
+    		editable.configure_plain(user, pass);
+    	}
     	pipe.send(signal::ok); 
 
     } else if("CURVE" == command) {
-    	// If client_public_key is CURVE_ALLOW_ANY, allow all clients. Otherwise
-    	// treat client_public_key as client public key certificate.
-    	std::string client_public_key = msg.get(1);
-
-    	if("CURVE_ALLOW_ANY" == client_public_key) {
-    		curve_allow_any = true;
-            if(verbose) {
-    		  std::cout << "auth: configured CURVE - allow ALL clients" << std::endl;
-            }
-    	} else {
-    		curve_allow_any = false;
-    		client_keys.insert(client_public_key);
-            if(verbose) {
-    		  std::cout << "auth: configured CURVE - allow client with public key:" << client_public_key << std::endl;
-            }
+    	auth_policy& editable = editable_policy();
+    	for (size_t i = 1; i < msg.parts(); ++i) {
+    		std::string client_public_key = msg.get(i);
+    		if(verbose) {
+    			if("CURVE_ALLOW_ANY" == client_public_key) {
+    				std::cout << "auth: configured CURVE - allow ALL clients" << std::endl;
+    			} else {
+    				std::cout << "auth: configured CURVE - allow client with public key:" << client_public_key << std::endl;
+    			}
+    		}
+    		editable.configure_curve(client_public_key);
     	}
 		pipe.send(signal::ok); 
 
+    } else if("POLICY" == command) {
+    	// the caller gave up the policy, the frame owning it only has to
+    	// delete what is left once it has been moved from
+    	auth_policy const* replacement = nullptr;
+    	msg.get(&replacement, 1);
+    	if(verbose) {
+    		std::cout << "auth: replaced policy" << std::endl;
+    	}
+
+    	policy = std::make_shared<auth_policy>(std::move(*const_cast<auth_policy*>(replacement)));
+    	policy->verbose = verbose;
+    	policy_published = false;
+    	policy_changed = true;
+    	pipe.send(signal::ok); 
+
+    } else if("CACHE" == command) {
+    	uint64_t entries = 0;
+    	int64_t ttl = 0;
+    	msg.get(entries, 1);
+    	msg.get(ttl, 2);
+    	if(verbose) {
+    		std::cout << "auth: cache entries=" << entries << " ttl=" << ttl << "ms" << std::endl;
+    	}
+
+    	editable_policy().configure_cache(static_cast<size_t>(entries), std::chrono::milliseconds(ttl));
+    	pipe.send(signal::ok); 
+
     } else if("GSSAPI" == command) {
     	// GSSAPI authentication is not yet implemented here
         if(verbose) {
@@ -234,6 +353,7 @@ void auth::handle_command(socket& pipe) {
     	std::string verbose_string = msg.get(1);
 
     	verbose = ("true" == verbose_string)? true : false;
+    	editable_policy().verbose = verbose;
     	pipe.send(signal::ok); 
 
     } else if("TERMINATE" == command) {
@@ -250,11 +370,70 @@ void auth::handle_command(socket& pipe) {
     }
 }
 
-bool auth::authenticate_plain(zap_request& request, std::string &user_id)
+auth_policy& auth::editable_policy() {
+    if (policy_published) {
+        policy = std::make_shared<auth_policy>(*policy);
+        policy_published = false;
+    }
+    policy_changed = true;
+    return *policy;
+}
+
+void auth::publish() {
+    if (!policy_changed)
+        return;
+
+    // the generation is bumped after the swap, so a worker that sees it also
+    // sees the new policy. Workers drop the old one as they move on, the last
+    // to do so frees it
+    std::atomic_store(&published_policy, std::shared_ptr<auth_policy const>(policy));
+    policy_generation.fetch_add(1, std::memory_order_release);
+    policy_changed = false;
+    policy_published = true;
+}
+
+bool auth::serve(socket* pipe, context& ctx, std::string const& endpoint) {
+    socket zap_handler(ctx, socket_type::dealer);
+    zap_handler.connect(endpoint);
+    message ready;
+    ready << worker_ready;
+    zap_handler.send(ready);
+    pipe->send(signal::ok);
+
+    poller worker_poller;
+    worker_poller.add(*pipe);
+    worker_poller.add(zap_handler);
+
+    // the policy is only loaded again when a new one was published
+    uint64_t generation = policy_generation.load(std::memory_order_acquire);
+    std::shared_ptr<auth_policy const> current = std::atomic_load(&published_policy);
+    std::unique_ptr<zap_cache> cache(new_cache(*current));
+
+    while (worker_poller.poll()) {
+        if (worker_poller.has_input(zap_handler)) {
+            uint64_t const latest = policy_generation.load(std::memory_order_acquire);
+            if (latest != generation) {
+                generation = latest;
+                current = std::atomic_load(&published_policy);
+                // the new policy may decide otherwise, its cache starts empty
+                cache.reset(new_cache(*current));
+            }
+            authenticate(*current, cache.get(), zap_handler);
+        }
+        if (worker_poller.has_input(*pipe)) {
+            // the pipe only ever tells a worker to stop
+            pipe->wait();
+            break;
+        }
+    }
+    return true;
+}
+
+bool auth::authenticate_plain(auth_policy const& policy, zap_request& request, std::string &user_id)
 {
-	auto search = passwords.find(request.get_username());
-    if((search != passwords.end()) && (search->second == request.get_password())) {
-        if (verbose) {
+	auto search = policy.passwords.find(request.get_username());
+    if((search != policy.passwords.end()) && (search->second == request.get_password())) {
+        if (policy.verbose) {
             std::cout << "auth: allowed (PLAIN) username=" << request.get_username()
         		<< " password=" << request.get_password() << std::endl;
         }
@@ -262,7 +441,7 @@ bool auth::authenticate_plain(zap_request& request, std::string &user_id)
         return true;
     }
     else {
-    	if (verbose) {
+    	if (policy.verbose) {
             std::cout << "auth: denied (PLAIN) username=" << request.get_username()
         		<< " password=" << request.get_password() << std::endl;
         }
@@ -270,25 +449,25 @@ bool auth::authenticate_plain(zap_request& request, std::string &user_id)
     }
 }
 
-bool auth::authenticate_curve(zap_request& request, std::string &user_id)
+bool auth::authenticate_curve(auth_policy const& policy, zap_request& request, std::string &user_id)
 {
-	if (curve_allow_any) {
-    	if (verbose) {
+	if (policy.curve_allow_any) {
+    	if (policy.verbose) {
         	std::cout << "auth: allowed (CURVE allow any client)" << std::endl;
         }
         user_id = request.get_client_key();
     	return true;
 	} else {
-		auto search = client_keys.find(request.get_client_key());
-    	if(search != client_keys.end()) {
-    		if (verbose) {
+		const void * const client_key = request.get_client_key_data();
+    	if((nullptr != client_key) && policy.client_keys.contains(client_key)) {
+    		if (policy.verbose) {
         		std::cout << "auth: allowed (CURVE) client_key=" << request.get_client_key() << std::endl;
             }
             user_id = request.get_client_key();
     		return true;
     	}
     	else {
-    		if (verbose) {
+    		if (policy.verbose) {
         		std::cout << "auth: denied (CURVE) client_key=" << request.get_client_key() << std::endl;
             }
     		return false;
@@ -296,17 +475,17 @@ bool auth::authenticate_curve(zap_request& request, std::string &user_id)
 	}    	
 }
 
-bool auth::authenticate_gssapi(zap_request& request) {
-	if (verbose) {
+bool auth::authenticate_gssapi(auth_policy const& policy, zap_request& request) {
+	if (policy.verbose) {
     	std::cout << "auth: allowed (GSSAPI) principal=" << request.get_principal() 
     		<< " identity=" << request.get_identity() << std::endl;
     }
 	return true;	
 }
 
-void auth::authenticate(socket& sock) {
+void auth::authenticate(auth_policy const& policy, zap_cache* cache, socket& sock) {
     // Receive a ZAP request.
-	zap_request request(sock, verbose);
+	zap_request request(sock, policy.verbose);
 
     // will be set by mechanism-dependent code
     std::string user_id;
@@ -316,36 +495,54 @@ void auth::authenticate(socket& sock) {
     	return;     
 	}
 
+    // A client asking again is answered as it was the last time
+    zap_cache::key_t key = { 0, 0 };
+    zap_cache::clock::time_point now;
+    if (cache) {
+        key = cache->digest(request);
+        now = zap_cache::clock::now();
+        zap_cache::decision_t const* const cached = cache->find(key, now);
+        if (cached) {
+            if (policy.verbose) {
+                std::cout << "auth: " << (cached->allowed ? "allowed" : "denied") << " (cached) address="
+                    << request.get_address() << std::endl;
+            }
+            if (cached->allowed)
+                request.reply("200", "OK", cached->user_id);
+            else
+                request.reply("400", "No access", "");
+            return;
+        }
+    }
+
     // Is address explicitly whitelisted or blacklisted?
     bool allowed = false;
     bool denied = false;
 
-    if(whitelist.size()) {
-    	auto search = whitelist.find(request.get_address());
-    	if (search != whitelist.end()) {
+    if(policy.whitelist.size() || !policy.whitelist_ranges.empty()) {
+    	if (listed(policy.whitelist, policy.whitelist_ranges, request.get_address())) {
             allowed = true;
-            if (verbose) {
+            if (policy.verbose) {
                 std::cout << "auth: passed (whitelist) address=" << request.get_address() << std::endl;
             }
         }
         else {
             denied = true;
-            if (verbose) {
+            if (policy.verbose) {
                 std::cout << "auth: denied (not in whitelist) address=" << request.get_address() << std::endl;
             }
         }
 
-    } else if(blacklist.size()) {
-    	auto search = blacklist.find(request.get_address());
-    	if (search != blacklist.end()) {
+    } else if(policy.blacklist.size() || !policy.blacklist_ranges.empty()) {
+    	if (listed(policy.blacklist, policy.blacklist_ranges, request.get_address())) {
             denied = true;
-            if (verbose) {
+            if (policy.verbose) {
                 std::cout << "auth: denied (blacklist) address=" << request.get_address() << std::endl;
             }
         }
         else {
             allowed = true;
-            if (verbose) {
+            if (policy.verbose) {
                 std::cout << "auth: passed (not in blacklist) address=" << request.get_address() << std::endl;
             }
         }
@@ -355,24 +552,27 @@ void auth::authenticate(socket& sock) {
     if(!denied) {
     	if (("NULL" == request.get_mechanism()) && !allowed) {
             // For NULL, we allow if the address wasn't blacklisted
-            if (verbose) {
+            if (policy.verbose) {
                 std::cout << "auth: allowed (NULL)" << std::endl;
             }
             allowed = true;
 
         } else if ("PLAIN" == request.get_mechanism()) {
             // For PLAIN, even a whitelisted address must authenticate
-            allowed = authenticate_plain(request, user_id);
+            allowed = authenticate_plain(policy, request, user_id);
 
         } else if ("CURVE" == request.get_mechanism()) {
             // For CURVE, even a whitelisted address must authenticate
-            allowed = authenticate_curve(request, user_id);
+            allowed = authenticate_curve(policy, request, user_id);
 
         } else if ("GSSAPI" == request.get_mechanism()) {
             // For GSSAPI, even a whitelisted address must authenticate
-            allowed = authenticate_gssapi(request);
+            allowed = authenticate_gssapi(policy, request);
         }
     }
+    if (cache)
+        cache->insert(key, now, allowed, user_id);
+
     if (allowed)
     	request.reply("200", "OK", user_id);
     else
@@ -17,15 +17,22 @@
 #ifndef ZMQPP_AUTH_HPP_
 #define ZMQPP_AUTH_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
 #include <string>
 #include <memory>
 #include <unordered_set>
 #include <unordered_map>
 
 #include "actor.hpp"
+#include "message.hpp"
+#include "auth_policy.hpp"
 #include "poller.hpp"
 #include "socket.hpp"
 #include "context.hpp"
+#include "zap_cache.hpp"
 #include "zap_request.hpp"
 
 
@@ -42,6 +49,13 @@ namespace zmqpp
  * its context. You can whitelist or blacklist peers based on IP address,
  * and define policies for securing PLAIN, CURVE, and GSSAPI connections.
  *
+ * ZAP requests are answered by a pool of worker threads, so a slow check or
+ * a burst of reconnecting clients doesn't hold up every other handshake. The
+ * actor receives the requests on a ROUTER and hands each to the worker that
+ * has been idle longest, one at a time, so a request never waits behind a
+ * slow one while another worker is free. The workers read a shared copy of
+ * the policy that is replaced whole whenever it changes.
+ *
  */
 class ZMQPP_EXPORT auth
 {
@@ -51,8 +65,9 @@ public:
 	 * its context. You can whitelist or blacklist peers based on IP address,
 	 * and define policies for securing PLAIN, CURVE, and GSSAPI connections.
 	 *
+	 * @param workers number of threads answering ZAP requests, at least one.
 	 */
-	auth(context& ctx);
+	auth(context& ctx, size_t workers = 1);
 
 	/**
 	 * Destructor.
@@ -67,18 +82,47 @@ public:
 	 * to whitelist multiple IP addresses. If you whitelist a single address,
 	 * any non-whitelisted addresses are treated as blacklisted.
 	 *
+	 * An IPv4 or IPv6 range in CIDR notation, such as "10.0.0.0/8", allows
+	 * every address in it. Throws zmqpp::exception if a range is malformed.
+	 *
 	 */
     	void allow(const std::string &address);
 
+	/**
+	 * Allow a range of addresses at once, as for allow(), in one round trip
+	 * to the actor.
+	 *
+	 * @param first an iterator to the first address, as a std::string.
+	 * @param last an iterator past the last address.
+	 */
+	template<typename Iterator>
+	void allow(Iterator first, Iterator last) {
+		bulk_command("ALLOW", first, last, &auth_policy::check_address);
+	}
+
     	/**
 	 * Deny (blacklist) a single IP address. For all security mechanisms, this
 	 * rejects the connection without any further authentication. Use either a
      	 * whitelist, or a blacklist, not not both. If you define both a whitelist
      	 * and a blacklist, only the whitelist takes effect.
 	 *
+	 * A range in CIDR notation denies every address in it, as for allow().
+	 *
 	 */
     	void deny(const std::string &address);
 
+	/**
+	 * Deny a range of addresses at once, as for deny(), in one round trip to
+	 * the actor.
+	 *
+	 * @param first an iterator to the first address, as a std::string.
+	 * @param last an iterator past the last address.
+	 */
+	template<typename Iterator>
+	void deny(Iterator first, Iterator last) {
+		bulk_command("DENY", first, last, &auth_policy::check_address);
+	}
+
     	/**
 	 * Configure a ZAP domain. To cover all domains, use "*".
 	 */
@@ -91,14 +135,71 @@ public:
 	 */
     	void configure_plain(const std::string &username, const std::string &password);
 
+	/**
+	 * Configure many PLAIN users at once, in one round trip to the actor.
+	 *
+	 * @param first an iterator to the first user, a pair of std::string
+	 *        holding the username and the password.
+	 * @param last an iterator past the last user.
+	 */
+	template<typename Iterator, typename = typename std::iterator_traits<Iterator>::value_type::first_type>
+	void configure_plain(Iterator first, Iterator last) {
+		message msg;
+		msg << "PLAIN";
+		for (; first != last; ++first) {
+			msg << first->first << first->second;
+		}
+		command(msg);
+	}
+
     	/**
 	 * Configure CURVE authentication. CURVE authentication uses client public keys. 
 	 * This method can be called multiple times. To cover all domains, use "*". 
 	 * To allow all client keys without checking, specify CURVE_ALLOW_ANY for the client_public_key.
 	 *
+	 * The key is z85 encoded, or its 32 binary bytes. Throws zmqpp::exception
+	 * if it is neither.
+	 *
 	 */
     	void configure_curve(const std::string &client_public_key);
 
+	/**
+	 * Configure many CURVE client keys at once, as for configure_curve(), in
+	 * one round trip to the actor.
+	 *
+	 * @param first an iterator to the first key, as a std::string.
+	 * @param last an iterator past the last key.
+	 */
+	template<typename Iterator>
+	void configure_curve(Iterator first, Iterator last) {
+		bulk_command("CURVE", first, last, &auth_policy::check_curve_key);
+	}
+
+	/**
+	 * Replace the whole policy at once, such as one loaded from files with
+	 * auth_policy::load_curve_keys(). Its verbose flag is set by auth.
+	 *
+	 * Workers go on answering with the previous policy until they take their
+	 * next request, none ever sees a mix of the two. The policy isn't copied.
+	 *
+	 * @param policy the new policy.
+	 */
+	void configure(auth_policy policy);
+
+	/**
+	 * Cache ZAP decisions, so a client connecting again with the same
+	 * mechanism, address and credentials is answered without checking the
+	 * policy. Decisions are keyed by a digest, no credentials are kept.
+	 *
+	 * Each worker keeps its own cache and empties it whenever the
+	 * configuration changes. Off by default.
+	 *
+	 * @param entries the most decisions each worker keeps, 0 to turn the
+	 *        cache off.
+	 * @param ttl how long a decision is kept.
+	 */
+	void configure_cache(size_t entries, std::chrono::milliseconds ttl);
+
     	/**
 	 * Configure GSSAPI authentication. GSSAPI authentication uses an underlying 
 	 * mechanism (usually Kerberos) to establish a secure context and perform mutual 
@@ -118,44 +219,88 @@ private:
 	 * Handle an authentication command from calling application.
 	 *
 	 */
-    	void handle_command(socket& pipe);
+	void handle_command(socket& pipe);
+
+	/**
+	 * Send a command to the actor and wait until it's done.
+	 *
+	 */
+	void command(message& msg);
+
+	/**
+	 * Send a command with one frame per item, checking each item first.
+	 *
+	 */
+	template<typename Iterator>
+	void bulk_command(const char *name, Iterator first, Iterator last, void (*check)(const std::string &)) {
+		message msg;
+		msg << name;
+		for (; first != last; ++first) {
+			check(*first);
+			msg << *first;
+		}
+		command(msg);
+	}
+
+	/**
+	 * The configured policy, ready to be changed. A published policy is
+	 * copied first, as workers may be reading it.
+	 *
+	 */
+	auth_policy& editable_policy();
+
+	/**
+	 * Publish the configured policy to the workers if it changed since it
+	 * was last published.
+	 *
+	 */
+	void publish();
+
+	/**
+	 * Run a worker, answering the ZAP requests the actor hands out.
+	 *
+	 * @param pipe the worker's actor pipe, it only stops the worker.
+	 * @param ctx the context to create the worker's socket in.
+	 * @param endpoint where the actor hands out requests.
+	 */
+	bool serve(socket* pipe, context& ctx, std::string const& endpoint);
 
 	/**
 	 * Handle a PLAIN authentication request from libzmq core
 	 *
 	 * @param user_id store the user as the User-Id.
 	 */
-    	bool authenticate_plain(zap_request& request, std::string &user_id);
+	static bool authenticate_plain(auth_policy const& policy, zap_request& request, std::string &user_id);
 
 	/**
 	 * Handle a CURVE authentication request from libzmq core
 	 *
 	 * @param user_id store the public key (z85 encoded) as the User-Id.
 	 */
-    	bool authenticate_curve(zap_request& request, std::string &user_id);
+	static bool authenticate_curve(auth_policy const& policy, zap_request& request, std::string &user_id);
 
-    	/**
+	/**
 	 * Handle a GSSAPI authentication request from libzmq core
 	 *
 	 */
-    	bool authenticate_gssapi(zap_request& request);
+	static bool authenticate_gssapi(auth_policy const& policy, zap_request& request);
 
-    	/**
-     	 * Authentication.
-     	 *
-     	 */
-    	void authenticate(socket& sock);
-    
-    	std::shared_ptr<actor>    		 	authenticator;	// ZAP authentication actor
-    	poller 	            			 	auth_poller;	 // Socket poller
-    	std::unordered_set<std::string> 		whitelist;      // Whitelisted addresses
-    	std::unordered_set<std::string> 		blacklist;      // Blacklisted addresses
-    	std::unordered_map<std::string, std::string> 	passwords;      // PLAIN passwords, if loaded
-    	std::unordered_set<std::string> 		client_keys;    // Client public keys
-    	std::string 				 	domain;			// ZAP domain
-    	bool                        curve_allow_any;      // CURVE allows arbitrary clients
-    	bool 					 	terminated;     // Did caller ask us to quit?
-    	bool 					 	verbose;        // Verbose logging enabled?
+	/**
+	 * Authentication.
+	 *
+	 * @param cache decisions to answer from and add to, or null.
+	 */
+	static void authenticate(auth_policy const& policy, zap_cache* cache, socket& sock);
+
+	std::shared_ptr<actor>          authenticator;      // ZAP authentication actor
+	poller                          auth_poller;        // Socket poller
+	std::shared_ptr<auth_policy>    policy;             // Policy as configured, owned by the actor
+	bool                            policy_changed;     // Changed since last published?
+	bool                            policy_published;   // Shared with the workers?
+	std::shared_ptr<auth_policy const> published_policy; // Policy the workers read
+	std::atomic<uint64_t>           policy_generation;  // Counts published policies
+	bool                            terminated;         // Did caller ask us to quit?
+	bool                            verbose;            // Verbose logging enabled?
 
 #	if defined(ZMQPP_NO_CONSTEXPR)
         static const char * const zap_endpoint_;
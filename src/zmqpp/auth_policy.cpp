@@ -0,0 +1,321 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "auth_policy.hpp"
+#include "exception.hpp"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if (ZMQ_VERSION_MAJOR > 3)
+
+namespace zmqpp
+{
+
+#ifndef _WIN32
+    namespace
+    {
+        // a file mapped read only for as long as it is in scope
+        class mapped_file
+        {
+        public:
+            explicit mapped_file(std::string const& path) :
+            data_(nullptr),
+            size_(0)
+            {
+                int const fd = open(path.c_str(), O_RDONLY);
+                if (fd < 0)
+                {
+                    throw exception("unable to open " + path);
+                }
+
+                struct stat info;
+                if (0 != fstat(fd, &info))
+                {
+                    ::close(fd);
+                    throw exception("unable to read " + path);
+                }
+
+                // an empty file can't be mapped and has no lines anyway
+                size_ = static_cast<size_t>(info.st_size);
+                void* const data = (size_ > 0) ? mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+                ::close(fd);
+                if (MAP_FAILED == data)
+                {
+                    throw exception("unable to map " + path);
+                }
+
+                data_ = static_cast<char const*>(data);
+                if (nullptr != data_)
+                {
+                    madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+                }
+            }
+
+            ~mapped_file()
+            {
+                if (nullptr != data_)
+                {
+                    munmap(const_cast<char*>(data_), size_);
+                }
+            }
+
+            char const* begin() const { return data_; }
+            char const* end() const { return data_ + size_; }
+
+        private:
+            char const* data_;
+            size_t size_;
+
+            mapped_file(mapped_file const&) ZMQPP_EXPLICITLY_DELETED;
+            mapped_file& operator=(mapped_file const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+        };
+
+        bool is_space(char const c)
+        {
+            return ' ' == c || '\t' == c || '\r' == c || '\n' == c;
+        }
+
+        void trim(char const*& begin, char const*& end)
+        {
+            while (begin < end && is_space(*begin))
+                ++begin;
+            while (end > begin && is_space(*(end - 1)))
+                --end;
+        }
+
+        // call line(begin, end, number) with each line that isn't blank,
+        // trimmed. Comments are left to the caller, as # is also a z85 digit
+        template<typename Line>
+        void for_each_line(std::string const& path, Line line)
+        {
+            mapped_file const file(path);
+
+            size_t number = 0;
+            for (char const* start = file.begin(); start < file.end();)
+            {
+                char const* stop = static_cast<char const*>(std::memchr(start, '\n', file.end() - start));
+                if (nullptr == stop)
+                    stop = file.end();
+                ++number;
+
+                char const* begin = start;
+                char const* end = stop;
+                trim(begin, end);
+                if (begin < end)
+                    line(begin, end, number);
+
+                start = stop + 1;
+            }
+        }
+
+        std::string location(std::string const& path, size_t const number)
+        {
+            return path + ":" + std::to_string(number);
+        }
+    }
+#endif
+
+    auth_policy::auth_policy() :
+    whitelist(),
+    blacklist(),
+    whitelist_ranges(),
+    blacklist_ranges(),
+    passwords(),
+    client_keys(),
+    domain(),
+    curve_allow_any(false),
+    verbose(false),
+    cache_entries(0),
+    cache_ttl(0)
+    {
+    }
+
+    void auth_policy::check_address(std::string const& address)
+    {
+        cidr_set::address_t parsed;
+        size_t prefix_length = 0;
+        if ((std::string::npos != address.find('/')) && !cidr_set::parse(address, parsed, prefix_length))
+        {
+            throw exception("invalid address range: " + address);
+        }
+    }
+
+    void auth_policy::check_curve_key(std::string const& client_public_key)
+    {
+        curve_key_set::key_t key;
+        if (("CURVE_ALLOW_ANY" != client_public_key) && !curve_key_set::parse(client_public_key, key))
+        {
+            throw exception("invalid CURVE client public key");
+        }
+    }
+
+    void auth_policy::allow(std::string const& address)
+    {
+        check_address(address);
+        if (!whitelist_ranges.insert(address))
+            whitelist.insert(address);
+    }
+
+    void auth_policy::deny(std::string const& address)
+    {
+        check_address(address);
+        if (!blacklist_ranges.insert(address))
+            blacklist.insert(address);
+    }
+
+    void auth_policy::configure_domain(std::string const& domain)
+    {
+        this->domain = domain;
+    }
+
+    void auth_policy::configure_plain(std::string const& username, std::string const& password)
+    {
+        passwords.insert(std::make_pair(username, password));
+    }
+
+    void auth_policy::configure_curve(std::string const& client_public_key)
+    {
+        // If client_public_key is CURVE_ALLOW_ANY, allow all clients. Otherwise
+        // treat client_public_key as client public key certificate.
+        if ("CURVE_ALLOW_ANY" == client_public_key)
+        {
+            curve_allow_any = true;
+            return;
+        }
+
+        curve_allow_any = false;
+        if (!client_keys.insert(client_public_key))
+        {
+            throw exception("invalid CURVE client public key");
+        }
+    }
+
+    void auth_policy::configure_cache(size_t const entries, std::chrono::milliseconds const ttl)
+    {
+        cache_entries = (ttl > std::chrono::milliseconds::zero()) ? entries : 0;
+        cache_ttl = ttl;
+    }
+
+#ifndef _WIN32
+    size_t auth_policy::load_curve_keys(std::string const& path)
+    {
+        struct stat info;
+        if (0 != stat(path.c_str(), &info))
+        {
+            throw exception("unable to read " + path);
+        }
+
+        std::vector<std::string> files;
+        if (S_ISDIR(info.st_mode))
+        {
+            DIR* dir = opendir(path.c_str());
+            if (nullptr == dir)
+            {
+                throw exception("unable to read key directory " + path);
+            }
+
+            while (dirent* entry = readdir(dir))
+            {
+                std::string const file = path + "/" + entry->d_name;
+                if ('.' != entry->d_name[0] && 0 == stat(file.c_str(), &info) && S_ISREG(info.st_mode))
+                    files.push_back(file);
+            }
+            closedir(dir);
+            std::sort(files.begin(), files.end());
+        }
+        else
+        {
+            files.push_back(path);
+        }
+
+        size_t const key_length = curve_key_set::key_size * 5 / 4;
+        size_t loaded = 0;
+        for (std::string const& file : files)
+        {
+            for_each_line(file, [this, &file, &loaded, key_length](char const* begin, char const* end, size_t const number) {
+                // = and # are both z85 digits, a line a key long is taken
+                // as a key before it can be a comment or a certificate line
+                if (key_length == static_cast<size_t>(end - begin) && client_keys.insert(std::string(begin, end)))
+                {
+                    ++loaded;
+                    return;
+                }
+
+                if ('#' == *begin)
+                    return;
+
+                char const* const equals = static_cast<char const*>(std::memchr(begin, '=', end - begin));
+                if (nullptr != equals)
+                {
+                    // a certificate line, only its public key is wanted
+                    char const* name_end = equals;
+                    trim(begin, name_end);
+                    static char const public_key[] = "public-key";
+                    if (sizeof(public_key) - 1 != static_cast<size_t>(name_end - begin) ||
+                        0 != std::memcmp(begin, public_key, sizeof(public_key) - 1))
+                        return;
+
+                    begin = equals + 1;
+                    trim(begin, end);
+                    if (end - begin >= 2 && '"' == *begin && '"' == *(end - 1))
+                    {
+                        ++begin;
+                        --end;
+                    }
+                }
+                else if (key_length != static_cast<size_t>(end - begin))
+                {
+                    // a certificate section name, a line a key long that
+                    // isn't one is reported below
+                    return;
+                }
+
+                if (!client_keys.insert(std::string(begin, end)))
+                {
+                    throw exception("invalid CURVE key at " + location(file, number));
+                }
+                ++loaded;
+            });
+        }
+        return loaded;
+    }
+
+    size_t auth_policy::load_passwords(std::string const& path)
+    {
+        size_t loaded = 0;
+        for_each_line(path, [this, &path, &loaded](char const* begin, char const* end, size_t const number) {
+            if ('#' == *begin)
+                return;
+
+            char const* const equals = static_cast<char const*>(std::memchr(begin, '=', end - begin));
+            if (nullptr == equals || begin == equals)
+            {
+                throw exception("invalid password line at " + location(path, number));
+            }
+
+            configure_plain(std::string(begin, equals), std::string(equals + 1, end));
+            ++loaded;
+        });
+        return loaded;
+    }
+#endif
+
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <zmq.h>
+#include "compatibility.hpp"
+#include "cidr_set.hpp"
+#include "curve_key_set.hpp"
+
+// Authentication is something from zmq 4
+#if (ZMQ_VERSION_MAJOR > 3)
+
+namespace zmqpp
+{
+
+    /**
+     * Everything auth checks a ZAP request against.
+     *
+     * An auth actor keeps one and changes it as it is configured. A policy can
+     * also be built apart, loading keys and passwords from files, then handed
+     * to auth::configure() to replace the one in use at once.
+     */
+    class auth_policy
+    {
+    public:
+        /**
+         * An empty policy, allowing every NULL client and no PLAIN or CURVE one.
+         */
+        ZMQPP_EXPORT auth_policy();
+
+        /**
+         * Throws zmqpp::exception if the address looks like a range, having a
+         * '/', but isn't a valid one. Any other address is matched as text.
+         */
+        ZMQPP_EXPORT static void check_address(std::string const& address);
+
+        /**
+         * Throws zmqpp::exception if the key is neither a z85 encoded key, 32
+         * binary bytes nor CURVE_ALLOW_ANY.
+         */
+        ZMQPP_EXPORT static void check_curve_key(std::string const& client_public_key);
+
+        /**
+         * Allow an IP address or range, see auth::allow().
+         */
+        ZMQPP_EXPORT void allow(std::string const& address);
+
+        /**
+         * Deny an IP address or range, see auth::deny().
+         */
+        ZMQPP_EXPORT void deny(std::string const& address);
+
+        /**
+         * Set the ZAP domain, see auth::configure_domain().
+         */
+        ZMQPP_EXPORT void configure_domain(std::string const& domain);
+
+        /**
+         * Add a PLAIN user, a known user keeps the password it has.
+         */
+        ZMQPP_EXPORT void configure_plain(std::string const& username, std::string const& password);
+
+        /**
+         * Add a CURVE client key, or allow every client with CURVE_ALLOW_ANY.
+         */
+        ZMQPP_EXPORT void configure_curve(std::string const& client_public_key);
+
+        /**
+         * Cache ZAP decisions, see auth::configure_cache().
+         */
+        ZMQPP_EXPORT void configure_cache(size_t const entries, std::chrono::milliseconds const ttl);
+
+#ifndef _WIN32
+        /**
+         * Add the CURVE client keys of a file, or of every file in a directory
+         * such as a certificate store. The files are memory mapped and parsed
+         * in place.
+         *
+         * A line is either a key on its own or a certificate's
+         * public-key = "<key>" line, keys being z85 encoded. A line as long as
+         * a key is read as one first, as # and = are z85 digits. Otherwise
+         * blank lines, lines starting with # and other certificate lines are
+         * skipped.
+         *
+         * Throws zmqpp::exception if a file can't be read or holds a bad key.
+         *
+         * \param path a file or a directory.
+         * \return the number of keys read.
+         */
+        ZMQPP_EXPORT size_t load_curve_keys(std::string const& path);
+
+        /**
+         * Add the PLAIN users of a password file, memory mapped and parsed in
+         * place. Each line is username=password, blank lines and lines starting
+         * with # are skipped.
+         *
+         * Throws zmqpp::exception if the file can't be read or a line has no '='.
+         *
+         * \param path the password file.
+         * \return the number of users read.
+         */
+        ZMQPP_EXPORT size_t load_passwords(std::string const& path);
+#endif
+
+        std::unordered_set<std::string> whitelist;                  //!< Whitelisted addresses that aren't IPs
+        std::unordered_set<std::string> blacklist;                  //!< Blacklisted addresses that aren't IPs
+        cidr_set whitelist_ranges;                                  //!< Whitelisted IP ranges
+        cidr_set blacklist_ranges;                                  //!< Blacklisted IP ranges
+        std::unordered_map<std::string, std::string> passwords;     //!< PLAIN passwords, if loaded
+        curve_key_set client_keys;                                  //!< Client public keys, in binary
+        std::string domain;                                         //!< ZAP domain
+        bool curve_allow_any;                                       //!< CURVE allows arbitrary clients
+        bool verbose;                                               //!< Log ZAP requests and replies, set by auth
+        size_t cache_entries;                                       //!< Decisions each worker caches, none if 0
+        std::chrono::milliseconds cache_ttl;                        //!< How long a cached decision lasts
+    };
+
+}
+
+#endif
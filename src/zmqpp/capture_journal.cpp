@@ -0,0 +1,584 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#include "capture_journal.hpp"
+#include "exception.hpp"
+#include "poller.hpp"
+#include "socket.hpp"
+
+#ifndef _WIN32
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace zmqpp
+{
+
+    namespace
+    {
+        // Segments are named by their zero padded number so they sort in order,
+        // and hold a header followed by records, each aligned to eight bytes:
+        //
+        //   record_header, then per part a uint32_t size and the part's bytes
+        //
+        // A record's length is stored last, so a zero length marks the end of
+        // the records written so far. Everything is in host byte order.
+        char const segment_magic[8] = { 'Z', 'M', 'Q', 'P', 'P', 'J', 'N', 'L' };
+        uint32_t const segment_version = 1;
+        char const segment_suffix[] = ".segment";
+        size_t const segment_digits = 20;
+        char const index_name[] = "index";
+
+        struct segment_header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t header_size;
+        };
+
+        struct record_header
+        {
+            uint32_t length;
+            uint32_t parts;
+            int64_t timestamp;
+            uint8_t direction;
+            uint8_t reserved[7];
+        };
+
+        static_assert(sizeof(record_header) == 24, "journal record header must be packed");
+        static_assert(sizeof(journal_segment) == 40, "journal index entry must be packed");
+
+        // matches proxy_engine::direction::backend_to_frontend
+        uint8_t const backend_to_frontend = 1;
+
+        // most messages journaled before checking for a stop again
+        size_t const batch_size = 256;
+
+        size_t aligned(size_t const size)
+        {
+            return (size + 7) & ~static_cast<size_t>(7);
+        }
+
+        std::string segment_path(std::string const& directory, uint64_t const number)
+        {
+            std::string name = std::to_string(number);
+            name.insert(0, segment_digits - std::min(segment_digits, name.size()), '0');
+            return directory + "/" + name + segment_suffix;
+        }
+
+        // the sorted numbers of the segments in a directory
+        std::vector<uint64_t> find_segments(std::string const& directory)
+        {
+            DIR* dir = opendir(directory.c_str());
+            if (nullptr == dir)
+            {
+                throw exception("unable to read journal directory " + directory);
+            }
+
+            std::vector<uint64_t> numbers;
+            size_t const name_length = segment_digits + sizeof(segment_suffix) - 1;
+            while (dirent* entry = readdir(dir))
+            {
+                std::string const name(entry->d_name);
+                if (name.size() != name_length || segment_digits != name.find_first_not_of("0123456789")
+                    || 0 != name.compare(segment_digits, std::string::npos, segment_suffix))
+                    continue;
+                numbers.push_back(std::strtoull(name.c_str(), nullptr, 10));
+            }
+            closedir(dir);
+
+            std::sort(numbers.begin(), numbers.end());
+            return numbers;
+        }
+
+        size_t page_size()
+        {
+            static size_t const size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        int64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    const uint8_t journal_writer::untagged;
+    const size_t journal_writer::default_segment_size;
+
+    journal_writer::journal_writer(std::string const& directory, size_t const segment_size /* = default_segment_size */) :
+    directory_(directory),
+    segment_size_(segment_size),
+    next_segment_(0),
+    records_(0),
+    stop_notifier_(),
+    fd_(-1),
+    data_(nullptr),
+    capacity_(0),
+    current_()
+    {
+        if (0 != mkdir(directory.c_str(), 0755) && EEXIST != errno)
+        {
+            throw exception("unable to create journal directory " + directory);
+        }
+
+        std::vector<uint64_t> const existing = find_segments(directory);
+        if (!existing.empty())
+        {
+            next_segment_ = existing.back() + 1;
+        }
+    }
+
+    journal_writer::~journal_writer()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void journal_writer::append(uint8_t const direction, message const& msg)
+    {
+        append(std::chrono::nanoseconds(now()), direction, msg);
+    }
+
+    void journal_writer::append(std::chrono::nanoseconds const timestamp, uint8_t const direction, message const& msg)
+    {
+        size_t length = sizeof(record_header);
+        for (size_t i = 0; i < msg.parts(); ++i)
+        {
+            length += sizeof(uint32_t) + msg.size(i);
+        }
+        length = aligned(length);
+
+        if (length > std::numeric_limits<uint32_t>::max())
+        {
+            throw exception("message too large for a journal record");
+        }
+
+        if (nullptr == data_ || current_.size + length > capacity_)
+        {
+            close();
+            open_segment(length);
+        }
+
+        char* const record = data_ + current_.size;
+
+        record_header header;
+        std::memset(&header, 0, sizeof(header));
+        header.parts = static_cast<uint32_t>(msg.parts());
+        header.timestamp = timestamp.count();
+        header.direction = direction;
+        std::memcpy(record, &header, sizeof(header));
+
+        char* at = record + sizeof(header);
+        for (size_t i = 0; i < msg.parts(); ++i)
+        {
+            uint32_t const size = static_cast<uint32_t>(msg.size(i));
+            std::memcpy(at, &size, sizeof(size));
+            std::memcpy(at + sizeof(size), msg.raw_data(i), size);
+            at += sizeof(size) + size;
+        }
+
+        // published last, a reader never sees the length of a partial record
+        __atomic_store_n(reinterpret_cast<uint32_t*>(record), static_cast<uint32_t>(length), __ATOMIC_RELEASE);
+
+        if (0 == current_.records)
+        {
+            current_.first_timestamp = header.timestamp;
+        }
+        current_.last_timestamp = header.timestamp;
+        ++current_.records;
+        current_.size += length;
+        ++records_;
+    }
+
+    void journal_writer::flush()
+    {
+        if (nullptr != data_ && 0 != msync(data_, current_.size, MS_SYNC))
+        {
+            throw exception("unable to flush journal segment");
+        }
+    }
+
+    void journal_writer::close()
+    {
+        if (nullptr == data_)
+            return;
+
+        // cut back to its records so short lived writers don't leave
+        // preallocated space behind
+        munmap(data_, capacity_);
+        int const rc = ftruncate(fd_, static_cast<off_t>(current_.size));
+        (void) rc; // a segment left at full size still reads back
+        ::close(fd_);
+        data_ = nullptr;
+        fd_ = -1;
+
+        std::string const path = directory_ + "/" + index_name;
+        int const index = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (index < 0)
+        {
+            throw exception("unable to open journal index " + path);
+        }
+        ssize_t const written = write(index, &current_, sizeof(current_));
+        ::close(index);
+        if (written != static_cast<ssize_t>(sizeof(current_)))
+        {
+            throw exception("unable to write journal index " + path);
+        }
+    }
+
+    void journal_writer::open_segment(size_t const needed)
+    {
+        capacity_ = std::max(segment_size_, sizeof(segment_header) + needed);
+
+        // built under a temporary name so readers only ever see whole segments
+        std::string const path = segment_path(directory_, next_segment_);
+        std::string const building = path + ".tmp";
+        int const fd = open(building.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            throw exception("unable to create journal segment " + building);
+        }
+
+#if defined(__linux__)
+        bool const sized = (0 == posix_fallocate(fd, 0, static_cast<off_t>(capacity_)));
+#else
+        bool const sized = (0 == ftruncate(fd, static_cast<off_t>(capacity_)));
+#endif
+        void* const data = sized ? mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        if (MAP_FAILED == data)
+        {
+            ::close(fd);
+            unlink(building.c_str());
+            throw exception("unable to allocate journal segment " + building);
+        }
+
+        segment_header header;
+        std::memcpy(header.magic, segment_magic, sizeof(segment_magic));
+        header.version = segment_version;
+        header.header_size = sizeof(header);
+        std::memcpy(data, &header, sizeof(header));
+
+        if (0 != rename(building.c_str(), path.c_str()))
+        {
+            munmap(data, capacity_);
+            ::close(fd);
+            unlink(building.c_str());
+            throw exception("unable to create journal segment " + path);
+        }
+
+        fd_ = fd;
+        data_ = static_cast<char*>(data);
+        current_ = journal_segment();
+        current_.number = next_segment_++;
+        current_.size = sizeof(header);
+    }
+
+    void journal_writer::record(socket_t& capture, bool const tagged)
+    {
+        poller poller;
+        poller.add(capture, poller::poll_in);
+        poller.add(stop_notifier_.fd(), poller::poll_in);
+
+        message msg;
+        try
+        {
+            for(;;)
+            {
+                poller.poll();
+
+                if (poller.has_input(stop_notifier_.fd()))
+                {
+                    stop_notifier_.consume();
+                    return;
+                }
+
+                for (size_t i = 0; i < batch_size && capture.receive(msg, true); ++i)
+                {
+                    uint8_t direction = untagged;
+                    if (tagged && msg.parts() > 1 && 1 == msg.size(0))
+                    {
+                        direction = *static_cast<uint8_t const*>(msg.raw_data(0));
+                        msg.pop_front();
+                    }
+                    append(direction, msg);
+                }
+            }
+        }
+        catch (zmq_internal_exception const& e)
+        {
+            if (ETERM != e.zmq_error())
+                throw;
+        }
+    }
+
+    void journal_writer::stop()
+    {
+        stop_notifier_.notify();
+    }
+
+    journal_reader::journal_reader(std::string const& directory) :
+    directory_(directory),
+    index_(),
+    numbers_(find_segments(directory)),
+    position_(0),
+    fd_(-1),
+    data_(nullptr),
+    size_(0),
+    offset_(0)
+    {
+        if (numbers_.empty())
+        {
+            throw exception("no journal segments in " + directory);
+        }
+
+        std::string const path = directory_ + "/" + index_name;
+        int const index = open(path.c_str(), O_RDONLY);
+        if (index >= 0)
+        {
+            journal_segment entry;
+            while (sizeof(entry) == read(index, &entry, sizeof(entry)))
+            {
+                index_.push_back(entry);
+            }
+            ::close(index);
+        }
+    }
+
+    journal_reader::~journal_reader()
+    {
+        close_segment();
+    }
+
+    void journal_reader::seek(std::chrono::nanoseconds const timestamp)
+    {
+        close_segment();
+        position_ = 0;
+
+        // segments are in time order, start at the last one starting in time
+        for (journal_segment const& segment : index_)
+        {
+            if (segment.first_timestamp > timestamp.count())
+                break;
+
+            auto const found = std::lower_bound(numbers_.begin(), numbers_.end(), segment.number);
+            if (found != numbers_.end() && *found == segment.number)
+                position_ = static_cast<size_t>(found - numbers_.begin());
+        }
+
+        while (advance())
+        {
+            record_header const* header = reinterpret_cast<record_header const*>(data_ + offset_);
+            if (header->timestamp >= timestamp.count())
+                break;
+            offset_ += header->length;
+        }
+    }
+
+    bool journal_reader::next(journal_record& record)
+    {
+        if (!advance())
+            return false;
+
+        record_header const* header = reinterpret_cast<record_header const*>(data_ + offset_);
+        char const* const end = data_ + offset_ + header->length;
+        char const* at = data_ + offset_ + sizeof(record_header);
+
+        record.timestamp = std::chrono::nanoseconds(header->timestamp);
+        record.direction = header->direction;
+        record.msg = message();
+        for (uint32_t i = 0; i < header->parts; ++i)
+        {
+            uint32_t size;
+            if (at + sizeof(size) > end)
+            {
+                throw exception("corrupt journal record");
+            }
+            std::memcpy(&size, at, sizeof(size));
+            at += sizeof(size);
+            if (size > static_cast<size_t>(end - at))
+            {
+                throw exception("corrupt journal record");
+            }
+            record.msg.push_back(at, size);
+            at += size;
+        }
+
+        offset_ += header->length;
+        return true;
+    }
+
+    uint64_t journal_reader::replay(socket_t& to_backend, socket_t* to_frontend, double const speed /* = 1.0 */)
+    {
+        typedef std::chrono::steady_clock clock;
+
+        journal_record record;
+        uint64_t sent = 0;
+        bool first = true;
+        std::chrono::nanoseconds origin(0);
+        clock::time_point start;
+
+        while (next(record))
+        {
+            if (speed > 0)
+            {
+                if (first)
+                {
+                    origin = record.timestamp;
+                    start = clock::now();
+                    first = false;
+                }
+                else
+                {
+                    std::chrono::duration<double, std::nano> const offset = (record.timestamp - origin) / speed;
+                    std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(offset));
+                }
+            }
+
+            socket_t* const target = (backend_to_frontend == record.direction) ? to_frontend : &to_backend;
+            if (nullptr == target)
+                continue;
+
+            target->send(record.msg);
+            ++sent;
+        }
+        return sent;
+    }
+
+    void journal_reader::list_segments()
+    {
+        numbers_ = find_segments(directory_);
+    }
+
+    void journal_reader::open_segment()
+    {
+        std::string const path = segment_path(directory_, numbers_[position_]);
+        int const fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw exception("unable to open journal segment " + path);
+        }
+
+        struct stat info;
+        void* data = MAP_FAILED;
+        if (0 == fstat(fd, &info) && static_cast<size_t>(info.st_size) >= sizeof(segment_header))
+        {
+            data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        if (MAP_FAILED == data)
+        {
+            ::close(fd);
+            throw exception("unable to map journal segment " + path);
+        }
+
+        segment_header header;
+        std::memcpy(&header, data, sizeof(header));
+        if (0 != std::memcmp(header.magic, segment_magic, sizeof(segment_magic)) || segment_version != header.version
+            || header.header_size < sizeof(header) || header.header_size > static_cast<size_t>(info.st_size))
+        {
+            munmap(data, static_cast<size_t>(info.st_size));
+            ::close(fd);
+            throw exception("not a journal segment " + path);
+        }
+
+        fd_ = fd;
+        data_ = static_cast<char const*>(data);
+        size_ = static_cast<size_t>(info.st_size);
+        offset_ = header.header_size;
+    }
+
+    void journal_reader::close_segment()
+    {
+        if (nullptr == data_)
+            return;
+
+        munmap(const_cast<char*>(data_), size_);
+        ::close(fd_);
+        data_ = nullptr;
+        fd_ = -1;
+    }
+
+    bool journal_reader::has_record() const
+    {
+        if (offset_ + sizeof(record_header) > size_)
+            return false;
+
+        // A segment being followed may be cut back to its records when it is
+        // closed, and a mapped page wholly past the end of the file faults. The
+        // records before offset_ keep its page, so only a record starting a new
+        // page is read from the file instead.
+        uint32_t length = 0;
+        if (0 != offset_ % page_size())
+        {
+            length = __atomic_load_n(reinterpret_cast<uint32_t const*>(data_ + offset_), __ATOMIC_ACQUIRE);
+        }
+        else
+        {
+            if (static_cast<ssize_t>(sizeof(length)) != pread(fd_, &length, sizeof(length), static_cast<off_t>(offset_)))
+                length = 0;
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        if (0 == length)
+            return false;
+        if (length < sizeof(record_header) || length > size_ - offset_)
+        {
+            throw exception("corrupt journal record");
+        }
+        return true;
+    }
+
+    bool journal_reader::advance()
+    {
+        for(;;)
+        {
+            if (nullptr == data_)
+            {
+                if (position_ >= numbers_.size())
+                    return false;
+                open_segment();
+            }
+
+            if (has_record())
+                return true;
+
+            // the writer only moves on once a segment is full, so if the next
+            // segment exists this one is done once it is checked again
+            if (position_ + 1 >= numbers_.size())
+            {
+                list_segments();
+                if (position_ + 1 >= numbers_.size())
+                    return false;
+                if (has_record())
+                    return true;
+            }
+
+            close_segment();
+            ++position_;
+        }
+    }
+
+}
+
+#endif
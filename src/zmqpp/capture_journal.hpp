@@ -0,0 +1,247 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "compatibility.hpp"
+#include "message.hpp"
+
+#ifndef _WIN32
+
+#include "event_notifier.hpp"
+
+namespace zmqpp
+{
+    class socket;
+    typedef socket socket_t;
+
+    /**
+     * One message read back from a journal.
+     */
+    struct journal_record
+    {
+        std::chrono::nanoseconds timestamp; /*!< when it was journaled, since the system clock epoch */
+        uint8_t direction;                  /*!< a proxy_engine::direction value, or journal_writer::untagged */
+        message msg;                        /*!< the message parts */
+    };
+
+    /**
+     * Summary of one closed journal segment, as kept in the journal index.
+     */
+    struct journal_segment
+    {
+        uint64_t number;          /*!< the segment's sequence number */
+        int64_t first_timestamp;  /*!< timestamp of its first record, in nanoseconds */
+        int64_t last_timestamp;   /*!< timestamp of its last record, in nanoseconds */
+        uint64_t records;         /*!< records it holds */
+        uint64_t size;            /*!< bytes of the segment file in use */
+    };
+
+    /**
+     * Appends messages to a journal: a directory of numbered segment files plus
+     * an index of the closed segments.
+     *
+     * Each segment is created at its full size and memory mapped, so appending a
+     * record is a copy into memory with no system call. Once a record doesn't fit
+     * the segment is cut back to its records, indexed and the next one started,
+     * a record larger than a segment gets a segment of its own. Writing to the page cache leaves it to
+     * the system when data reaches disk, call flush() where that matters.
+     *
+     * Each record keeps a timestamp, a direction and all the parts of a message.
+     * The writer's record() method drains a proxy capture socket into the
+     * journal, so traffic is persisted off the proxy's thread.
+     *
+     * A writer is not thread safe, other than stop(). Only one writer should use
+     * a directory at a time, a new writer carries on after its last segment.
+     */
+    class journal_writer
+    {
+    public:
+        /**
+         * Direction of records whose direction is not known, such as those from an
+         * untagged capture.
+         */
+        static const uint8_t untagged = 0xff;
+
+        /**
+         * Default size of a segment file, in bytes.
+         */
+        static const size_t default_segment_size = 64 * 1024 * 1024;
+
+        /**
+         * Open a journal for appending, creating the directory if it is missing.
+         *
+         * Throws zmqpp::exception if the directory can't be used.
+         *
+         * \param directory where segments and the index are kept.
+         * \param segment_size bytes to preallocate for each segment.
+         */
+        ZMQPP_EXPORT journal_writer(std::string const& directory, size_t const segment_size = default_segment_size);
+
+        /**
+         * Close the current segment, dropping any error doing so.
+         */
+        ZMQPP_EXPORT ~journal_writer();
+
+        /**
+         * Append a message timestamped with the current system time.
+         *
+         * \param direction the direction the message went in.
+         * \param msg the message to record, it is left untouched.
+         */
+        ZMQPP_EXPORT void append(uint8_t const direction, message const& msg);
+
+        /**
+         * Append a message with a given timestamp, timestamps should not go back.
+         *
+         * \param timestamp nanoseconds since the system clock epoch.
+         * \param direction the direction the message went in.
+         * \param msg the message to record, it is left untouched.
+         */
+        ZMQPP_EXPORT void append(std::chrono::nanoseconds const timestamp, uint8_t const direction, message const& msg);
+
+        /**
+         * Write the current segment's records to disk, blocking until done.
+         */
+        ZMQPP_EXPORT void flush();
+
+        /**
+         * Cut the current segment back to its records and index it, the next
+         * append starts a new one.
+         */
+        ZMQPP_EXPORT void close();
+
+        /**
+         * Journal everything received on a capture socket until stop() is called
+         * or the context is terminated.
+         *
+         * Messages are timestamped as they are read. Captures from a proxy_engine
+         * with a tagged capture keep their direction, others are recorded as
+         * untagged.
+         *
+         * \param capture a socket receiving a proxy's capture, such as a PULL or SUB.
+         * \param tagged true if each message starts with a direction frame.
+         */
+        ZMQPP_EXPORT void record(socket_t& capture, bool const tagged);
+
+        /**
+         * Make record() return after the current batch. Safe to call from any
+         * thread, a stop requested before record() is called makes it return at once.
+         */
+        ZMQPP_EXPORT void stop();
+
+        /**
+         * \return records appended by this writer.
+         */
+        uint64_t records() const { return records_; }
+
+    private:
+        std::string directory_;
+        size_t segment_size_;
+        uint64_t next_segment_;
+        uint64_t records_;
+        event_notifier stop_notifier_;
+
+        // the open segment, data_ is null when there is none
+        int fd_;
+        char* data_;
+        size_t capacity_;
+        journal_segment current_;
+
+        void open_segment(size_t const needed);
+
+        // No copy - private and not implemented
+        journal_writer(journal_writer const&) ZMQPP_EXPLICITLY_DELETED;
+        journal_writer& operator=(journal_writer const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+    /**
+     * Reads a journal back in the order it was written, including a segment
+     * still being written, up to its last complete record.
+     */
+    class journal_reader
+    {
+    public:
+        /**
+         * Open a journal for reading.
+         *
+         * Throws zmqpp::exception if the directory holds no journal.
+         *
+         * \param directory the directory given to the journal_writer.
+         */
+        ZMQPP_EXPORT journal_reader(std::string const& directory);
+
+        ZMQPP_EXPORT ~journal_reader();
+
+        /**
+         * \return the closed segments listed in the journal index.
+         */
+        std::vector<journal_segment> const& segments() const { return index_; }
+
+        /**
+         * Move to the first record at or after a time, using the index to skip
+         * whole segments.
+         *
+         * \param timestamp nanoseconds since the system clock epoch.
+         */
+        ZMQPP_EXPORT void seek(std::chrono::nanoseconds const timestamp);
+
+        /**
+         * Read the next record.
+         *
+         * \param record filled in with the record.
+         * \return true if there was one, false at the end of the journal.
+         */
+        ZMQPP_EXPORT bool next(journal_record& record);
+
+        /**
+         * Send the remaining records again, spaced as they were recorded.
+         *
+         * Records that went from backend to frontend are sent on to_frontend, or
+         * skipped if it is null, and all the others on to_backend. This stands in
+         * for one or both sides of the proxy that was captured.
+         *
+         * \param to_backend socket to send frontend to backend and untagged traffic on.
+         * \param to_frontend socket to send backend to frontend traffic on, may be null.
+         * \param speed how many times faster than recorded to replay, zero or less for as fast as possible.
+         * \return the number of messages sent.
+         */
+        ZMQPP_EXPORT uint64_t replay(socket_t& to_backend, socket_t* to_frontend, double const speed = 1.0);
+
+    private:
+        std::string directory_;
+        std::vector<journal_segment> index_;
+        std::vector<uint64_t> numbers_;
+        size_t position_;
+
+        // the mapped segment, data_ is null when there is none
+        int fd_;
+        char const* data_;
+        size_t size_;
+        size_t offset_;
+
+        void list_segments();
+        void open_segment();
+        void close_segment();
+        bool has_record() const;
+        bool advance();
+
+        // No copy - private and not implemented
+        journal_reader(journal_reader const&) ZMQPP_EXPLICITLY_DELETED;
+        journal_reader& operator=(journal_reader const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
+
+#endif
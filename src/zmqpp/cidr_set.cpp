@@ -0,0 +1,334 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+#include "cidr_set.hpp"
+#include "exception.hpp"
+
+namespace zmqpp
+{
+
+    namespace
+    {
+        // longer than any address in text, with its zone
+        size_t const max_address_text = 64;
+
+        // parse a nul terminated address, mapping IPv4
+        bool parse_host(char const* const host, cidr_set::address_t& address, bool& ipv4)
+        {
+            uint8_t bytes[16];
+            if (1 == inet_pton(AF_INET, host, bytes))
+            {
+                std::fill(address.begin(), address.begin() + 10, 0);
+                address[10] = 0xff;
+                address[11] = 0xff;
+                std::copy(bytes, bytes + 4, address.begin() + 12);
+                ipv4 = true;
+                return true;
+            }
+            if (1 == inet_pton(AF_INET6, host, bytes))
+            {
+                std::copy(bytes, bytes + 16, address.begin());
+                ipv4 = false;
+                return true;
+            }
+            return false;
+        }
+
+        uint64_t high_mask(size_t const length)
+        {
+            if (length >= 64)
+                return ~uint64_t(0);
+            return (0 == length) ? 0 : ~uint64_t(0) << (64 - length);
+        }
+
+        uint64_t low_mask(size_t const length)
+        {
+            if (length <= 64)
+                return 0;
+            return (length >= 128) ? ~uint64_t(0) : ~uint64_t(0) << (128 - length);
+        }
+
+        size_t leading_zeros(uint64_t value)
+        {
+#if defined(__GNUC__)
+            return static_cast<size_t>(__builtin_clzll(value));
+#else
+            size_t zeros = 0;
+            for (; 0 == (value & (uint64_t(1) << 63)); value <<= 1)
+                ++zeros;
+            return zeros;
+#endif
+        }
+    }
+
+    cidr_set::cidr_set() :
+    nodes_(),
+    free_(),
+    ranges_(0)
+    {
+        clear();
+    }
+
+    bool cidr_set::parse(std::string const& text, address_t& address, size_t& prefix_length)
+    {
+        std::string::size_type const slash = text.find('/');
+        std::string::size_type const host_length = (std::string::npos == slash) ? text.size() : slash;
+        if (host_length >= max_address_text)
+            return false;
+
+        char host[max_address_text];
+        std::memcpy(host, text.data(), host_length);
+        host[host_length] = '\0';
+
+        bool ipv4 = false;
+        if (!parse_host(host, address, ipv4))
+            return false;
+
+        size_t const mapped = ipv4 ? 96 : 0;
+        if (std::string::npos == slash)
+        {
+            prefix_length = 128;
+            return true;
+        }
+
+        std::string const bits = text.substr(slash + 1);
+        if (bits.empty() || bits.size() > 3 || std::string::npos != bits.find_first_not_of("0123456789"))
+            return false;
+
+        size_t const length = static_cast<size_t>(std::stoul(bits));
+        if (length > 128 - mapped)
+            return false;
+
+        prefix_length = mapped + length;
+        return true;
+    }
+
+    bool cidr_set::parse(std::string const& text, address_t& address)
+    {
+        std::string::size_type const zone = text.find('%');
+        std::string::size_type const host_length = (std::string::npos == zone) ? text.size() : zone;
+        if (host_length >= max_address_text)
+            return false;
+
+        char host[max_address_text];
+        std::memcpy(host, text.data(), host_length);
+        host[host_length] = '\0';
+
+        bool ipv4 = false;
+        return parse_host(host, address, ipv4);
+    }
+
+    void cidr_set::insert(address_t const& address, size_t const prefix_length)
+    {
+        if (prefix_length > 128)
+        {
+            throw exception("address prefix length must be at most 128 bits");
+        }
+
+        key_t key = to_key(address);
+        key.high &= high_mask(prefix_length);
+        key.low &= low_mask(prefix_length);
+
+        uint32_t index = 0;
+        for (;;)
+        {
+            // the key matches this node's prefix, which is no longer than the key's
+            if (nodes_[index].range)
+                return;
+
+            if (nodes_[index].length == prefix_length)
+            {
+                drop_children(index);
+                nodes_[index].range = true;
+                ++ranges_;
+                return;
+            }
+
+            size_t const side = bit(key, nodes_[index].length);
+            uint32_t const child = nodes_[index].child[side];
+            if (0 == child)
+            {
+                uint32_t const leaf = add_node(key, prefix_length, true);
+                nodes_[index].child[side] = leaf;
+                return;
+            }
+
+            size_t const common = std::min(std::min(prefix_length, static_cast<size_t>(nodes_[child].length)), common_length(key, nodes_[child].key));
+            if (common == nodes_[child].length)
+            {
+                index = child;
+                continue;
+            }
+
+            if (common == prefix_length)
+            {
+                // the new range covers the child, which takes its place
+                drop_children(child);
+                if (nodes_[child].range)
+                    --ranges_;
+                nodes_[child].key = key;
+                nodes_[child].length = static_cast<uint32_t>(prefix_length);
+                nodes_[child].range = true;
+                ++ranges_;
+                return;
+            }
+
+            // the new range and the child part within both, branch where they do
+            key_t branch_key = key;
+            branch_key.high &= high_mask(common);
+            branch_key.low &= low_mask(common);
+
+            uint32_t const branch = add_node(branch_key, common, false);
+            uint32_t const leaf = add_node(key, prefix_length, true);
+            nodes_[branch].child[bit(nodes_[child].key, common)] = child;
+            nodes_[branch].child[bit(key, common)] = leaf;
+            nodes_[index].child[side] = branch;
+            return;
+        }
+    }
+
+    bool cidr_set::insert(std::string const& text)
+    {
+        address_t address;
+        size_t prefix_length = 0;
+        if (!parse(text, address, prefix_length))
+            return false;
+
+        insert(address, prefix_length);
+        return true;
+    }
+
+    bool cidr_set::contains(address_t const& address) const
+    {
+        key_t const key = to_key(address);
+
+        uint32_t index = 0;
+        for (;;)
+        {
+            node_t const& node = nodes_[index];
+            if (0 != ((key.high ^ node.key.high) & high_mask(node.length)) ||
+                0 != ((key.low ^ node.key.low) & low_mask(node.length)))
+                return false;
+
+            if (node.range)
+                return true;
+
+            if (node.length >= 128)
+                return false;
+
+            index = node.child[bit(key, node.length)];
+            if (0 == index)
+                return false;
+        }
+    }
+
+    bool cidr_set::contains(std::string const& text) const
+    {
+        address_t address;
+        return !empty() && parse(text, address) && contains(address);
+    }
+
+    void cidr_set::reserve(size_t const ranges)
+    {
+        // a range adds at most a leaf and a branch
+        nodes_.reserve(nodes_.size() + 2 * ranges);
+    }
+
+    void cidr_set::clear()
+    {
+        node_t root;
+        root.key.high = 0;
+        root.key.low = 0;
+        root.length = 0;
+        root.range = false;
+        root.child[0] = 0;
+        root.child[1] = 0;
+
+        nodes_.assign(1, root);
+        free_.clear();
+        ranges_ = 0;
+    }
+
+    cidr_set::key_t cidr_set::to_key(address_t const& address)
+    {
+        key_t key = { 0, 0 };
+        for (size_t i = 0; i < 8; ++i)
+        {
+            key.high = (key.high << 8) | address[i];
+            key.low = (key.low << 8) | address[i + 8];
+        }
+        return key;
+    }
+
+    size_t cidr_set::bit(key_t const& key, size_t const position)
+    {
+        if (position < 64)
+            return static_cast<size_t>((key.high >> (63 - position)) & 1);
+        return static_cast<size_t>((key.low >> (127 - position)) & 1);
+    }
+
+    size_t cidr_set::common_length(key_t const& first, key_t const& second)
+    {
+        if (first.high != second.high)
+            return leading_zeros(first.high ^ second.high);
+        if (first.low != second.low)
+            return 64 + leading_zeros(first.low ^ second.low);
+        return 128;
+    }
+
+    uint32_t cidr_set::add_node(key_t const& key, size_t const length, bool const range)
+    {
+        node_t node;
+        node.key = key;
+        node.length = static_cast<uint32_t>(length);
+        node.range = range;
+        node.child[0] = 0;
+        node.child[1] = 0;
+
+        if (range)
+            ++ranges_;
+
+        if (!free_.empty())
+        {
+            uint32_t const index = free_.back();
+            free_.pop_back();
+            nodes_[index] = node;
+            return index;
+        }
+
+        nodes_.push_back(node);
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+
+    void cidr_set::drop_children(uint32_t const index)
+    {
+        for (size_t side = 0; side < 2; ++side)
+        {
+            uint32_t const child = nodes_[index].child[side];
+            if (0 == child)
+                continue;
+
+            drop_children(child);
+            if (nodes_[child].range)
+                --ranges_;
+            free_.push_back(child);
+            nodes_[index].child[side] = 0;
+        }
+    }
+
+}
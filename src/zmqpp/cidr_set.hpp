@@ -0,0 +1,139 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "compatibility.hpp"
+
+namespace zmqpp
+{
+
+    /**
+     * A set of IPv4 and IPv6 address ranges in CIDR notation, such as
+     * "10.0.0.0/8" or "2001:db8::/32", and of single addresses.
+     *
+     * IPv4 is kept as IPv4 mapped IPv6 (::ffff:0:0/96), so an IPv4 range also
+     * matches its mapped form as seen on a dual stack socket. The ranges are
+     * held in a path compressed binary trie over the 128 bit addresses, a
+     * lookup visits at most one node per distinct prefix length on its path
+     * whatever the number of ranges. A range inside another one is not stored.
+     */
+    class cidr_set
+    {
+    public:
+        /**
+         * An IPv6 address, or an IPv4 mapped one, in network byte order.
+         */
+        typedef std::array<uint8_t, 16> address_t;
+
+        ZMQPP_EXPORT cidr_set();
+
+        /**
+         * Parse a single address or a range.
+         *
+         * \param text an address, optionally followed by / and a prefix length.
+         * \param address set to the address, IPv4 is mapped.
+         * \param prefix_length set to the prefix length in bits of the mapped
+         *        address, 128 for a single address.
+         * \return false if the text is not an address or a range.
+         */
+        ZMQPP_EXPORT static bool parse(std::string const& text, address_t& address, size_t& prefix_length);
+
+        /**
+         * Parse a single address, as found in a ZAP request. An IPv6 zone such
+         * as "%eth0" is ignored.
+         *
+         * \param text the address.
+         * \param address set to the address, IPv4 is mapped.
+         * \return false if the text is not an address.
+         */
+        ZMQPP_EXPORT static bool parse(std::string const& text, address_t& address);
+
+        /**
+         * Add a range.
+         *
+         * \param address the address, bits past the prefix are ignored.
+         * \param prefix_length the prefix length in bits, up to 128.
+         */
+        ZMQPP_EXPORT void insert(address_t const& address, size_t const prefix_length);
+
+        /**
+         * Add a single address or a range.
+         *
+         * \param text an address, optionally followed by / and a prefix length.
+         * \return false if the text is not an address or a range, nothing is added.
+         */
+        ZMQPP_EXPORT bool insert(std::string const& text);
+
+        /**
+         * \return true if the address is in one of the ranges.
+         */
+        ZMQPP_EXPORT bool contains(address_t const& address) const;
+
+        /**
+         * \return true if the text is an address in one of the ranges.
+         */
+        ZMQPP_EXPORT bool contains(std::string const& text) const;
+
+        /**
+         * \return the number of ranges held, not counting those inside others.
+         */
+        size_t size() const { return ranges_; }
+
+        /**
+         * \return true if there are no ranges.
+         */
+        bool empty() const { return 0 == ranges_; }
+
+        /**
+         * Make room for a number of ranges, to load many without reallocating.
+         */
+        ZMQPP_EXPORT void reserve(size_t const ranges);
+
+        /**
+         * Remove every range.
+         */
+        ZMQPP_EXPORT void clear();
+
+    private:
+        // the 128 bits of an address, high holds the first 64
+        struct key_t
+        {
+            uint64_t high;
+            uint64_t low;
+        };
+
+        // a prefix, with the bits past its length cleared. Nodes are linked by
+        // index, zero being the root and so never a child
+        struct node_t
+        {
+            key_t key;
+            uint32_t length;
+            bool range;
+            uint32_t child[2];
+        };
+
+        std::vector<node_t> nodes_;
+        std::vector<uint32_t> free_;
+        size_t ranges_;
+
+        static key_t to_key(address_t const& address);
+        static size_t bit(key_t const& key, size_t const position);
+        static size_t common_length(key_t const& first, key_t const& second);
+
+        uint32_t add_node(key_t const& key, size_t const length, bool const range);
+        void drop_children(uint32_t const index);
+    };
+
+}
@@ -122,6 +122,24 @@
 #define NOEXCEPT noexcept
 #endif
 
+// Linux provides timerfd, which lets the loop wait on timers with better than
+// millisecond precision by polling a file descriptor alongside the sockets,
+// eventfd, a cheaper wakeup descriptor than a pipe, and epoll for bridging into
+// external event loops.
+#if defined(__linux__)
+#define ZMQPP_HAVE_TIMERFD
+#define ZMQPP_HAVE_EVENTFD
+#define ZMQPP_HAVE_EPOLL
+#endif
+
+// Coroutine awaitables for the loop are only available when building as C++20
+// with a standard library that ships <coroutine>.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define ZMQPP_HAVE_COROUTINES
+#endif
+#endif
+
 // There are a couple of methods that take a raw socket in form of a 'file descriptor'. Under POSIX
 // this is simply an int. But under Windows this type must be a SOCKET. In order to hide this 
 // platform detail we create a raw_socket_t which is a SOCKET under Windows and an int on all the
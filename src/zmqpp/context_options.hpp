@@ -32,6 +32,11 @@ ZMQPP_COMPARABLE_ENUM context_option {
 #if (ZMQ_VERSION_MINOR >= 1)
 	thread_sched_policy  = ZMQ_THREAD_SCHED_POLICY,  /*!< Scheduling policy for I/O threads */
 	thread_priority      = ZMQ_THREAD_PRIORITY,      /*!< Scheduling priority for I/O threads */
+#endif
+#if (ZMQ_VERSION_MAJOR > 4) || (ZMQ_VERSION_MINOR >= 3)
+	thread_affinity_cpu_add    = ZMQ_THREAD_AFFINITY_CPU_ADD,    /*!< Add a cpu to the I/O threads' affinity set */
+	thread_affinity_cpu_remove = ZMQ_THREAD_AFFINITY_CPU_REMOVE, /*!< Remove a cpu from the I/O threads' affinity set */
+	thread_name_prefix         = ZMQ_THREAD_NAME_PREFIX,         /*!< Number prefixed to the I/O thread names */
 #endif
 	ipv6                 = ZMQ_IPV6                  /*!< Enable ipv6 for all new sockets */
 #endif
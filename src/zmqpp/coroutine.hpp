@@ -0,0 +1,536 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include "compatibility.hpp"
+
+#ifdef ZMQPP_HAVE_COROUTINES
+
+#include <array>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <new>
+#include <optional>
+#include <utility>
+
+#include "loop.hpp"
+#include "message.hpp"
+#include "socket.hpp"
+
+namespace zmqpp
+{
+
+    /**
+     * Thread local free lists for coroutine frames.
+     *
+     * Frames are rounded up to 64 byte size classes and recycled on the thread
+     * that frees them, so a conversation started and finished per request doesn't
+     * go through the global allocator. Frames larger than 1KiB are not pooled.
+     */
+    class coroutine_frame_pool
+    {
+    public:
+        static void* allocate(size_t const size)
+        {
+            size_t const bucket = bucket_for(size);
+            if (bucket >= buckets || destroyed())
+                return ::operator new(size);
+
+            free_list& list = lists()[bucket];
+            if (nullptr == list.head)
+                return ::operator new((bucket + 1) * granularity);
+
+            block* item = list.head;
+            list.head = item->next;
+            --list.count;
+            return item;
+        }
+
+        static void deallocate(void* pointer, size_t const size)
+        {
+            size_t const bucket = bucket_for(size);
+            if (bucket >= buckets || destroyed() || lists()[bucket].count >= max_cached)
+            {
+                ::operator delete(pointer);
+                return;
+            }
+
+            free_list& list = lists()[bucket];
+            block* item = static_cast<block*>(pointer);
+            item->next = list.head;
+            list.head = item;
+            ++list.count;
+        }
+
+    private:
+        static constexpr size_t granularity = 64;
+        static constexpr size_t buckets = 16;
+        static constexpr size_t max_cached = 256;
+
+        struct block
+        {
+            block* next;
+        };
+
+        struct free_list
+        {
+            block* head = nullptr;
+            size_t count = 0;
+        };
+
+        struct thread_lists
+        {
+            std::array<free_list, buckets> lists;
+
+            ~thread_lists()
+            {
+                for (free_list& list : lists)
+                {
+                    while (nullptr != list.head)
+                    {
+                        block* next = list.head->next;
+                        ::operator delete(list.head);
+                        list.head = next;
+                    }
+                }
+                destroyed() = true;
+            }
+        };
+
+        static size_t bucket_for(size_t const size)
+        {
+            return (size + granularity - 1) / granularity - 1;
+        }
+
+        static std::array<free_list, buckets>& lists()
+        {
+            thread_local thread_lists pool;
+            return pool.lists;
+        }
+
+        // frames freed during thread exit, after the lists are gone, bypass the pool
+        static bool& destroyed()
+        {
+            thread_local bool flag = false;
+            return flag;
+        }
+    };
+
+    template<typename T = void>
+    class task;
+
+    /**
+     * Shared promise behaviour for task, frames come from coroutine_frame_pool.
+     */
+    class task_promise_base
+    {
+    public:
+        static void* operator new(size_t const size)
+        {
+            return coroutine_frame_pool::allocate(size);
+        }
+
+        static void operator delete(void* pointer, size_t const size)
+        {
+            coroutine_frame_pool::deallocate(pointer, size);
+        }
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+
+        struct final_awaiter
+        {
+            bool await_ready() const noexcept { return false; }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+            {
+                task_promise_base& promise = handle.promise();
+                if (promise.detached)
+                {
+                    // nobody is left to see the error, treat it like an exception leaving a thread
+                    if (promise.error)
+                        std::terminate();
+                    handle.destroy();
+                    return std::noop_coroutine();
+                }
+                if (promise.continuation)
+                    return promise.continuation;
+                return std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept { }
+        };
+
+        final_awaiter final_suspend() const noexcept { return {}; }
+
+        void unhandled_exception() noexcept
+        {
+            error = std::current_exception();
+        }
+
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+        bool detached = false;
+    };
+
+    template<typename T>
+    class task_promise : public task_promise_base
+    {
+    public:
+        task<T> get_return_object() noexcept;
+
+        template<typename Value>
+        void return_value(Value&& result)
+        {
+            value.emplace(std::forward<Value>(result));
+        }
+
+        T result()
+        {
+            if (error)
+                std::rethrow_exception(error);
+            return std::move(*value);
+        }
+
+    private:
+        std::optional<T> value;
+    };
+
+    template<>
+    class task_promise<void> : public task_promise_base
+    {
+    public:
+        task<void> get_return_object() noexcept;
+
+        void return_void() const noexcept { }
+
+        void result()
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    };
+
+    /**
+     * Lazily started coroutine returning a T.
+     *
+     * A task only runs once it is awaited by another coroutine, which is resumed
+     * when the task finishes, or once it is handed to spawn(). Exceptions thrown by
+     * the task are rethrown to the awaiting coroutine.
+     */
+    template<typename T>
+    class task
+    {
+    public:
+        typedef task_promise<T> promise_type;
+        typedef std::coroutine_handle<promise_type> handle_type;
+
+        explicit task(handle_type handle) noexcept :
+        handle_(handle)
+        {
+        }
+
+        task(task&& other) noexcept :
+        handle_(std::exchange(other.handle_, nullptr))
+        {
+        }
+
+        task& operator=(task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle_)
+                    handle_.destroy();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        task(task const&) = delete;
+        task& operator=(task const&) = delete;
+
+        ~task()
+        {
+            if (handle_)
+                handle_.destroy();
+        }
+
+        bool await_ready() const noexcept
+        {
+            return !handle_ || handle_.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            handle_.promise().continuation = awaiting;
+            return handle_;
+        }
+
+        T await_resume()
+        {
+            return handle_.promise().result();
+        }
+
+        /**
+         * Start the task and let it run to completion on its own, freeing its frame
+         * when done. An exception escaping a detached task terminates the program.
+         */
+        void detach()
+        {
+            handle_type handle = std::exchange(handle_, nullptr);
+            handle.promise().detached = true;
+            handle.resume();
+        }
+
+    private:
+        handle_type handle_;
+    };
+
+    template<typename T>
+    task<T> task_promise<T>::get_return_object() noexcept
+    {
+        return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+    }
+
+    inline task<void> task_promise<void>::get_return_object() noexcept
+    {
+        return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+    }
+
+    /**
+     * Start a task without waiting for it, see task::detach.
+     *
+     * \param work the task to run.
+     */
+    inline void spawn(task<void> work)
+    {
+        work.detach();
+    }
+
+    /**
+     * Awaitable receive on a socket registered with a loop.
+     *
+     * Completes straight away if a message is waiting, otherwise the coroutine is
+     * suspended and the socket is watched by the loop until a message arrives.
+     * Only one operation may be pending on a socket at a time as the loop holds a
+     * single handler per socket.
+     */
+    class receive_awaitable
+    {
+    public:
+        receive_awaitable(loop& events, socket& source) :
+        events_(events),
+        socket_(source),
+        message_(),
+        error_(),
+        waiting_(false)
+        {
+        }
+
+        receive_awaitable(receive_awaitable const&) = delete;
+        receive_awaitable& operator=(receive_awaitable const&) = delete;
+
+        // a coroutine destroyed while suspended must not be resumed by the loop
+        ~receive_awaitable()
+        {
+            if (waiting_)
+                events_.remove(socket_);
+        }
+
+        bool await_ready()
+        {
+            return socket_.receive(message_, true);
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            waiting_ = true;
+            events_.add(socket_, [this, handle]() -> bool {
+                try
+                {
+                    if (!socket_.receive(message_, true))
+                        return true;
+                }
+                catch (...)
+                {
+                    error_ = std::current_exception();
+                }
+
+                waiting_ = false;
+                events_.remove(socket_);
+                handle.resume();
+                return true;
+            }, poller::poll_in);
+        }
+
+        message await_resume()
+        {
+            if (error_)
+                std::rethrow_exception(error_);
+            return std::move(message_);
+        }
+
+    private:
+        loop& events_;
+        socket& socket_;
+        message message_;
+        std::exception_ptr error_;
+        bool waiting_;
+    };
+
+    /**
+     * Awaitable send on a socket registered with a loop, see receive_awaitable.
+     */
+    class send_awaitable
+    {
+    public:
+        send_awaitable(loop& events, socket& target, message&& outgoing) :
+        events_(events),
+        socket_(target),
+        message_(std::move(outgoing)),
+        error_(),
+        waiting_(false)
+        {
+        }
+
+        send_awaitable(send_awaitable const&) = delete;
+        send_awaitable& operator=(send_awaitable const&) = delete;
+
+        ~send_awaitable()
+        {
+            if (waiting_)
+                events_.remove(socket_);
+        }
+
+        bool await_ready()
+        {
+            return socket_.send(message_, true);
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            waiting_ = true;
+            events_.add(socket_, [this, handle]() -> bool {
+                try
+                {
+                    if (!socket_.send(message_, true))
+                        return true;
+                }
+                catch (...)
+                {
+                    error_ = std::current_exception();
+                }
+
+                waiting_ = false;
+                events_.remove(socket_);
+                handle.resume();
+                return true;
+            }, poller::poll_out);
+        }
+
+        void await_resume()
+        {
+            if (error_)
+                std::rethrow_exception(error_);
+        }
+
+    private:
+        loop& events_;
+        socket& socket_;
+        message message_;
+        std::exception_ptr error_;
+        bool waiting_;
+    };
+
+    /**
+     * Awaitable delay using a loop timer.
+     */
+    class sleep_awaitable
+    {
+    public:
+        sleep_awaitable(loop& events, std::chrono::microseconds const delay) :
+        events_(events),
+        delay_(delay),
+        timer_(nullptr)
+        {
+        }
+
+        sleep_awaitable(sleep_awaitable const&) = delete;
+        sleep_awaitable& operator=(sleep_awaitable const&) = delete;
+
+        ~sleep_awaitable()
+        {
+            if (nullptr != timer_)
+                events_.remove(timer_);
+        }
+
+        bool await_ready() const noexcept
+        {
+            return delay_ <= std::chrono::microseconds::zero();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            timer_ = events_.add(delay_, 1, [this, handle]() -> bool {
+                timer_ = nullptr;
+                handle.resume();
+                return true;
+            });
+        }
+
+        void await_resume() const noexcept { }
+
+    private:
+        loop& events_;
+        std::chrono::microseconds delay_;
+        loop::timer_id_t timer_;
+    };
+
+    /**
+     * Receive a message, suspending the calling coroutine until one arrives.
+     *
+     * \param events the loop that resumes the coroutine, it must be running on this thread.
+     * \param source the socket to receive from.
+     * \return an awaitable producing the received message.
+     */
+    inline receive_awaitable async_receive(loop& events, socket& source)
+    {
+        return receive_awaitable(events, source);
+    }
+
+    /**
+     * Send a message, suspending the calling coroutine while the socket would block.
+     *
+     * \param events the loop that resumes the coroutine, it must be running on this thread.
+     * \param target the socket to send on.
+     * \param outgoing the message to send.
+     * \return an awaitable that completes once the message is queued.
+     */
+    inline send_awaitable async_send(loop& events, socket& target, message outgoing)
+    {
+        return send_awaitable(events, target, std::move(outgoing));
+    }
+
+    /**
+     * Suspend the calling coroutine for a while.
+     *
+     * \param events the loop that resumes the coroutine, it must be running on this thread.
+     * \param delay how long to wait.
+     * \return an awaitable that completes after the delay.
+     */
+    inline sleep_awaitable async_sleep(loop& events, std::chrono::microseconds const delay)
+    {
+        return sleep_awaitable(events, delay);
+    }
+
+}
+
+#endif
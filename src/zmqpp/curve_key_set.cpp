@@ -0,0 +1,257 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#include "curve_key_set.hpp"
+#include "exception.hpp"
+#include "z85.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define ZMQPP_HAS_SSE2 1
+#endif
+
+#if (ZMQ_VERSION_MAJOR >= 4)
+
+namespace zmqpp
+{
+
+    namespace
+    {
+        // the control byte of a free slot, a used one holds seven bits of hash
+        uint8_t const empty_slot = 0x80;
+
+        // slots used per group of sixteen before the table grows
+        size_t const max_load = 14;
+
+        uint64_t mix(uint64_t value)
+        {
+            value ^= value >> 30;
+            value *= 0xbf58476d1ce4e5b9ULL;
+            value ^= value >> 27;
+            value *= 0x94d049bb133111ebULL;
+            return value ^ (value >> 31);
+        }
+
+        uint64_t word(uint8_t const* const bytes)
+        {
+            uint64_t value;
+            std::memcpy(&value, bytes, sizeof(value));
+            return value;
+        }
+
+        size_t lowest_bit(uint32_t const mask)
+        {
+#if defined(__GNUC__)
+            return static_cast<size_t>(__builtin_ctz(mask));
+#else
+            size_t bit = 0;
+            while (0 == (mask & (1u << bit)))
+                ++bit;
+            return bit;
+#endif
+        }
+
+        // one bit per slot of the group whose control byte is the one given
+        uint32_t match(uint8_t const* const group, uint8_t const control)
+        {
+#if defined(ZMQPP_HAS_SSE2)
+            __m128i const bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(group));
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(control)))));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < 16; ++i)
+            {
+                if (group[i] == control)
+                    mask |= 1u << i;
+            }
+            return mask;
+#endif
+        }
+
+        bool same_key(uint8_t const* const first, uint8_t const* const second)
+        {
+#if defined(ZMQPP_HAS_SSE2)
+            __m128i const low = _mm_cmpeq_epi8(
+                    _mm_loadu_si128(reinterpret_cast<__m128i const*>(first)),
+                    _mm_loadu_si128(reinterpret_cast<__m128i const*>(second)));
+            __m128i const high = _mm_cmpeq_epi8(
+                    _mm_loadu_si128(reinterpret_cast<__m128i const*>(first + 16)),
+                    _mm_loadu_si128(reinterpret_cast<__m128i const*>(second + 16)));
+            return 0xffff == _mm_movemask_epi8(_mm_and_si128(low, high));
+#else
+            return 0 == std::memcmp(first, second, curve_key_set::key_size);
+#endif
+        }
+    }
+
+    size_t const curve_key_set::key_size;
+    size_t const curve_key_set::group_size;
+
+    curve_key_set::curve_key_set() :
+    control_(group_size, empty_slot),
+    keys_(group_size * key_size),
+    groups_(1),
+    size_(0),
+    seed_(0)
+    {
+        std::random_device random;
+        seed_ = (static_cast<uint64_t>(random()) << 32) ^ random();
+    }
+
+    bool curve_key_set::parse(std::string const& text, key_t& key)
+    {
+        if (key_size == text.size())
+        {
+            std::copy(text.begin(), text.end(), key.begin());
+            return true;
+        }
+
+        if (key_size * 5 / 4 != text.size())
+            return false;
+
+        try
+        {
+            std::vector<uint8_t> const decoded = z85::decode(text);
+            if (key_size != decoded.size())
+                return false;
+            std::copy(decoded.begin(), decoded.end(), key.begin());
+            return true;
+        }
+        catch (z85_exception const&)
+        {
+            return false;
+        }
+    }
+
+    void curve_key_set::insert(key_t const& key)
+    {
+        uint64_t const hashed = hash(key.data());
+        bool found = false;
+        size_t slot = find(key.data(), hashed, found);
+        if (found)
+            return;
+
+        if (size_ + 1 > groups_ * max_load)
+        {
+            rehash(groups_ * 2);
+            slot = find(key.data(), hashed, found);
+        }
+
+        control_[slot] = static_cast<uint8_t>(hashed & 0x7f);
+        std::copy(key.begin(), key.end(), keys_.begin() + slot * key_size);
+        ++size_;
+    }
+
+    bool curve_key_set::insert(std::string const& text)
+    {
+        key_t key;
+        if (!parse(text, key))
+            return false;
+
+        insert(key);
+        return true;
+    }
+
+    bool curve_key_set::contains(void const* const key) const
+    {
+        if (0 == size_)
+            return false;
+
+        uint8_t const* const bytes = static_cast<uint8_t const*>(key);
+        bool found = false;
+        find(bytes, hash(bytes), found);
+        return found;
+    }
+
+    void curve_key_set::reserve(size_t const keys)
+    {
+        size_t groups = groups_;
+        while (groups * max_load < keys)
+            groups *= 2;
+
+        if (groups != groups_)
+            rehash(groups);
+    }
+
+    void curve_key_set::clear()
+    {
+        std::vector<uint8_t>(group_size, empty_slot).swap(control_);
+        std::vector<uint8_t>(group_size * key_size).swap(keys_);
+        groups_ = 1;
+        size_ = 0;
+    }
+
+    uint64_t curve_key_set::hash(uint8_t const* const key) const
+    {
+        uint64_t value = mix(seed_ ^ word(key));
+        value = mix(value ^ word(key + 8));
+        value = mix(value ^ word(key + 16));
+        return mix(value ^ word(key + 24));
+    }
+
+    size_t curve_key_set::find(uint8_t const* const key, uint64_t const hashed, bool& found) const
+    {
+        uint8_t const control = static_cast<uint8_t>(hashed & 0x7f);
+        size_t group = static_cast<size_t>(hashed >> 7) & (groups_ - 1);
+
+        // triangular steps visit every group of a power of two table, which
+        // always has a free slot left
+        for (size_t step = 1;; ++step)
+        {
+            size_t const first = group * group_size;
+            for (uint32_t candidates = match(&control_[first], control); 0 != candidates; candidates &= candidates - 1)
+            {
+                size_t const slot = first + lowest_bit(candidates);
+                if (same_key(&keys_[slot * key_size], key))
+                {
+                    found = true;
+                    return slot;
+                }
+            }
+
+            // keys are never removed, so a free slot ends the search
+            uint32_t const free = match(&control_[first], empty_slot);
+            if (0 != free)
+            {
+                found = false;
+                return first + lowest_bit(free);
+            }
+
+            group = (group + step) & (groups_ - 1);
+        }
+    }
+
+    void curve_key_set::rehash(size_t const groups)
+    {
+        std::vector<uint8_t> control(groups * group_size, empty_slot);
+        std::vector<uint8_t> keys(groups * group_size * key_size);
+        control.swap(control_);
+        keys.swap(keys_);
+        groups_ = groups;
+
+        for (size_t slot = 0; slot < control.size(); ++slot)
+        {
+            if (empty_slot == control[slot])
+                continue;
+
+            uint8_t const* const key = &keys[slot * key_size];
+            bool found = false;
+            size_t const moved = find(key, hash(key), found);
+            control_[moved] = control[slot];
+            std::copy(key, key + key_size, keys_.begin() + moved * key_size);
+        }
+    }
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <zmq.h>
+#include "compatibility.hpp"
+
+namespace zmqpp
+{
+#if (ZMQ_VERSION_MAJOR >= 4)
+
+    /**
+     * A set of CURVE public keys, held as their 32 binary bytes.
+     *
+     * Keys sit in one flat open addressing table, in groups of sixteen slots
+     * with a byte of hash per slot. A lookup compares a whole group's hash
+     * bytes at once, with SSE2 where available, and only compares the keys
+     * whose byte matched. There is no allocation per key and a lookup takes
+     * the key straight from a ZAP request frame.
+     *
+     * The hash is seeded per set, so clients can't pick keys that collide.
+     */
+    class curve_key_set
+    {
+    public:
+        static size_t const key_size = 32;
+
+        /**
+         * A CURVE public key in binary.
+         */
+        typedef std::array<uint8_t, key_size> key_t;
+
+        ZMQPP_EXPORT curve_key_set();
+
+        /**
+         * Parse a key given either in binary or z85 encoded.
+         *
+         * \param text 32 binary bytes or 40 z85 characters.
+         * \param key set to the binary key.
+         * \return false if the text is not a key.
+         */
+        ZMQPP_EXPORT static bool parse(std::string const& text, key_t& key);
+
+        /**
+         * Add a key, nothing happens if it is already there.
+         */
+        ZMQPP_EXPORT void insert(key_t const& key);
+
+        /**
+         * Add a key given either in binary or z85 encoded.
+         *
+         * \param text 32 binary bytes or 40 z85 characters.
+         * \return false if the text is not a key, nothing is added.
+         */
+        ZMQPP_EXPORT bool insert(std::string const& text);
+
+        /**
+         * \param key the 32 bytes of a binary key.
+         * \return true if the key is in the set.
+         */
+        ZMQPP_EXPORT bool contains(void const* const key) const;
+
+        /**
+         * \return true if the key is in the set.
+         */
+        bool contains(key_t const& key) const { return contains(key.data()); }
+
+        /**
+         * \return the number of keys.
+         */
+        size_t size() const { return size_; }
+
+        /**
+         * \return true if there are no keys.
+         */
+        bool empty() const { return 0 == size_; }
+
+        /**
+         * Make room for a number of keys, to load many without rehashing.
+         */
+        ZMQPP_EXPORT void reserve(size_t const keys);
+
+        /**
+         * Remove every key.
+         */
+        ZMQPP_EXPORT void clear();
+
+    private:
+        static size_t const group_size = 16;
+
+        std::vector<uint8_t> control_;
+        std::vector<uint8_t> keys_;
+        size_t groups_;
+        size_t size_;
+        uint64_t seed_;
+
+        uint64_t hash(uint8_t const* const key) const;
+        size_t find(uint8_t const* const key, uint64_t const hashed, bool& found) const;
+        void rehash(size_t const groups);
+    };
+
+#endif
+}
@@ -0,0 +1,45 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace zmqpp
+{
+
+    /**
+     * Limits the work a loop or reactor does for one registration per wakeup.
+     *
+     * After each handler call the registration is checked again and, while it is
+     * still ready, the handler is called again until one of the limits is reached.
+     * If a limit stops a registration that is still ready the next poll does not
+     * block, so the remaining messages are picked up once every other ready
+     * registration had its turn.
+     *
+     * The default budget calls the handler once per wakeup, which is how handlers
+     * that read a single message expect to be driven.
+     */
+    struct dispatch_budget
+    {
+        /**
+         * \param calls maximum handler calls per wakeup, 0 for no limit.
+         * \param time maximum time spent in the handler per wakeup, zero for no limit.
+         */
+        dispatch_budget(size_t const calls = 1, std::chrono::microseconds const time = std::chrono::microseconds::zero())
+            : calls(calls)
+            , time(time)
+        { }
+
+        size_t calls;                    /*!< maximum handler calls per wakeup, 0 for no limit */
+        std::chrono::microseconds time;  /*!< maximum time per wakeup, zero for no limit */
+    };
+
+}
@@ -0,0 +1,114 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include "exception.hpp"
+#include "event_notifier.hpp"
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef ZMQPP_HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
+namespace zmqpp
+{
+
+#ifdef ZMQPP_HAVE_EVENTFD
+    event_notifier::event_notifier() :
+    read_fd_(-1),
+    write_fd_(-1)
+    {
+        read_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (read_fd_ < 0)
+        {
+            throw exception("unable to create event descriptor");
+        }
+        write_fd_ = read_fd_;
+    }
+
+    event_notifier::~event_notifier()
+    {
+        close(read_fd_);
+    }
+
+    void event_notifier::notify()
+    {
+        uint64_t value = 1;
+        ssize_t rc;
+        do
+        {
+            rc = write(write_fd_, &value, sizeof(value));
+        } while (rc < 0 && EINTR == errno);
+        // EAGAIN means the counter is saturated, which is still readable
+    }
+
+    void event_notifier::consume()
+    {
+        uint64_t value;
+        ssize_t rc;
+        do
+        {
+            rc = read(read_fd_, &value, sizeof(value));
+        } while (rc < 0 && EINTR == errno);
+    }
+#else
+    event_notifier::event_notifier() :
+    read_fd_(-1),
+    write_fd_(-1)
+    {
+        int fds[2];
+        if (0 != ::pipe(fds))
+        {
+            throw exception("unable to create event descriptor");
+        }
+        read_fd_ = fds[0];
+        write_fd_ = fds[1];
+        for (int fd : fds)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+
+    event_notifier::~event_notifier()
+    {
+        close(read_fd_);
+        close(write_fd_);
+    }
+
+    void event_notifier::notify()
+    {
+        char value = 1;
+        ssize_t rc;
+        do
+        {
+            rc = write(write_fd_, &value, sizeof(value));
+        } while (rc < 0 && EINTR == errno);
+        // EAGAIN means the pipe is full, which is still readable
+    }
+
+    void event_notifier::consume()
+    {
+        char buffer[64];
+        ssize_t rc;
+        do
+        {
+            rc = read(read_fd_, buffer, sizeof(buffer));
+        } while (rc > 0 || (rc < 0 && EINTR == errno));
+    }
+#endif
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include "compatibility.hpp"
+
+#ifndef _WIN32
+
+namespace zmqpp
+{
+
+    /**
+     * A pollable wakeup flag that can be raised from any thread.
+     *
+     * It wraps an eventfd on linux and a non blocking pipe on other posix systems.
+     * The descriptor becomes readable once notify() has been called and stays
+     * readable until consume() is called, so it can be handed to a poller or loop
+     * as a standard socket alongside zmq sockets.
+     */
+    class ZMQPP_EXPORT event_notifier
+    {
+    public:
+        /**
+         * Create the underlying descriptor(s), throws zmqpp::exception on failure.
+         */
+        event_notifier();
+
+        /**
+         * Close the underlying descriptor(s).
+         */
+        ~event_notifier();
+
+        /**
+         * \return the descriptor to poll for input.
+         */
+        raw_socket_t fd() const { return read_fd_; }
+
+        /**
+         * Make the descriptor readable. Safe to call from any thread and never blocks.
+         */
+        void notify();
+
+        /**
+         * Clear all pending notifications. Never blocks.
+         */
+        void consume();
+
+    private:
+        raw_socket_t read_fd_;
+        raw_socket_t write_fd_;
+
+        // No copy - private and not implemented
+        event_notifier(event_notifier const&) ZMQPP_EXPLICITLY_DELETED;
+        event_notifier& operator=(event_notifier const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
+
+#endif
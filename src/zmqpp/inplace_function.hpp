@@ -0,0 +1,233 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "compatibility.hpp"
+
+namespace zmqpp
+{
+
+    template<typename Signature, size_t Capacity = 64>
+    class inplace_function;
+
+    /**
+     * Move only function wrapper with a guaranteed inline buffer.
+     *
+     * Any callable of up to Capacity bytes that can be moved without throwing is
+     * stored inside the wrapper itself, so wrapping a handler with a moderately
+     * heavy capture does not allocate. Larger callables still work but are moved to
+     * the heap, stored_inline() can be used to check a type at compile time.
+     *
+     * Unlike std::function it can't be copied, in exchange it holds move only
+     * callables too.
+     */
+    template<typename R, typename... Args, size_t Capacity>
+    class inplace_function<R(Args...), Capacity>
+    {
+    public:
+        inplace_function() NOEXCEPT :
+        ops_(nullptr)
+        {
+        }
+
+        inplace_function(std::nullptr_t) NOEXCEPT :
+        ops_(nullptr)
+        {
+        }
+
+        template<typename F,
+            typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, inplace_function>::value>::type,
+            typename = decltype(std::declval<typename std::decay<F>::type&>()(std::declval<Args>()...))>
+        inplace_function(F&& callable) :
+        ops_(nullptr)
+        {
+            typedef typename std::decay<F>::type functor_t;
+            if (is_null(callable))
+                return;
+
+            construct<functor_t>(std::forward<F>(callable), std::integral_constant<bool, stored_inline<functor_t>()>());
+        }
+
+        inplace_function(inplace_function&& other) NOEXCEPT :
+        ops_(other.ops_)
+        {
+            if (nullptr != ops_)
+            {
+                ops_->move(&storage_, &other.storage_);
+                other.ops_ = nullptr;
+            }
+        }
+
+        ~inplace_function()
+        {
+            reset();
+        }
+
+        inplace_function& operator=(inplace_function&& other) NOEXCEPT
+        {
+            if (this != &other)
+            {
+                reset();
+                if (nullptr != other.ops_)
+                {
+                    other.ops_->move(&storage_, &other.storage_);
+                    ops_ = other.ops_;
+                    other.ops_ = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        inplace_function& operator=(std::nullptr_t) NOEXCEPT
+        {
+            reset();
+            return *this;
+        }
+
+        /**
+         * Call the wrapped callable.
+         *
+         * \throws std::bad_function_call if empty.
+         */
+        R operator()(Args... args) const
+        {
+            if (nullptr == ops_)
+                throw std::bad_function_call();
+
+            return ops_->invoke(&storage_, std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const NOEXCEPT
+        {
+            return nullptr != ops_;
+        }
+
+        /**
+         * Check if a callable type fits the inline buffer.
+         *
+         * \return true if wrapping F will not allocate.
+         */
+        template<typename F>
+        static constexpr bool stored_inline()
+        {
+            return sizeof(F) <= Capacity &&
+                alignof(F) <= alignof(storage_t) &&
+                std::is_nothrow_move_constructible<F>::value;
+        }
+
+    private:
+        typedef typename std::aligned_storage<(Capacity < sizeof(void *) ? sizeof(void *) : Capacity), alignof(std::max_align_t)>::type storage_t;
+
+        struct operations
+        {
+            R (*invoke)(void *, Args&&...);
+            void (*move)(void *, void *);
+            void (*destroy)(void *);
+        };
+
+        template<typename F>
+        struct inline_operations
+        {
+            static R invoke(void *storage, Args&&... args)
+            {
+                return (*static_cast<F *> (storage))(std::forward<Args>(args)...);
+            }
+
+            static void move(void *destination, void *source)
+            {
+                F *functor = static_cast<F *> (source);
+                new (destination) F(std::move(*functor));
+                functor->~F();
+            }
+
+            static void destroy(void *storage)
+            {
+                static_cast<F *> (storage)->~F();
+            }
+
+            static operations const* get()
+            {
+                static operations const table = { &invoke, &move, &destroy };
+                return &table;
+            }
+        };
+
+        template<typename F>
+        struct heap_operations
+        {
+            static R invoke(void *storage, Args&&... args)
+            {
+                return (**static_cast<F **> (storage))(std::forward<Args>(args)...);
+            }
+
+            static void move(void *destination, void *source)
+            {
+                new (destination) F*(*static_cast<F **> (source));
+            }
+
+            static void destroy(void *storage)
+            {
+                delete *static_cast<F **> (storage);
+            }
+
+            static operations const* get()
+            {
+                static operations const table = { &invoke, &move, &destroy };
+                return &table;
+            }
+        };
+
+        template<typename F, typename Source>
+        void construct(Source&& callable, std::true_type)
+        {
+            new (&storage_) F(std::forward<Source>(callable));
+            ops_ = inline_operations<F>::get();
+        }
+
+        template<typename F, typename Source>
+        void construct(Source&& callable, std::false_type)
+        {
+            new (&storage_) F*(new F(std::forward<Source>(callable)));
+            ops_ = heap_operations<F>::get();
+        }
+
+        void reset() NOEXCEPT
+        {
+            if (nullptr != ops_)
+            {
+                ops_->destroy(&storage_);
+                ops_ = nullptr;
+            }
+        }
+
+        template<typename F>
+        static bool is_null(F const&) { return false; }
+
+        template<typename F>
+        static bool is_null(F* pointer) { return nullptr == pointer; }
+
+        template<typename S>
+        static bool is_null(std::function<S> const& function) { return !function; }
+
+        operations const* ops_;
+        mutable storage_t storage_;
+
+        // No copy - private and not implemented
+        inplace_function(inplace_function const&) ZMQPP_EXPLICITLY_DELETED;
+        inplace_function& operator=(inplace_function const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
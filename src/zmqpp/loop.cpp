@@ -18,21 +18,63 @@
 #include <algorithm>
 #include <zmq.h>
 
+#ifdef ZMQPP_HAVE_TIMERFD
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cstdint>
+#endif
+
 namespace zmqpp
 {
     loop::loop() :
+#ifdef ZMQPP_HAVE_TIMERFD
+    timer_fd_(-1),
+    timer_fd_deadline_(std::chrono::steady_clock::time_point::max()),
+#endif
+#ifndef _WIN32
+    posted_(),
+    post_notifier_(),
+    post_signalled_(false),
+#endif
+#ifdef ZMQPP_LOOP_METRICS
+    metrics_(std::make_shared<loop_metrics>()),
+#else
+    metrics_(),
+#endif
     dispatching_(false),
-    rebuild_poller_(false)
+    budget_exhausted_(false),
+    next_first_(0)
     {
+#ifndef _WIN32
+        poller_.add(post_notifier_.fd(), poller::poll_in);
+        // the loop's own descriptors are checked without a system call while
+        // spinning, consuming them copes with finding nothing to read
+        poller_.set_spin_check(post_notifier_.fd(), [this]() { return post_signalled_.load(std::memory_order_acquire); });
+#endif
+#ifdef ZMQPP_HAVE_TIMERFD
+        // std::chrono::steady_clock is CLOCK_MONOTONIC on linux so timer deadlines can be
+        // handed to the kernel as they are.
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd_ < 0)
+        {
+            throw exception("unable to create timer descriptor for loop");
+        }
+        poller_.add(timer_fd_, poller::poll_in);
+        poller_.set_spin_check(timer_fd_, [this]() { return std::chrono::steady_clock::now() >= timer_fd_deadline_; });
+#endif
     }
 
     loop::~loop()
     {
+#ifdef ZMQPP_HAVE_TIMERFD
+        close(timer_fd_);
+#endif
     }
 
-    loop::timer_t::timer_t(size_t times, std::chrono::milliseconds delay) :
+    loop::timer_t::timer_t(size_t times, std::chrono::microseconds delay, std::chrono::microseconds slack) :
     times(times),
     delay(delay),
+    slack(slack > std::chrono::microseconds::zero() ? slack : std::chrono::microseconds::zero()),
     when(std::chrono::steady_clock::now() + delay)
     {
     }
@@ -47,44 +89,85 @@ namespace zmqpp
         when += delay;
     }
 
-    void loop::add(socket& socket, Callable callable, short const event /* = POLL_IN */)
+    void loop::add(socket& socket, Callable callable, short const event /* = POLL_IN */, dispatch_budget const& budget /* = dispatch_budget() */)
     {
         zmq_pollitem_t item{static_cast<void *> (socket), 0, event, 0};
-        add(item, callable);
+        add(item, std::move(callable), budget);
     }
 
-    void loop::add(raw_socket_t const descriptor, Callable callable, short const event /* = POLL_IN */)
+    void loop::add(raw_socket_t const descriptor, Callable callable, short const event /* = POLL_IN */, dispatch_budget const& budget /* = dispatch_budget() */)
     {
         zmq_pollitem_t item{nullptr, descriptor, event, 0};
-        add(item, callable);
+        add(item, std::move(callable), budget);
     }
 
-    void loop::add(const zmq_pollitem_t& item, Callable callable)
+    void loop::add(const zmq_pollitem_t& item, Callable callable, dispatch_budget const& budget)
     {
+        // adding a socket again replaces its handler
+        if (nullptr != item.socket)
+        {
+            auto found = socket_slots_.find(item.socket);
+            if (socket_slots_.end() != found)
+                release(found->second);
+        }
+        else
+        {
+            auto found = fd_slots_.find(item.fd);
+            if (fd_slots_.end() != found)
+                release(found->second);
+        }
+        poller_.remove(item);
         poller_.add(item);
-        rebuild_poller_ = true;
-        items_.push_back(std::make_pair(item, callable));
+
+        registration_t registration{item, std::move(callable), budget, true,
+#ifdef ZMQPP_LOOP_METRICS
+            std::make_shared<latency_histogram>()
+#else
+            nullptr
+#endif
+        };
+
+        size_t slot = items_.size();
+        if (free_slots_.empty())
+        {
+            items_.push_back(std::move(registration));
+        }
+        else
+        {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+            items_[slot] = std::move(registration);
+        }
+
+        if (nullptr != item.socket)
+            socket_slots_[item.socket] = slot;
+        else
+            fd_slots_[item.fd] = slot;
     }
 
-    loop::timer_id_t loop::add(std::chrono::milliseconds delay, size_t times, Callable callable)
+    loop::timer_id_t loop::add(std::chrono::microseconds delay, size_t times, Callable callable, std::chrono::microseconds slack /* = 0 */)
     {
-        std::unique_ptr<timer_t> item(new timer_t(times, delay));
+        std::unique_ptr<timer_t> item(new timer_t(times, delay, slack));
         timer_id_t id = item.get();
-        add(std::move(item), callable);
+        add(std::move(item), std::move(callable));
         return id;
     }
 
     void loop::add(std::unique_ptr<timer_t> item, Callable callable)
     {
-        timers_.push_back(std::make_pair(std::move(item), callable));
-        timers_.sort(TimerItemCallablePairComp);
+        // merging keeps the list ordered in one pass instead of sorting it again
+        std::list<TimerItemCallablePair> single;
+        single.push_back(std::make_pair(std::move(item), std::move(callable)));
+        timers_.merge(single, TimerItemCallablePairComp);
     }
 
     void loop::reset(timer_id_t const timer) {
-        for(auto &item : timers_) {
-            if(item.first.get() == timer) {
-                item.first->reset();
-                timers_.sort(TimerItemCallablePairComp);
+        for(auto it = timers_.begin(); it != timers_.end(); ++it) {
+            if(it->first.get() == timer) {
+                it->first->reset();
+                std::list<TimerItemCallablePair> single;
+                single.splice(single.begin(), timers_, it);
+                timers_.merge(single, TimerItemCallablePairComp);
                 return;
             }
         }
@@ -104,50 +187,64 @@ namespace zmqpp
 
     void loop::remove(socket_t const& socket)
     {
-        if (dispatching_)
+        auto found = socket_slots_.find(static_cast<void *> (socket));
+        if (socket_slots_.end() != found)
         {
-            rebuild_poller_ = true;
-            sockRemoveLater_.push_back(&socket);
-            return;
+            release(found->second);
+            socket_slots_.erase(found);
         }
-        items_.erase(std::remove_if(items_.begin(), items_.end(), [&socket](const PollItemCallablePair & pair) -> bool
-        {
-            const zmq_pollitem_t &item = pair.first;
-            if (nullptr != item.socket && item.socket == static_cast<void *> (socket))
-            {
-                return true;
-            }
-            return false;
-        }), items_.end());
         poller_.remove(socket);
     }
 
     void loop::remove(raw_socket_t const descriptor)
     {
+        auto found = fd_slots_.find(descriptor);
+        if (fd_slots_.end() != found)
+        {
+            release(found->second);
+            fd_slots_.erase(found);
+        }
+        poller_.remove(descriptor);
+    }
+
+    void loop::release(size_t const slot)
+    {
+        items_[slot].live = false;
         if (dispatching_)
         {
-            rebuild_poller_ = true;
-            fdRemoveLater_.push_back(descriptor);
+            released_slots_.push_back(slot);
             return;
         }
-        items_.erase(std::remove_if(items_.begin(), items_.end(), [descriptor](const PollItemCallablePair & pair) -> bool
-        {
-            const zmq_pollitem_t &item = pair.first;
-            if (nullptr == item.socket && item.fd == descriptor)
-            {
-                return true;
-            }
-            return false;
-        }), items_.end());
-        poller_.remove(descriptor);
+        items_[slot].callable = nullptr;
+        free_slots_.push_back(slot);
     }
 
     void loop::start()
     {
+#ifdef ZMQPP_LOOP_METRICS
+        std::chrono::steady_clock::time_point woke;
+        bool awake = false;
+#endif
         while(1) {
-            rebuild_poller_ = false;
             flush_remove_later();
-            bool poll_rc = poller_.poll(tickless());
+#ifdef ZMQPP_LOOP_METRICS
+            std::chrono::steady_clock::time_point const idle = std::chrono::steady_clock::now();
+            if (awake)
+                metrics_->busy.record(idle - woke);
+#endif
+            // a handler stopped by its budget is still ready, so don't wait for anything else
+            bool poll_rc = poller_.poll(budget_exhausted_ ? 0 : tickless());
+            budget_exhausted_ = false;
+#ifdef ZMQPP_LOOP_METRICS
+            woke = std::chrono::steady_clock::now();
+            awake = true;
+            metrics_->poll_wait.record(woke - idle);
+            metrics_->iterations.store(metrics_->iterations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+#endif
+#ifdef ZMQPP_HAVE_TIMERFD
+            if (poll_rc && poller_.has_input(timer_fd_))
+                clear_timer_fd();
+#endif
 
             dispatching_ = true;
             bool continue_looping = start_handle_timers();
@@ -156,77 +253,258 @@ namespace zmqpp
             if(!continue_looping)
                 break;
 
-            if(rebuild_poller_)
-                continue;
-
             dispatching_ = true;
-            if(poll_rc)
+#ifndef _WIN32
+            if(poll_rc && poller_.has_input(post_notifier_.fd()))
+                continue_looping = start_handle_posted();
+#endif
+            if(poll_rc && continue_looping)
                 continue_looping = start_handle_poller();
             dispatching_ = false;
 
             if(!continue_looping)
                 break;
         }
+#ifdef ZMQPP_LOOP_METRICS
+        metrics_->busy.record(std::chrono::steady_clock::now() - woke);
+#endif
         flush_remove_later();
     }
 
     bool loop::start_handle_timers()
     {
         std::chrono::steady_clock::time_point time_now = std::chrono::steady_clock::now();
+        std::list<TimerItemCallablePair> rearmed;
+        bool timer_succedd = true;
         auto it = timers_.begin();
-        while(it != timers_.end()) {
-            if((*it).first->when < time_now) {
-                bool timer_succedd = (*it).second();
-                if((*it).first->times && --(*it).first->times == 0) {
-                    it = timers_.erase(it);
-                } else {
-                    (*it).first->update();
-                    ++it;
-                }
-                if(!timer_succedd)
-                    return false;
-            } else
-                break;
+        while(timer_succedd && it != timers_.end() && (*it).first->when <= time_now) {
+#ifdef ZMQPP_LOOP_METRICS
+            std::chrono::steady_clock::time_point const called = std::chrono::steady_clock::now();
+            metrics_->timer_lateness.record(called - (*it).first->when);
+#endif
+            timer_succedd = (*it).second();
+#ifdef ZMQPP_LOOP_METRICS
+            metrics_->timer_callbacks.record(std::chrono::steady_clock::now() - called);
+#endif
+            if((*it).first->times && --(*it).first->times == 0) {
+                it = timers_.erase(it);
+            } else {
+                (*it).first->update();
+                rearmed.splice(rearmed.end(), timers_, it++);
+            }
         }
-        timers_.sort(TimerItemCallablePairComp);
-        return true;
+        // only the timers that fired moved, so merge them back rather than sorting everything
+        rearmed.sort(TimerItemCallablePairComp);
+        timers_.merge(rearmed, TimerItemCallablePairComp);
+        return timer_succedd;
     }
 
     bool loop::start_handle_poller()
     {
-        for (const PollItemCallablePair &pair : items_)
+        // rotate the first registration served so one busy socket can't always go first
+        size_t const count = items_.size();
+        if (0 == count)
+            return true;
+        size_t const first = next_first_++ % count;
+
+        for (size_t i = 0; i < count; ++i)
         {
-            const zmq_pollitem_t &pollitem = pair.first;
+            size_t const index = (first + i) % count;
+            if (!items_[index].live)
+                continue;
+            const zmq_pollitem_t &pollitem = items_[index].item;
 
             if (poller_.has_input(pollitem) || poller_.has_error(pollitem) || poller_.has_output(pollitem))
-                if(!pair.second())
+                if(!dispatch(index))
                     return false;
         }
         return true;
     }
 
+    bool loop::dispatch(size_t const index)
+    {
+        // copy the budget and item, the handler may add or remove registrations
+        dispatch_budget const budget = items_[index].budget;
+        zmq_pollitem_t const pollitem = items_[index].item;
+        bool const timed = budget.time > std::chrono::microseconds::zero();
+        std::chrono::steady_clock::time_point const start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+#ifdef ZMQPP_LOOP_METRICS
+        // the slot can't be reused while dispatching so this stays valid
+        latency_histogram& latency = *items_[index].latency;
+#endif
+
+        size_t calls = 0;
+        for(;;)
+        {
+#ifdef ZMQPP_LOOP_METRICS
+            std::chrono::steady_clock::time_point const called = std::chrono::steady_clock::now();
+#endif
+            bool const keep_looping = items_[index].callable();
+#ifdef ZMQPP_LOOP_METRICS
+            latency.record(std::chrono::steady_clock::now() - called);
+#endif
+            if(!keep_looping)
+                return false;
+            ++calls;
+
+            bool const spent = (budget.calls > 0 && calls >= budget.calls) ||
+                (timed && std::chrono::steady_clock::now() - start >= budget.time);
+
+            // the default single call budget leaves it to the next poll, as it always has
+            if (1 == budget.calls || !items_[index].live)
+                return true;
+            if (0 == poller::current_events(pollitem))
+                return true;
+            if (spent)
+            {
+                budget_exhausted_ = true;
+                return true;
+            }
+        }
+    }
+
+    void loop::set_spin_policy(poller::spin_policy const& policy)
+    {
+        poller_.set_spin_policy(policy);
+    }
+
+#ifndef _WIN32
+    void loop::post(Callable callable)
+    {
+        posted_.push(std::move(callable));
+        // only the first post since the loop last drained the queue needs to wake it
+        if(!post_signalled_.exchange(true, std::memory_order_acq_rel))
+            post_notifier_.notify();
+    }
+
+    bool loop::start_handle_posted()
+    {
+        post_notifier_.consume();
+        // acquire pairs with the producers' exchange so every push that saw the flag
+        // still raised is visible to the pops below
+        post_signalled_.exchange(false, std::memory_order_acq_rel);
+
+        Callable callable;
+        while(posted_.pop(callable)) {
+#ifdef ZMQPP_LOOP_METRICS
+            std::chrono::steady_clock::time_point const called = std::chrono::steady_clock::now();
+#endif
+            bool const keep_looping = callable();
+#ifdef ZMQPP_LOOP_METRICS
+            metrics_->posted_callbacks.record(std::chrono::steady_clock::now() - called);
+#endif
+            if(!keep_looping) {
+                // leave the rest for the next start() but make sure it wakes for them
+                if(!posted_.empty() && !post_signalled_.exchange(true, std::memory_order_acq_rel))
+                    post_notifier_.notify();
+                return false;
+            }
+        }
+        return true;
+    }
+#endif
+
+    std::shared_ptr<loop_metrics const> loop::metrics() const
+    {
+        return metrics_;
+    }
+
+    std::shared_ptr<latency_histogram const> loop::callback_latency(socket_t const& socket) const
+    {
+        auto found = socket_slots_.find(static_cast<void *> (socket));
+        if (socket_slots_.end() == found)
+            return nullptr;
+        return items_[found->second].latency;
+    }
+
+    std::shared_ptr<latency_histogram const> loop::callback_latency(raw_socket_t const descriptor) const
+    {
+        auto found = fd_slots_.find(descriptor);
+        if (fd_slots_.end() == found)
+            return nullptr;
+        return items_[found->second].latency;
+    }
+
     void loop::flush_remove_later()
     {
-        for (raw_socket_t fd : fdRemoveLater_)
-            remove(fd);
-        for (const socket_t *sock : sockRemoveLater_)
-            remove(*sock);
+        for (size_t const slot : released_slots_)
+        {
+            items_[slot].callable = nullptr;
+            free_slots_.push_back(slot);
+        }
+        released_slots_.clear();
         for (const timer_id_t & timer : timerRemoveLater_)
             remove(timer);
-        fdRemoveLater_.clear();
-        sockRemoveLater_.clear();
         timerRemoveLater_.clear();
     }
 
+#ifdef ZMQPP_HAVE_TIMERFD
+    long loop::tickless() {
+        if(timers_.empty()) {
+            arm_timer_fd(std::chrono::steady_clock::time_point::max());
+            return poller::wait_forever;
+        }
+        std::chrono::steady_clock::time_point tick = next_deadline();
+        if(tick <= std::chrono::steady_clock::now())
+            return 0;
+        arm_timer_fd(tick);
+        return poller::wait_forever;
+    }
+
+    void loop::arm_timer_fd(std::chrono::steady_clock::time_point const& deadline)
+    {
+        if(deadline == timer_fd_deadline_)
+            return;
+
+        // an all zero it_value disarms the descriptor
+        struct itimerspec spec = {};
+        if(deadline != std::chrono::steady_clock::time_point::max()) {
+            std::chrono::nanoseconds since_epoch = deadline.time_since_epoch();
+            std::chrono::seconds seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+            spec.it_value.tv_sec = static_cast<time_t>(seconds.count());
+            spec.it_value.tv_nsec = static_cast<long>((since_epoch - seconds).count());
+        }
+        if(0 != timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr))
+            throw exception("unable to arm timer descriptor for loop");
+        timer_fd_deadline_ = deadline;
+    }
+
+    void loop::clear_timer_fd()
+    {
+        uint64_t expirations;
+        ssize_t rc = read(timer_fd_, &expirations, sizeof(expirations));
+        (void) rc; // EAGAIN just means someone else already consumed it
+        timer_fd_deadline_ = std::chrono::steady_clock::time_point::max();
+    }
+#else
     long loop::tickless() {
         std::chrono::steady_clock::time_point tick = std::chrono::steady_clock::now() + std::chrono::hours(1);
-        if(!timers_.empty() && timers_.front().first->when < tick)
-            tick = timers_.front().first->when;
-        long timeout = std::chrono::duration_cast<std::chrono::milliseconds>(tick - std::chrono::steady_clock::now()).count();
+        if(!timers_.empty())
+            tick = std::min(tick, next_deadline());
+        // round up so a sub millisecond deadline waits instead of spinning on a zero timeout
+        std::chrono::microseconds remaining = std::chrono::duration_cast<std::chrono::microseconds>(tick - std::chrono::steady_clock::now());
+        long timeout = static_cast<long>((remaining.count() + 999) / 1000);
         if(timeout < 0)
             timeout = 0;
         return timeout;
     }
+#endif
+
+    std::chrono::steady_clock::time_point loop::next_deadline() const
+    {
+        // timers are ordered by when, so once a timer is due after the deadline
+        // found so far no later one can bring it forward
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        for(auto const& timer : timers_) {
+            if(timer.first->when >= deadline)
+                break;
+            std::chrono::steady_clock::time_point const latest = timer.first->when + timer.first->slack;
+            if(latest < deadline)
+                deadline = latest;
+        }
+        return deadline;
+    }
 
     bool loop::TimerItemCallablePairComp(const TimerItemCallablePair &lhs, const TimerItemCallablePair &rhs)
     {
@@ -10,14 +10,22 @@
 #pragma once
 
 #include <tuple>
+#include <deque>
+#include <unordered_map>
 #include <vector>
 #include <list>
 #include <chrono>
 #include <functional>
 #include <memory>
+#include <atomic>
 
 #include "compatibility.hpp"
 #include "poller.hpp"
+#include "dispatch_budget.hpp"
+#include "inplace_function.hpp"
+#include "loop_metrics.hpp"
+#include "mpsc_queue.hpp"
+#include "event_notifier.hpp"
 
 namespace zmqpp
 {
@@ -39,7 +47,11 @@ namespace zmqpp
          * Type used to identify created timers withing loop
          */
         typedef void * timer_id_t;
-        typedef std::function<bool (void) > Callable;
+
+        /**
+         * Handler type, captures of up to 64 bytes are held without allocating.
+         */
+        typedef inplace_function<bool (void) > Callable;
 
         /**
          * Construct an empty polling model.
@@ -56,11 +68,14 @@ namespace zmqpp
         /**
          * Add a socket to the loop, providing a handler that will be called when the monitored events occur.
          *
+         * Adding a socket that is already monitored replaces its handler.
+         *
          * \param socket the socket to monitor.
          * \param callable the function that will be called by the loop when a registered event occurs on socket.
          * \param event the event flags to monitor on the socket.
+         * \param budget how many times, or for how long, the handler may be called per wakeup.
          */
-        ZMQPP_EXPORT void add(socket_t& socket, Callable callable, short const event = poller::poll_in);
+        ZMQPP_EXPORT void add(socket_t& socket, Callable callable, short const event = poller::poll_in, dispatch_budget const& budget = dispatch_budget());
 
         /*!
          * Add a standard socket to the loop, providing a handler that will be called when the monitored events occur.
@@ -68,17 +83,29 @@ namespace zmqpp
          * \param descriptor the standard socket to monitor (SOCKET under Windows, a file descriptor otherwise).
          * \param callable the function that will be called by the loop when a registered event occurs on fd.
          * \param event the event flags to monitor.
+         * \param budget how many times, or for how long, the handler may be called per wakeup.
          */
-        ZMQPP_EXPORT void add(raw_socket_t const descriptor, Callable callable, short const event = poller::poll_in | poller::poll_error);
+        ZMQPP_EXPORT void add(raw_socket_t const descriptor, Callable callable, short const event = poller::poll_in | poller::poll_error, dispatch_budget const& budget = dispatch_budget());
 
         /**
          * Add a timed event to the loop, providing a handler that will be called when timer fires.
          *
+         * Delays are kept with microsecond resolution. Where timerfd is available the loop
+         * waits on an absolute CLOCK_MONOTONIC deadline, otherwise the poll timeout is
+         * rounded up to the next millisecond so a timer never fires early.
+         *
+         * A timer given some slack may fire up to that much later than its delay. The
+         * loop wakes at the latest time that is still within every pending timer's
+         * slack and fires all the timers due by then, so timers that expire close
+         * together share one wakeup. Due timers also fire whenever the loop wakes
+         * for anything else.
+         *
          * \param delay time after which handler will be executed.
          * \param times how many times should timer be reneved - 0 for infinte ammount.
          * \param callable the function that will be called by the loop after delay.
+         * \param slack how late the timer may fire, negative values count as zero.
          */
-        ZMQPP_EXPORT timer_id_t add(std::chrono::milliseconds delay, size_t times, Callable callable);
+        ZMQPP_EXPORT timer_id_t add(std::chrono::microseconds delay, size_t times, Callable callable, std::chrono::microseconds slack = std::chrono::microseconds::zero());
 
         /**
          * Reset timer in the loop, it will start counting delay time again. Times argument is preserved.
@@ -97,6 +124,9 @@ namespace zmqpp
         /**
          * Stop monitoring a socket.
          *
+         * Takes constant time and may be called from a handler, a removed socket's
+         * handler is not called again even if it was ready in the same wakeup.
+         *
          * \param socket the socket to stop monitoring.
          */
         ZMQPP_EXPORT void remove(socket_t const& socket);
@@ -108,6 +138,64 @@ namespace zmqpp
          */
         ZMQPP_EXPORT void remove(raw_socket_t const descriptor);
 
+#ifndef _WIN32
+        /**
+         * Queue a handler to be called from the loop thread.
+         *
+         * This is the only loop method that is safe to call from any thread. Posted
+         * handlers run in posting order for each producer, all handlers queued before a
+         * wakeup are run in the same loop iteration and only the first post after a
+         * wakeup pays for signalling the loop. As with other handlers, returning false
+         * stops the loop.
+         *
+         * \param callable the function that will be called by the loop.
+         */
+        ZMQPP_EXPORT void post(Callable callable);
+#endif
+
+        /**
+         * Busy poll for up to a bounded time before each blocking wait.
+         *
+         * Only worth it for latency sensitive loops with a core to spare, see
+         * poller::spin_policy. Spinning is skipped while dispatch budgets leave work
+         * pending as the loop does not block then anyway. The loop's own timer and
+         * post descriptors are checked without a system call, a standard socket
+         * added to the loop makes each spin a zero timeout poll.
+         *
+         * \param policy the spin settings passed on to the loop's poller.
+         */
+        ZMQPP_EXPORT void set_spin_policy(poller::spin_policy const& policy);
+
+        /**
+         * Get the loop wide measurements, only recorded when the library is built
+         * with ZMQPP_LOOP_METRICS.
+         *
+         * The result may be read from any thread without locking and stays valid
+         * after the loop is destroyed.
+         *
+         * \return the measurements, null if the library doesn't record them.
+         */
+        ZMQPP_EXPORT std::shared_ptr<loop_metrics const> metrics() const;
+
+        /**
+         * Get the handler duration histogram of a socket, only recorded with
+         * ZMQPP_LOOP_METRICS. Call it from the loop's thread or before start, the
+         * histogram itself may then be read from any thread.
+         *
+         * \param socket a monitored socket.
+         * \return the histogram, null if the socket is not monitored or the
+         * library doesn't record them.
+         */
+        ZMQPP_EXPORT std::shared_ptr<latency_histogram const> callback_latency(socket_t const& socket) const;
+
+        /**
+         * Get the handler duration histogram of a standard socket, see above.
+         *
+         * \param descriptor a monitored standard socket.
+         * \return the histogram, null if the descriptor is not monitored.
+         */
+        ZMQPP_EXPORT std::shared_ptr<latency_histogram const> callback_latency(raw_socket_t const descriptor) const;
+
         /**
          * Starts loop. It will block until one of handlers returns false.
          */
@@ -116,46 +204,107 @@ namespace zmqpp
     private:
         struct timer_t {
             size_t times;
-            std::chrono::milliseconds delay;
+            std::chrono::microseconds delay;
+            std::chrono::microseconds slack;
             std::chrono::steady_clock::time_point when;
 
-            timer_t(size_t times, std::chrono::milliseconds delay);
+            timer_t(size_t times, std::chrono::microseconds delay, std::chrono::microseconds slack);
 
             void reset();
             void update();
         };
 
-        typedef std::pair<zmq_pollitem_t, Callable> PollItemCallablePair;
+        struct registration_t {
+            zmq_pollitem_t item;
+            Callable callable;
+            dispatch_budget budget;
+            bool live;
+            std::shared_ptr<latency_histogram> latency;
+        };
+
         typedef std::pair<std::unique_ptr<timer_t>, Callable> TimerItemCallablePair;
         static bool TimerItemCallablePairComp(const TimerItemCallablePair &lhs, const TimerItemCallablePair &rhs);
 
-        std::vector<PollItemCallablePair> items_;
+        // a deque so handlers adding registrations don't move the one being called,
+        // removed registrations are left as tombstones until their slot is reused
+        std::deque<registration_t> items_;
+        std::unordered_map<void *, size_t> socket_slots_;
+        std::unordered_map<raw_socket_t, size_t> fd_slots_;
+        std::vector<size_t> free_slots_;
+        std::vector<size_t> released_slots_;
         std::list<TimerItemCallablePair> timers_;
-        std::vector<const socket_t *> sockRemoveLater_;
-        std::vector<raw_socket_t> fdRemoveLater_;
         std::vector<timer_id_t> timerRemoveLater_;
 
 
-        void add(const zmq_pollitem_t &item, Callable callable);
+        void add(const zmq_pollitem_t &item, Callable callable, dispatch_budget const& budget);
         void add(std::unique_ptr<timer_t>, Callable callable);
 
         bool start_handle_timers();
         bool start_handle_poller();
 
         /**
-        * Flush the fdRemoveLater_ and sockRemoveLater_ vector, effectively removing
-        * the item for the reactor and poller.
+        * Call a ready registration's handler until it is no longer ready or its budget
+        * is spent, returns false if the handler asked to stop the loop.
+        */
+        bool dispatch(size_t const index);
+
+        /**
+        * Tombstone a registration, its handler is kept alive until dispatch is over.
+        */
+        void release(size_t const slot);
+#ifndef _WIN32
+        bool start_handle_posted();
+#endif
+
+        /**
+        * Make the slots released while dispatching available for reuse and remove
+        * the timers queued in timerRemoveLater_.
         */
         void flush_remove_later();
 
+        /**
+        * The coalesced wakeup time, the earliest time any pending timer's slack
+        * runs out. Call only with timers pending.
+        */
+        std::chrono::steady_clock::time_point next_deadline() const;
+
         /**
         * Calculate min time to wait in poller.
+        * With timerfd this arms the descriptor for the next deadline and only
+        * returns a non blocking timeout when a timer is already due.
         */
         long tickless();
 
+#ifdef ZMQPP_HAVE_TIMERFD
+        /**
+        * Arm the timer descriptor for an absolute deadline, or disarm it when
+        * there is no pending timer. Skips the syscall if the deadline is unchanged.
+        */
+        void arm_timer_fd(std::chrono::steady_clock::time_point const& deadline);
+
+        /**
+        * Consume a pending expiration from the timer descriptor.
+        */
+        void clear_timer_fd();
+
+        raw_socket_t timer_fd_;
+        std::chrono::steady_clock::time_point timer_fd_deadline_;
+#endif
+
+#ifndef _WIN32
+        mpsc_queue<Callable> posted_;
+        event_notifier post_notifier_;
+        std::atomic<bool> post_signalled_;
+#endif
+
+        // kept whether or not the library records metrics, so the layout
+        // doesn't depend on how it was built
+        std::shared_ptr<loop_metrics> metrics_;
+
         poller poller_;
         bool dispatching_;
-        bool rebuild_poller_;
+        bool budget_exhausted_;
+        size_t next_first_;
     };
 
 }
@@ -0,0 +1,196 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include "exception.hpp"
+#include "loop_group.hpp"
+
+#ifndef _WIN32
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace zmqpp
+{
+
+    namespace
+    {
+        // spread the shards over the cpus this process is allowed to use
+        std::vector<thread_placement> pinned_placements(size_t const shards, bool const pin_threads)
+        {
+            std::vector<thread_placement> placements(shards);
+#if defined(__linux__)
+            cpu_set_t allowed;
+            if (pin_threads && 0 == sched_getaffinity(0, sizeof(allowed), &allowed))
+            {
+                std::vector<unsigned int> cpus;
+                for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                {
+                    if (CPU_ISSET(cpu, &allowed))
+                        cpus.push_back(cpu);
+                }
+                for (size_t i = 0; i < shards && !cpus.empty(); ++i)
+                {
+                    placements[i].add_cpu(cpus[i % cpus.size()]);
+                }
+            }
+#else
+            (void) pin_threads;
+#endif
+            return placements;
+        }
+    }
+
+    loop_group::shard_t::shard_t() :
+    events(),
+    placement(),
+    thread(),
+    load(0),
+    error()
+    {
+    }
+
+    loop_group::loop_group(size_t const shards, bool const pin_threads /* = false */) :
+    loop_group(pinned_placements(shards, pin_threads))
+    {
+    }
+
+    loop_group::loop_group(thread_topology const& topology) :
+    loop_group(topology.get_shards())
+    {
+    }
+
+    loop_group::loop_group(std::vector<thread_placement> const& placements) :
+    shards_()
+    {
+        if (placements.empty())
+        {
+            throw exception("loop group needs at least one shard");
+        }
+
+        for (thread_placement const& placement : placements)
+        {
+            shards_.emplace_back(new shard_t());
+            shards_.back()->placement = placement;
+        }
+
+        try
+        {
+            for (std::unique_ptr<shard_t> const& shard : shards_)
+            {
+                shard->thread = std::thread(&loop_group::run, this, std::ref(*shard));
+            }
+        }
+        catch (...)
+        {
+            try { stop(); } catch (...) { }
+            throw;
+        }
+    }
+
+    loop_group::~loop_group()
+    {
+        try
+        {
+            stop();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    size_t loop_group::size() const
+    {
+        return shards_.size();
+    }
+
+    loop& loop_group::at(size_t const shard)
+    {
+        return shards_.at(shard)->events;
+    }
+
+    size_t loop_group::assign()
+    {
+        size_t chosen = 0;
+        size_t lowest = shards_[0]->load.load(std::memory_order_relaxed);
+        for (size_t i = 1; i < shards_.size() && lowest > 0; ++i)
+        {
+            size_t const load = shards_[i]->load.load(std::memory_order_relaxed);
+            if (load < lowest)
+            {
+                chosen = i;
+                lowest = load;
+            }
+        }
+
+        shards_[chosen]->load.fetch_add(1, std::memory_order_relaxed);
+        return chosen;
+    }
+
+    void loop_group::release(size_t const shard)
+    {
+        shards_.at(shard)->load.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    size_t loop_group::load(size_t const shard) const
+    {
+        return shards_.at(shard)->load.load(std::memory_order_relaxed);
+    }
+
+    void loop_group::post(size_t const shard, loop::Callable callable)
+    {
+        shards_.at(shard)->events.post(std::move(callable));
+    }
+
+    void loop_group::stop()
+    {
+        for (std::unique_ptr<shard_t> const& shard : shards_)
+        {
+            if (shard->thread.joinable())
+            {
+                shard->events.post([]() -> bool { return false; });
+            }
+        }
+
+        std::exception_ptr error;
+        for (std::unique_ptr<shard_t> const& shard : shards_)
+        {
+            if (shard->thread.joinable())
+            {
+                shard->thread.join();
+            }
+            if (!error && shard->error)
+            {
+                error = shard->error;
+            }
+            shard->error = nullptr;
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void loop_group::run(shard_t& shard)
+    {
+        try
+        {
+            shard.placement.apply();
+            shard.events.start();
+        }
+        catch (...)
+        {
+            shard.error = std::current_exception();
+        }
+    }
+
+}
+
+#endif
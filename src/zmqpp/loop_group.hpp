@@ -0,0 +1,164 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "compatibility.hpp"
+#include "loop.hpp"
+#include "thread_placement.hpp"
+
+#ifndef _WIN32
+
+namespace zmqpp
+{
+
+    /**
+     * A fixed set of loops, each run by its own thread.
+     *
+     * zmq sockets must only be used from one thread, so a socket belongs to the
+     * shard it is registered with for its whole life. Pick a shard with assign(),
+     * either by hashing a key so related sockets land together or by taking the
+     * least loaded shard, then create and register the socket from a handler
+     * posted to that shard.
+     *
+     * post() is the only way to reach a shard from another thread, including from
+     * other shards, and goes through the loop's lock free queue. Posted handlers run
+     * on the shard's thread in the order they were posted by each thread.
+     *
+     * As with a single loop a handler returning false stops its loop, which here
+     * only stops that shard. stop() stops all of them and waits for the threads.
+     */
+    class loop_group
+    {
+    public:
+        /**
+         * Start the shard threads, each waits on its own loop until stopped.
+         *
+         * \param shards number of loops and threads, at least one.
+         * \param pin_threads bind each shard to one of the cpus the process may use, only done on linux.
+         */
+        ZMQPP_EXPORT explicit loop_group(size_t const shards, bool const pin_threads = false);
+
+        /**
+         * Start one shard per placement, each thread applies its placement before
+         * waiting on its loop. A shard whose placement can't be applied doesn't run,
+         * its error is rethrown by stop().
+         *
+         * \param placements where to run each shard, at least one.
+         */
+        ZMQPP_EXPORT explicit loop_group(std::vector<thread_placement> const& placements);
+
+        /**
+         * Start one shard per shard placement of a topology.
+         *
+         * \param topology where to run each shard, with at least one shard.
+         */
+        ZMQPP_EXPORT explicit loop_group(thread_topology const& topology);
+
+        /**
+         * Stop all shards and wait for their threads. Errors are dropped, call
+         * stop() first to see them.
+         */
+        ZMQPP_EXPORT ~loop_group();
+
+        /**
+         * \return the number of shards.
+         */
+        ZMQPP_EXPORT size_t size() const;
+
+        /**
+         * Get a shard's loop, only to be used from that shard's thread.
+         *
+         * \param shard index of the shard.
+         * \return the loop run by the shard.
+         */
+        ZMQPP_EXPORT loop& at(size_t const shard);
+
+        /**
+         * Choose the shard with the fewest assigned sockets and count one more on it.
+         *
+         * \return index of the chosen shard.
+         */
+        ZMQPP_EXPORT size_t assign();
+
+        /**
+         * Choose a shard by hashing a key and count one more socket on it. The same
+         * key always picks the same shard.
+         *
+         * \param key value to hash with std::hash.
+         * \return index of the chosen shard.
+         */
+        template<typename Key>
+        size_t assign(Key const& key)
+        {
+            size_t const shard = std::hash<Key>()(key) % shards_.size();
+            shards_[shard]->load.fetch_add(1, std::memory_order_relaxed);
+            return shard;
+        }
+
+        /**
+         * Count one socket less on a shard, call once the socket has been removed.
+         *
+         * \param shard index of the shard.
+         */
+        ZMQPP_EXPORT void release(size_t const shard);
+
+        /**
+         * \param shard index of the shard.
+         * \return the number of sockets currently assigned to the shard.
+         */
+        ZMQPP_EXPORT size_t load(size_t const shard) const;
+
+        /**
+         * Queue a handler to be run by a shard. Safe to call from any thread.
+         *
+         * \param shard index of the shard.
+         * \param callable the function the shard will call, returning false stops the shard.
+         */
+        ZMQPP_EXPORT void post(size_t const shard, loop::Callable callable);
+
+        /**
+         * Stop all shards and wait for their threads to end.
+         *
+         * If a shard's loop threw, the first such exception is rethrown once all the
+         * threads have ended. Calling stop again does nothing.
+         */
+        ZMQPP_EXPORT void stop();
+
+    private:
+        struct shard_t
+        {
+            shard_t();
+
+            loop events;
+            thread_placement placement;
+            std::thread thread;
+            std::atomic<size_t> load;
+            std::exception_ptr error;
+        };
+
+        std::vector<std::unique_ptr<shard_t>> shards_;
+
+        void run(shard_t& shard);
+
+        // No copy - private and not implemented
+        loop_group(loop_group const&) ZMQPP_EXPLICITLY_DELETED;
+        loop_group& operator=(loop_group const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
+
+#endif
@@ -0,0 +1,210 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "compatibility.hpp"
+
+namespace zmqpp
+{
+
+    /**
+     * A point in time copy of a latency_histogram.
+     */
+    class histogram_snapshot
+    {
+    public:
+        histogram_snapshot() :
+        counts_(),
+        total_(0),
+        max_(0)
+        {
+        }
+
+        /**
+         * \return the number of recorded values.
+         */
+        uint64_t total() const { return total_; }
+
+        /**
+         * \return the largest recorded value.
+         */
+        std::chrono::nanoseconds max() const { return std::chrono::nanoseconds(max_); }
+
+        /**
+         * Get the value below which a fraction of the recorded values fall, as the
+         * upper bound of its bucket so it is never under reported by more than the
+         * bucket width of 12.5%.
+         *
+         * \param fraction between 0 and 1, 0.99 for the 99th percentile.
+         * \return the percentile, zero if nothing was recorded.
+         */
+        std::chrono::nanoseconds percentile(double const fraction) const;
+
+    private:
+        std::vector<uint64_t> counts_;
+        uint64_t total_;
+        uint64_t max_;
+
+        friend class latency_histogram;
+    };
+
+    /**
+     * Log linear histogram of durations, in the style of HdrHistogram.
+     *
+     * Each power of two from 8ns up is split in 8 buckets, so any duration up to
+     * centuries is kept with at most 12.5% error in a fixed 4KiB of counters.
+     *
+     * Values must be recorded by one thread at a time, which keeps recording to a
+     * couple of uncontended relaxed atomic operations. Any thread may take a
+     * snapshot at any time without locking, a snapshot taken while values are
+     * being recorded may miss the latest ones.
+     */
+    class latency_histogram
+    {
+    public:
+        static const size_t sub_bucket_bits = 3;
+        static const size_t sub_buckets = size_t(1) << sub_bucket_bits;
+        static const size_t bucket_count = sub_buckets + (64 - sub_bucket_bits) * sub_buckets;
+
+        latency_histogram()
+        {
+            for (std::atomic<uint64_t>& count : counts_)
+                count.store(0, std::memory_order_relaxed);
+            max_.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * Add a duration, negative durations count as zero.
+         *
+         * \param value the duration to record.
+         */
+        void record(std::chrono::nanoseconds const value)
+        {
+            uint64_t const nanoseconds = value.count() > 0 ? static_cast<uint64_t>(value.count()) : 0;
+
+            // single writer, so a load and store avoids a locked read-modify-write
+            std::atomic<uint64_t>& count = counts_[bucket_for(nanoseconds)];
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (nanoseconds > max_.load(std::memory_order_relaxed))
+                max_.store(nanoseconds, std::memory_order_relaxed);
+        }
+
+        /**
+         * Copy the current counts, safe to call from any thread.
+         *
+         * \return the copy.
+         */
+        histogram_snapshot snapshot() const
+        {
+            histogram_snapshot copy;
+            copy.counts_.resize(bucket_count);
+            for (size_t i = 0; i < bucket_count; ++i)
+            {
+                copy.counts_[i] = counts_[i].load(std::memory_order_relaxed);
+                copy.total_ += copy.counts_[i];
+            }
+            copy.max_ = max_.load(std::memory_order_relaxed);
+            return copy;
+        }
+
+        /**
+         * \param bucket index of a bucket.
+         * \return the largest value counted in the bucket.
+         */
+        static uint64_t bucket_upper_bound(size_t const bucket)
+        {
+            if (bucket < sub_buckets)
+                return bucket;
+
+            size_t const octave = (bucket - sub_buckets) / sub_buckets;
+            uint64_t const sub = (bucket - sub_buckets) % sub_buckets;
+            return ((sub_buckets + sub + 1) << octave) - 1;
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, bucket_count> counts_;
+        std::atomic<uint64_t> max_;
+
+        static size_t bucket_for(uint64_t const value)
+        {
+            if (value < sub_buckets)
+                return static_cast<size_t>(value);
+
+            size_t const top = highest_bit(value);
+            size_t const octave = top - sub_bucket_bits;
+            size_t const sub = static_cast<size_t>(value >> octave) & (sub_buckets - 1);
+            return sub_buckets + octave * sub_buckets + sub;
+        }
+
+        static size_t highest_bit(uint64_t value)
+        {
+#if defined(__GNUC__)
+            return 63 - __builtin_clzll(value);
+#else
+            size_t bit = 0;
+            while (value >>= 1)
+                ++bit;
+            return bit;
+#endif
+        }
+
+        // No copy - private and not implemented
+        latency_histogram(latency_histogram const&) ZMQPP_EXPLICITLY_DELETED;
+        latency_histogram& operator=(latency_histogram const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+    inline std::chrono::nanoseconds histogram_snapshot::percentile(double const fraction) const
+    {
+        if (0 == total_)
+            return std::chrono::nanoseconds::zero();
+
+        uint64_t const wanted = (fraction >= 1.0) ? total_ : static_cast<uint64_t>(fraction * total_) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            seen += counts_[i];
+            if (seen >= wanted)
+            {
+                uint64_t const bound = latency_histogram::bucket_upper_bound(i);
+                return std::chrono::nanoseconds(bound < max_ ? bound : max_);
+            }
+        }
+        return std::chrono::nanoseconds(max_);
+    }
+
+    /**
+     * Loop wide measurements, see loop::metrics.
+     *
+     * Busy time is measured from the end of one poll to the start of the next,
+     * callback histograms cover timers and posted handlers, socket handlers are
+     * measured per registration.
+     */
+    struct loop_metrics
+    {
+        loop_metrics() :
+        iterations(0)
+        {
+        }
+
+        latency_histogram poll_wait;        /*!< time spent blocked in poll */
+        latency_histogram busy;             /*!< time spent handling one wakeup */
+        latency_histogram timer_lateness;   /*!< how long after its deadline a timer fired */
+        latency_histogram timer_callbacks;  /*!< time spent in timer handlers */
+        latency_histogram posted_callbacks; /*!< time spent in posted handlers */
+        std::atomic<uint64_t> iterations;   /*!< number of wakeups handled */
+    };
+
+}
@@ -0,0 +1,118 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "compatibility.hpp"
+
+namespace zmqpp
+{
+
+    /**
+     * Unbounded lock-free multiple producer, single consumer queue.
+     *
+     * Any thread may push, only one thread at a time may pop. Pushing is wait free
+     * (one atomic exchange), popping never blocks but may briefly report an empty
+     * queue while a concurrent push is half way through linking its node.
+     *
+     * This follows Dmitry Vyukov's node based design, the queue always holds one
+     * stub node whose value has already been consumed.
+     */
+    template<typename T>
+    class mpsc_queue
+    {
+    public:
+        mpsc_queue() :
+        head_(new node()),
+        tail_(head_.load(std::memory_order_relaxed))
+        {
+        }
+
+        ~mpsc_queue()
+        {
+            node *item = tail_->next.load(std::memory_order_acquire);
+            delete tail_;
+            while (nullptr != item)
+            {
+                node *next = item->next.load(std::memory_order_acquire);
+                reinterpret_cast<T *> (&item->storage)->~T();
+                delete item;
+                item = next;
+            }
+        }
+
+        /**
+         * Add a value to the queue, safe to call from any thread.
+         *
+         * \param value the value to move into the queue.
+         */
+        void push(T value)
+        {
+            node *item = new node();
+            new (&item->storage) T(std::move(value));
+            node *previous = head_.exchange(item, std::memory_order_acq_rel);
+            previous->next.store(item, std::memory_order_release);
+        }
+
+        /**
+         * Take the oldest value from the queue. Must only be called by the consumer.
+         *
+         * \param value set to the popped value on success.
+         * \return true if a value was popped.
+         */
+        bool pop(T &value)
+        {
+            node *next = tail_->next.load(std::memory_order_acquire);
+            if (nullptr == next)
+            {
+                return false;
+            }
+
+            T *stored = reinterpret_cast<T *> (&next->storage);
+            value = std::move(*stored);
+            stored->~T();
+
+            delete tail_;
+            tail_ = next;
+            return true;
+        }
+
+        /**
+         * Check for pending values. Must only be called by the consumer.
+         *
+         * \return true if no value is ready to be popped.
+         */
+        bool empty() const
+        {
+            return nullptr == tail_->next.load(std::memory_order_acquire);
+        }
+
+    private:
+        struct node
+        {
+            node() : next(nullptr) { }
+
+            std::atomic<node *> next;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        };
+
+        std::atomic<node *> head_;
+        node *tail_;
+
+        // No copy - private and not implemented
+        mpsc_queue(mpsc_queue const&) ZMQPP_EXPLICITLY_DELETED;
+        mpsc_queue& operator=(mpsc_queue const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
@@ -0,0 +1,164 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "compatibility.hpp"
+
+namespace zmqpp
+{
+
+    /**
+     * Bounded lock-free multiple producer, single consumer ring.
+     *
+     * Every slot is allocated up front, so pushing and popping only move the
+     * value. Any thread may push, only one thread at a time may pop. A push to
+     * a full ring fails and leaves the value with the caller. A pop may briefly
+     * report an empty ring while a concurrent push is half way through
+     * filling its slot.
+     *
+     * This follows Dmitry Vyukov's bounded queue, each slot carries a sequence
+     * number saying whether it is free for the push or filled for the pop that
+     * reaches it next.
+     */
+    template<typename T>
+    class mpsc_ring
+    {
+    public:
+        /**
+         * \param capacity most values held, rounded up to a power of two.
+         */
+        explicit mpsc_ring(size_t const capacity) :
+        mask_(round_up(capacity) - 1),
+        slots_(new slot[mask_ + 1]),
+        push_position_(0),
+        pop_position_(0)
+        {
+            for (size_t i = 0; i <= mask_; ++i)
+            {
+                slots_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~mpsc_ring()
+        {
+            for (; !empty(); ++pop_position_)
+            {
+                reinterpret_cast<T*>(&slots_[pop_position_ & mask_].storage)->~T();
+            }
+        }
+
+        /**
+         * Add a value to the ring, safe to call from any thread.
+         *
+         * \param value the value to move into the ring, untouched if it is full.
+         * \return true if the value was added, false if the ring is full.
+         */
+        bool push(T& value)
+        {
+            size_t position = push_position_.load(std::memory_order_relaxed);
+            slot* item;
+            for(;;)
+            {
+                item = &slots_[position & mask_];
+                size_t const sequence = item->sequence.load(std::memory_order_acquire);
+                std::ptrdiff_t const difference = static_cast<std::ptrdiff_t>(sequence - position);
+                if (0 == difference)
+                {
+                    if (push_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (difference < 0)
+                {
+                    // the consumer hasn't freed this slot from the last lap
+                    return false;
+                }
+                else
+                {
+                    position = push_position_.load(std::memory_order_relaxed);
+                }
+            }
+
+            new (&item->storage) T(std::move(value));
+            item->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Take the oldest value from the ring. Must only be called by the consumer.
+         *
+         * \param value set to the popped value on success.
+         * \return true if a value was popped.
+         */
+        bool pop(T& value)
+        {
+            slot& item = slots_[pop_position_ & mask_];
+            if (item.sequence.load(std::memory_order_acquire) != pop_position_ + 1)
+            {
+                return false;
+            }
+
+            T* stored = reinterpret_cast<T*>(&item.storage);
+            value = std::move(*stored);
+            stored->~T();
+
+            // free for the push one lap on
+            item.sequence.store(pop_position_ + mask_ + 1, std::memory_order_release);
+            ++pop_position_;
+            return true;
+        }
+
+        /**
+         * Check for pending values. Must only be called by the consumer.
+         *
+         * \return true if no value is ready to be popped.
+         */
+        bool empty() const
+        {
+            return slots_[pop_position_ & mask_].sequence.load(std::memory_order_acquire) != pop_position_ + 1;
+        }
+
+        /**
+         * \return the most values held.
+         */
+        size_t capacity() const { return mask_ + 1; }
+
+    private:
+        struct slot
+        {
+            std::atomic<size_t> sequence;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        };
+
+        size_t const mask_;
+        std::unique_ptr<slot[]> slots_;
+        std::atomic<size_t> push_position_;
+        size_t pop_position_;
+
+        static size_t round_up(size_t const capacity)
+        {
+            size_t rounded = 1;
+            while (rounded < capacity)
+                rounded *= 2;
+            return rounded;
+        }
+
+        // No copy - private and not implemented
+        mpsc_ring(mpsc_ring const&) ZMQPP_EXPLICITLY_DELETED;
+        mpsc_ring& operator=(mpsc_ring const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
@@ -16,8 +16,19 @@
 #include "socket.hpp"
 #include "poller.hpp"
 
+#include <algorithm>
+
 #include <zmq.h>
 
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#include <immintrin.h>
+#define ZMQPP_CPU_RELAX() _mm_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define ZMQPP_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define ZMQPP_CPU_RELAX()
+#endif
+
 namespace zmqpp
 {
 
@@ -25,6 +36,9 @@ poller::poller()
 	: _items()
 	, _index()
 	, _fdindex()
+	, _spin_checks()
+	, _spin()
+	, _wait_estimate(std::chrono::nanoseconds::zero())
 {
 
 }
@@ -34,6 +48,7 @@ poller::~poller()
 	_items.clear();
 	_index.clear();
 	_fdindex.clear();
+	_spin_checks.clear();
 }
 
 void poller::add(socket& socket, short const event /* = POLL_IN */)
@@ -103,6 +118,7 @@ void poller::remove(raw_socket_t const descriptor)
 {
     auto found = _fdindex.find(descriptor);
     if (_fdindex.end() == found) { return; }
+    _spin_checks.erase(descriptor);
 
     if ( _items.size() - 1 == found->second )
     {
@@ -189,6 +205,130 @@ void poller::check_for(zmq_pollitem_t const& item, short const event)
 }
 
 bool poller::poll(long timeout /* = WAIT_FOREVER */)
+{
+	if (_spin.max_spin > std::chrono::microseconds::zero() && 0 != timeout)
+	{
+		return spin_then_poll(timeout);
+	}
+
+	return poll_items(timeout);
+}
+
+void poller::set_spin_policy(spin_policy const& policy)
+{
+	_spin = policy;
+	// start out assuming events arrive within the spin so adaptive polling tries it
+	_wait_estimate = std::chrono::duration_cast<std::chrono::nanoseconds>(policy.max_spin) / 2;
+}
+
+void poller::set_spin_check(raw_socket_t const descriptor, std::function<bool (void)> check)
+{
+	if (_fdindex.end() == _fdindex.find(descriptor))
+	{
+		throw exception("this standard socket is not represented within this poller");
+	}
+
+	if (check)
+	{
+		_spin_checks[descriptor] = std::move(check);
+	}
+	else
+	{
+		_spin_checks.erase(descriptor);
+	}
+}
+
+bool poller::spin_then_poll(long const timeout)
+{
+	std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+	std::chrono::nanoseconds limit = spin_budget();
+	if (timeout > 0)
+	{
+		limit = std::min<std::chrono::nanoseconds>(limit, std::chrono::milliseconds(timeout));
+	}
+
+	if (limit > std::chrono::nanoseconds::zero())
+	{
+		std::chrono::steady_clock::time_point now = start;
+		do
+		{
+			if (ready_now())
+			{
+				record_wait(now - start);
+				return true;
+			}
+			if (_spin.pause)
+			{
+				ZMQPP_CPU_RELAX();
+			}
+			now = std::chrono::steady_clock::now();
+		}
+		while (now - start < limit);
+	}
+
+	long remaining = timeout;
+	if (timeout > 0)
+	{
+		remaining -= static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+		remaining = std::max(remaining, 0L);
+	}
+
+	bool const result = poll_items(remaining);
+	record_wait(std::chrono::steady_clock::now() - start);
+	return result;
+}
+
+bool poller::ready_now()
+{
+	// zmq sockets are checked through ZMQ_EVENTS and standard sockets through
+	// their spin checks which avoids a system call per spin, a standard socket
+	// without one can only be checked by polling
+	if (_spin_checks.size() != _fdindex.size())
+	{
+		return poll_items(0);
+	}
+
+	bool ready = false;
+	for (zmq_pollitem_t& item : _items)
+	{
+		if (nullptr != item.socket)
+		{
+			item.revents = current_events(item);
+		}
+		else
+		{
+			item.revents = _spin_checks[item.fd]() ? (item.events & poll_in) : poll_none;
+		}
+		ready = ready || (poll_none != item.revents);
+	}
+	return ready;
+}
+
+std::chrono::nanoseconds poller::spin_budget() const
+{
+	std::chrono::nanoseconds const max_spin = _spin.max_spin;
+	if (!_spin.adaptive)
+	{
+		return max_spin;
+	}
+
+	// events usually take longer than we are willing to spin, don't burn the core
+	if (_wait_estimate > max_spin)
+	{
+		return std::chrono::nanoseconds::zero();
+	}
+
+	return std::min(max_spin, 2 * _wait_estimate);
+}
+
+void poller::record_wait(std::chrono::nanoseconds const wait)
+{
+	// exponentially weighted moving average with a weight of 1/8 for new samples
+	_wait_estimate += (wait - _wait_estimate) / 8;
+}
+
+bool poller::poll_items(long const timeout)
 {
 	int result = zmq_poll(_items.data(), _items.size(), timeout);
 	if (result < 0)
@@ -204,6 +344,32 @@ bool poller::poll(long timeout /* = WAIT_FOREVER */)
 	return (result > 0);
 }
 
+short poller::current_events(zmq_pollitem_t const& item)
+{
+	if (nullptr != item.socket)
+	{
+		int events = 0;
+		size_t size = sizeof(events);
+		if (0 != zmq_getsockopt(item.socket, ZMQ_EVENTS, &events, &size))
+		{
+			throw zmq_internal_exception();
+		}
+		return static_cast<short>(events) & item.events;
+	}
+
+	zmq_pollitem_t single = item;
+	single.revents = 0;
+	if (zmq_poll(&single, 1, 0) < 0)
+	{
+		if (EINTR == zmq_errno())
+		{
+			return poll_none;
+		}
+		throw zmq_internal_exception();
+	}
+	return single.revents;
+}
+
 short poller::events(socket const& socket) const
 {
 	auto found = _index.find(socket);
@@ -17,6 +17,8 @@
 #ifndef ZMQPP_POLLER_HPP_
 #define ZMQPP_POLLER_HPP_
 
+#include <chrono>
+#include <functional>
 #include <unordered_map>
 #include <vector>
 
@@ -50,6 +52,35 @@ public:
 #endif
 	};
 
+	/**
+	 * Busy polling settings for latency sensitive receivers.
+	 *
+	 * When spinning is enabled a blocking poll first checks for events without
+	 * blocking for up to max_spin, then falls back to a normal blocking poll for
+	 * the remaining timeout. Spinning avoids the sleep and wakeup cost at the price
+	 * of a busy core.
+	 *
+	 * An adaptive policy tracks how long polls wait for events and only spins when
+	 * events usually arrive within max_spin, spinning for about twice that wait.
+	 */
+	struct spin_policy
+	{
+		/**
+		 * \param max_spin longest time to spin before blocking, zero disables spinning.
+		 * \param adaptive scale the spin to the observed wait for events.
+		 * \param pause issue a cpu pause instruction between checks.
+		 */
+		spin_policy(std::chrono::microseconds const max_spin = std::chrono::microseconds::zero(), bool const adaptive = true, bool const pause = true)
+			: max_spin(max_spin)
+			, adaptive(adaptive)
+			, pause(pause)
+		{ }
+
+		std::chrono::microseconds max_spin; /*!< longest time to spin before blocking, zero disables spinning */
+		bool adaptive;                      /*!< scale the spin to the observed wait for events */
+		bool pause;                         /*!< issue a cpu pause instruction between checks */
+	};
+
 	/**
 	 * Construct an empty polling model.
 	 */
@@ -170,6 +201,34 @@ public:
 	 * \return true if there is an event..
 	 */
 	bool poll(long timeout = wait_forever);
+
+	/**
+	 * Set the busy polling settings used by poll(), spinning is off by default.
+	 *
+	 * \param policy the spin settings.
+	 */
+	void set_spin_policy(spin_policy const& policy);
+
+	/**
+	 * Get the busy polling settings used by poll().
+	 *
+	 * \return the spin settings.
+	 */
+	spin_policy const& get_spin_policy() const { return _spin; }
+
+	/**
+	 * Let spinning check a standard socket without a system call.
+	 *
+	 * Spinning reads ZMQ_EVENTS for zmq sockets, but as long as one standard
+	 * socket has no check every spin is a zero timeout poll of everything. A
+	 * check suits descriptors whose owner knows when they become readable,
+	 * such as a timer it armed or a notifier it signalled. It may report input
+	 * early, a read must then cope with finding nothing.
+	 *
+	 * \param descriptor a standard socket known to the poller.
+	 * \param check returns true when the descriptor has input, empty to remove it.
+	 */
+	void set_spin_check(raw_socket_t const descriptor, std::function<bool (void)> check);
 	
 	/**
 	 * Get the event flags triggered for a socket.
@@ -195,6 +254,17 @@ public:
 	 */
 	short events(zmq_pollitem_t const& item) const;
 
+	/**
+	 * Check the events currently ready on a single pollitem without blocking.
+	 *
+	 * For zmq sockets this reads ZMQ_EVENTS, standard sockets are polled with a
+	 * zero timeout. Only the flags requested in the item's events are returned.
+	 *
+	 * \param item the pollitem to check, it does not need to be in a poller.
+	 * \return the ready event flags.
+	 */
+	static short current_events(zmq_pollitem_t const& item);
+
 	/**
 	 * Check either a standard socket or zmq socket for input events.
 	 *
@@ -235,9 +305,18 @@ private:
 	std::vector<zmq_pollitem_t> _items;
 	std::unordered_map<void *, size_t> _index;
 	std::unordered_map<raw_socket_t, size_t> _fdindex;
+	std::unordered_map<raw_socket_t, std::function<bool (void)>> _spin_checks;
+	spin_policy _spin;
+	std::chrono::nanoseconds _wait_estimate;
 
 	void reindex(size_t const index);
 	void remove(void* zmq_socket);
+
+	bool poll_items(long const timeout);
+	bool spin_then_poll(long const timeout);
+	bool ready_now();
+	std::chrono::nanoseconds spin_budget() const;
+	void record_wait(std::chrono::nanoseconds const wait);
 };
 
 }
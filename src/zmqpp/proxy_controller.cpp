@@ -0,0 +1,163 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <cstring>
+
+#include "exception.hpp"
+#include "message.hpp"
+#include "proxy_controller.hpp"
+#include "socket.hpp"
+
+namespace zmqpp
+{
+
+    namespace
+    {
+        size_t const statistics_frames = 8;
+
+        uint64_t since(uint64_t const now, uint64_t const before)
+        {
+            // counters only go back if the proxy was restarted
+            return (now >= before) ? now - before : now;
+        }
+
+        proxy_side_rates rates(proxy_side_stats const& now, proxy_side_stats const& before, double const seconds)
+        {
+            proxy_side_rates rates;
+            rates.messages_in = since(now.messages_in, before.messages_in) / seconds;
+            rates.bytes_in = since(now.bytes_in, before.bytes_in) / seconds;
+            rates.messages_out = since(now.messages_out, before.messages_out) / seconds;
+            rates.bytes_out = since(now.bytes_out, before.bytes_out) / seconds;
+            return rates;
+        }
+    }
+
+    proxy_controller::proxy_controller(socket_t& control) :
+    control_(control),
+    replies_(socket_type::request == control.type())
+    {
+        if (!replies_ && socket_type::pair != control.type())
+        {
+            throw exception("proxy control socket must be a PAIR or REQ socket");
+        }
+    }
+
+    void proxy_controller::pause()
+    {
+        command("PAUSE");
+    }
+
+    void proxy_controller::resume()
+    {
+        command("RESUME");
+    }
+
+    void proxy_controller::terminate()
+    {
+        command("TERMINATE");
+    }
+
+    proxy_stats proxy_controller::statistics()
+    {
+        control_.send("STATISTICS");
+
+        message reply;
+        control_.receive(reply);
+        return decode(reply);
+    }
+
+    proxy_stats proxy_controller::decode(message const& reply)
+    {
+        if (statistics_frames != reply.parts())
+        {
+            throw exception("proxy statistics reply must have eight frames");
+        }
+
+        uint64_t values[statistics_frames];
+        for (size_t i = 0; i < statistics_frames; ++i)
+        {
+            if (sizeof(uint64_t) != reply.size(i))
+            {
+                throw exception("proxy statistics reply frames must hold a uint64_t");
+            }
+            std::memcpy(&values[i], reply.raw_data(i), sizeof(uint64_t));
+        }
+
+        proxy_stats stats;
+        stats.frontend.messages_in = values[0];
+        stats.frontend.bytes_in = values[1];
+        stats.frontend.messages_out = values[2];
+        stats.frontend.bytes_out = values[3];
+        stats.backend.messages_in = values[4];
+        stats.backend.bytes_in = values[5];
+        stats.backend.messages_out = values[6];
+        stats.backend.bytes_out = values[7];
+        return stats;
+    }
+
+    void proxy_controller::encode(proxy_stats const& stats, message& reply)
+    {
+        uint64_t const values[statistics_frames] = {
+            stats.frontend.messages_in, stats.frontend.bytes_in, stats.frontend.messages_out, stats.frontend.bytes_out,
+            stats.backend.messages_in, stats.backend.bytes_in, stats.backend.messages_out, stats.backend.bytes_out
+        };
+
+        for (uint64_t const& value : values)
+        {
+            reply.push_back(&value, sizeof(value));
+        }
+    }
+
+    void proxy_controller::command(char const* const name)
+    {
+        control_.send(name);
+
+        // a REP control socket answers with an empty message
+        if (replies_)
+        {
+            message reply;
+            control_.receive(reply);
+        }
+    }
+
+    proxy_sampler::proxy_sampler(proxy_controller& controller) :
+    controller_(controller),
+    last_(controller.statistics()),
+    taken_(std::chrono::steady_clock::now()),
+    callback_()
+    {
+    }
+
+    proxy_rates proxy_sampler::sample()
+    {
+        proxy_stats const stats = controller_.statistics();
+        std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+
+        proxy_rates result;
+        result.period = std::chrono::duration_cast<std::chrono::microseconds>(now - taken_);
+
+        // a zero period only counts what arrived since, rather than dividing by zero
+        double const seconds = (result.period.count() > 0) ? result.period.count() / 1e6 : 1.0;
+        result.frontend = rates(stats.frontend, last_.frontend, seconds);
+        result.backend = rates(stats.backend, last_.backend, seconds);
+
+        last_ = stats;
+        taken_ = now;
+        return result;
+    }
+
+    loop::timer_id_t proxy_sampler::watch(loop& events, std::chrono::milliseconds const interval, Callback callback)
+    {
+        callback_ = std::move(callback);
+        return events.add(interval, 0, [this]() -> bool {
+            return callback_(sample());
+        });
+    }
+
+}
@@ -0,0 +1,196 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "compatibility.hpp"
+#include "inplace_function.hpp"
+#include "loop.hpp"
+
+namespace zmqpp
+{
+    class message;
+    class socket;
+    typedef socket socket_t;
+
+    /**
+     * Traffic through one side of a proxy, as counted by the proxy.
+     */
+    struct proxy_side_stats
+    {
+        uint64_t messages_in;  /*!< messages received on this side */
+        uint64_t bytes_in;     /*!< bytes received on this side */
+        uint64_t messages_out; /*!< messages sent on this side */
+        uint64_t bytes_out;    /*!< bytes sent on this side */
+    };
+
+    /**
+     * Statistics of a proxy, the decoded reply to a STATISTICS command.
+     */
+    struct proxy_stats
+    {
+        proxy_side_stats frontend;
+        proxy_side_stats backend;
+    };
+
+    /**
+     * Traffic through one side of a proxy, per second.
+     */
+    struct proxy_side_rates
+    {
+        double messages_in;
+        double bytes_in;
+        double messages_out;
+        double bytes_out;
+    };
+
+    /**
+     * Rates of a proxy over the time between two samples.
+     */
+    struct proxy_rates
+    {
+        proxy_side_rates frontend;
+        proxy_side_rates backend;
+        std::chrono::microseconds period; /*!< time the rates were measured over */
+    };
+
+    /**
+     * Typed commands to a running proxy_steerable or a proxy_engine with a
+     * control socket, instead of hand crafted command frames.
+     *
+     * The controller sends on a socket connected to the proxy's control socket,
+     * usually a PAIR to its PAIR. A REQ to a REP also works with a proxy that
+     * answers every command, as proxy_engine does, the controller then waits
+     * for each answer so the REQ is ready for the next command.
+     *
+     * A proxy_engine always answers statistics, proxy_steerable only with zmq
+     * 4.3 or later built with the draft API.
+     *
+     * Like its socket, a controller belongs to one thread.
+     */
+    class proxy_controller
+    {
+    public:
+        /**
+         * \param control a PAIR or REQ socket connected to the proxy's control
+         *        socket, it must outlive the controller.
+         */
+        ZMQPP_EXPORT explicit proxy_controller(socket_t& control);
+
+        /**
+         * Stop forwarding until resumed. Messages queue up in the proxy's sockets.
+         */
+        ZMQPP_EXPORT void pause();
+
+        /**
+         * Forward again after a pause.
+         */
+        ZMQPP_EXPORT void resume();
+
+        /**
+         * End the proxy.
+         */
+        ZMQPP_EXPORT void terminate();
+
+        /**
+         * Ask the proxy for its counters, blocking until it answers.
+         *
+         * Throws zmqpp::exception if the answer is not a statistics reply.
+         *
+         * \return the proxy's counters since it started.
+         */
+        ZMQPP_EXPORT proxy_stats statistics();
+
+        /**
+         * Decode a statistics reply, eight frames each holding a uint64_t.
+         *
+         * Throws zmqpp::exception if the message is not a statistics reply.
+         *
+         * \param reply the message to decode.
+         * \return the counters it holds.
+         */
+        ZMQPP_EXPORT static proxy_stats decode(message const& reply);
+
+        /**
+         * Encode counters as a statistics reply, as a proxy answers.
+         *
+         * \param stats the counters.
+         * \param reply the message to append the eight frames to.
+         */
+        ZMQPP_EXPORT static void encode(proxy_stats const& stats, message& reply);
+
+    private:
+        socket_t& control_;
+        bool replies_;
+
+        void command(char const* const name);
+    };
+
+    /**
+     * Turns a proxy's counters into rates by sampling its statistics.
+     *
+     * Each sample gives the rates since the previous one, so a proxy can be
+     * watched live without stopping it. Samples can be taken by hand or from a
+     * timer on a loop with watch().
+     */
+    class proxy_sampler
+    {
+    public:
+        /**
+         * Called with the rates of each sample taken by the loop, return false to
+         * stop the loop.
+         */
+        typedef inplace_function<bool (proxy_rates const& rates)> Callback;
+
+        /**
+         * Take a first sample to measure from.
+         *
+         * \param controller the controller of the proxy to sample, it must
+         *        outlive the sampler.
+         */
+        ZMQPP_EXPORT explicit proxy_sampler(proxy_controller& controller);
+
+        /**
+         * Sample the proxy's statistics.
+         *
+         * \return the rates since the previous sample.
+         */
+        ZMQPP_EXPORT proxy_rates sample();
+
+        /**
+         * \return the statistics of the last sample.
+         */
+        proxy_stats const& last() const { return last_; }
+
+        /**
+         * Sample on a timer of a loop, which must run on the controller's thread.
+         * Replaces any callback set by a previous call.
+         *
+         * \param events the loop to add the timer to.
+         * \param interval time between samples.
+         * \param callback called with the rates of each sample.
+         * \return the timer, to remove it from the loop.
+         */
+        ZMQPP_EXPORT loop::timer_id_t watch(loop& events, std::chrono::milliseconds const interval, Callback callback);
+
+    private:
+        proxy_controller& controller_;
+        proxy_stats last_;
+        std::chrono::steady_clock::time_point taken_;
+        Callback callback_;
+
+        // No copy - private and not implemented
+        proxy_sampler(proxy_sampler const&) ZMQPP_EXPLICITLY_DELETED;
+        proxy_sampler& operator=(proxy_sampler const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
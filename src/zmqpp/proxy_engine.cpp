@@ -0,0 +1,347 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <cerrno>
+
+#include "exception.hpp"
+#include "message.hpp"
+#include "proxy_controller.hpp"
+#include "proxy_engine.hpp"
+#include "socket.hpp"
+
+#if (ZMQ_VERSION_MAJOR > 3) || ((ZMQ_VERSION_MAJOR == 3) && (ZMQ_VERSION_MINOR >= 2))
+
+namespace zmqpp
+{
+
+    namespace
+    {
+        // single writer, so a load and store avoids a locked read-modify-write
+        inline void add_to(std::atomic<uint64_t>& counter, uint64_t const amount)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        inline bool writable(socket_t& target)
+        {
+            zmq_pollitem_t const item{static_cast<void *> (target), 0, poller::poll_out, 0};
+            return 0 != (poller::current_events(item) & poller::poll_out);
+        }
+    }
+
+    const size_t proxy_engine::default_batch_size;
+
+    proxy_engine::path_t::path_t() :
+    source(nullptr),
+    target(nullptr),
+    hook(),
+    blocked(false),
+    messages_received(0),
+    bytes_received(0),
+    messages_sent(0),
+    bytes_sent(0)
+    {
+    }
+
+    proxy_engine::proxy_engine(socket_t& frontend, socket_t& backend) :
+    paths_(),
+    capture_(nullptr),
+    capture_tagged_(false),
+    control_(nullptr),
+    paused_(false),
+    batch_size_(default_batch_size)
+#ifndef _WIN32
+    , stop_notifier_()
+#endif
+    {
+        paths_[static_cast<size_t>(direction::frontend_to_backend)].source = &frontend;
+        paths_[static_cast<size_t>(direction::frontend_to_backend)].target = &backend;
+        paths_[static_cast<size_t>(direction::backend_to_frontend)].source = &backend;
+        paths_[static_cast<size_t>(direction::backend_to_frontend)].target = &frontend;
+    }
+
+    void proxy_engine::set_capture(socket_t& capture, bool const tagged /* = false */)
+    {
+        capture_ = &capture;
+        capture_tagged_ = tagged;
+    }
+
+    void proxy_engine::set_control(socket_t& control)
+    {
+        control_ = &control;
+    }
+
+    void proxy_engine::set_hook(direction const way, Hook hook)
+    {
+        paths_[static_cast<size_t>(way)].hook = std::move(hook);
+    }
+
+    void proxy_engine::set_batch_size(size_t const messages)
+    {
+        if (0 == messages)
+        {
+            throw exception("proxy batch size must be at least one message");
+        }
+        batch_size_ = messages;
+    }
+
+    proxy_counters proxy_engine::counters(direction const way) const
+    {
+        path_t const& path = paths_[static_cast<size_t>(way)];
+        proxy_counters copy;
+        copy.messages_received = path.messages_received.load(std::memory_order_relaxed);
+        copy.bytes_received = path.bytes_received.load(std::memory_order_relaxed);
+        copy.messages_sent = path.messages_sent.load(std::memory_order_relaxed);
+        copy.bytes_sent = path.bytes_sent.load(std::memory_order_relaxed);
+        return copy;
+    }
+
+    void proxy_engine::run()
+    {
+        socket_t& frontend = *paths_[0].source;
+        socket_t& backend = *paths_[1].source;
+
+        poller poller;
+        poller.add(frontend, poller::poll_in);
+        poller.add(backend, poller::poll_in);
+#ifndef _WIN32
+        poller.add(stop_notifier_.fd(), poller::poll_in);
+#endif
+        if (nullptr != control_)
+            poller.add(*control_, poller::poll_in);
+
+        try
+        {
+            for(;;)
+            {
+                // wait for input on a source only while its target can take it,
+                // a blocked direction waits for its target to drain instead and
+                // a paused proxy only waits for commands
+                short frontend_events = 0;
+                short backend_events = 0;
+                for (path_t& path : paths_)
+                {
+                    if (paused_)
+                        break;
+
+                    bool const from_frontend = (path.source == &frontend);
+                    if (path.blocked)
+                        (from_frontend ? backend_events : frontend_events) |= poller::poll_out;
+                    else
+                        (from_frontend ? frontend_events : backend_events) |= poller::poll_in;
+                }
+                poller.check_for(frontend, frontend_events);
+                poller.check_for(backend, backend_events);
+
+                poller.poll();
+
+#ifndef _WIN32
+                if (poller.has_input(stop_notifier_.fd()))
+                {
+                    stop_notifier_.consume();
+                    return;
+                }
+#endif
+
+                if (nullptr != control_ && poller.has_input(*control_) && !control())
+                    return;
+
+                for (path_t& path : paths_)
+                {
+                    if (paused_)
+                        break;
+                    if (poller.has_input(*path.source) || poller.has_output(*path.target))
+                        path.blocked = !forward(path);
+                }
+            }
+        }
+        catch (zmq_internal_exception const& e)
+        {
+            if (ETERM != e.zmq_error())
+                throw;
+        }
+    }
+
+#ifndef _WIN32
+    void proxy_engine::stop()
+    {
+        stop_notifier_.notify();
+    }
+#endif
+
+    bool proxy_engine::control()
+    {
+        message command;
+        if (!control_->receive(command, true))
+            return true;
+
+        std::string const name = (command.parts() > 0) ? command.get(0) : std::string();
+        bool running = true;
+
+        message reply;
+        if ("PAUSE" == name)
+            paused_ = true;
+        else if ("RESUME" == name)
+            paused_ = false;
+        else if ("TERMINATE" == name)
+            running = false;
+        else if ("STATISTICS" == name)
+        {
+            proxy_counters const forward = counters(direction::frontend_to_backend);
+            proxy_counters const back = counters(direction::backend_to_frontend);
+
+            proxy_stats stats;
+            stats.frontend.messages_in = forward.messages_received;
+            stats.frontend.bytes_in = forward.bytes_received;
+            stats.frontend.messages_out = back.messages_sent;
+            stats.frontend.bytes_out = back.bytes_sent;
+            stats.backend.messages_in = back.messages_received;
+            stats.backend.bytes_in = back.bytes_received;
+            stats.backend.messages_out = forward.messages_sent;
+            stats.backend.bytes_out = forward.bytes_sent;
+            proxy_controller::encode(stats, reply);
+        }
+
+        // statistics are always answered, other commands only to keep a REP in step
+        if (0 == reply.parts() && socket_type::reply == control_->type())
+            reply.push_back("");
+        if (reply.parts() > 0)
+            control_->send(reply);
+
+        return running;
+    }
+
+    void proxy_engine::send_tag(path_t const& path)
+    {
+        uint8_t const tag = static_cast<uint8_t>(&path - paths_);
+        capture_->send_raw(reinterpret_cast<char const*>(&tag), sizeof(tag), socket::send_more);
+    }
+
+    bool proxy_engine::forward(path_t& path)
+    {
+        for (size_t i = 0; i < batch_size_; ++i)
+        {
+            // checked per message so a send never blocks the other direction
+            if (!writable(*path.target))
+                return false;
+
+            bool const forwarded = path.hook ? forward_message(path) : forward_frames(path);
+            if (!forwarded)
+                break;
+        }
+        return true;
+    }
+
+    bool proxy_engine::forward_frames(path_t& path)
+    {
+        void* const source = static_cast<void *> (*path.source);
+        void* const target = static_cast<void *> (*path.target);
+        void* const capture = (nullptr == capture_) ? nullptr : static_cast<void *> (*capture_);
+
+        zmq_msg_t part;
+        zmq_msg_init(&part);
+
+        uint64_t bytes = 0;
+        bool first = true;
+        bool more = true;
+        while (more)
+        {
+            // the rest of a message is always available once its first part is
+            if (zmq_msg_recv(&part, source, ZMQ_DONTWAIT) < 0)
+            {
+                int const error = zmq_errno();
+                if (EINTR == error || (first && EAGAIN == error))
+                {
+                    if (first)
+                    {
+                        zmq_msg_close(&part);
+                        return false;
+                    }
+                    continue;
+                }
+                zmq_internal_exception const failure;
+                zmq_msg_close(&part);
+                throw failure;
+            }
+
+            if (first && nullptr != capture && capture_tagged_)
+                send_tag(path);
+
+            first = false;
+            more = (0 != zmq_msg_more(&part));
+            bytes += zmq_msg_size(&part);
+            int const flags = more ? ZMQ_SNDMORE : 0;
+
+            if (nullptr != capture)
+            {
+                zmq_msg_t copy;
+                zmq_msg_init(&copy);
+                zmq_msg_copy(&copy, &part);
+                if (zmq_msg_send(&copy, capture, flags) < 0)
+                {
+                    zmq_internal_exception const failure;
+                    zmq_msg_close(&copy);
+                    zmq_msg_close(&part);
+                    throw failure;
+                }
+            }
+
+            // ownership of the data moves to the target, nothing is copied
+            if (zmq_msg_send(&part, target, flags) < 0)
+            {
+                zmq_internal_exception const failure;
+                zmq_msg_close(&part);
+                throw failure;
+            }
+        }
+        zmq_msg_close(&part);
+
+        add_to(path.messages_received, 1);
+        add_to(path.bytes_received, bytes);
+        add_to(path.messages_sent, 1);
+        add_to(path.bytes_sent, bytes);
+        return true;
+    }
+
+    bool proxy_engine::forward_message(path_t& path)
+    {
+        message msg;
+        if (!path.source->receive(msg, true))
+            return false;
+
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < msg.parts(); ++i)
+            bytes += msg.size(i);
+        add_to(path.messages_received, 1);
+        add_to(path.bytes_received, bytes);
+
+        if (nullptr != capture_)
+        {
+            message copy = msg.copy();
+            if (capture_tagged_)
+                send_tag(path);
+            capture_->send(copy);
+        }
+
+        if (!path.hook(msg) || 0 == msg.parts())
+            return true;
+
+        bytes = 0;
+        for (size_t i = 0; i < msg.parts(); ++i)
+            bytes += msg.size(i);
+
+        path.target->send(msg);
+        add_to(path.messages_sent, 1);
+        add_to(path.bytes_sent, bytes);
+        return true;
+    }
+
+}
+
+#endif
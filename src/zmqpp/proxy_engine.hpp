@@ -0,0 +1,194 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "compatibility.hpp"
+#include "inplace_function.hpp"
+#include "poller.hpp"
+
+#ifndef _WIN32
+#include "event_notifier.hpp"
+#endif
+
+#if (ZMQ_VERSION_MAJOR > 3) || ((ZMQ_VERSION_MAJOR == 3) && (ZMQ_VERSION_MINOR >= 2))
+
+namespace zmqpp
+{
+    class message;
+    class socket;
+    typedef socket socket_t;
+
+    /**
+     * Traffic counters for one direction of a proxy_engine.
+     */
+    struct proxy_counters
+    {
+        uint64_t messages_received; /*!< messages read from the source */
+        uint64_t bytes_received;    /*!< bytes read from the source, all parts */
+        uint64_t messages_sent;     /*!< messages passed to the target, the rest were dropped by the hook */
+        uint64_t bytes_sent;        /*!< bytes passed to the target, after any rewrite by the hook */
+    };
+
+    /**
+     * Bidirectional proxy between two sockets, like zmqpp::proxy, but run by
+     * zmqpp so traffic can be counted, filtered and rewritten on the way.
+     *
+     * Each wakeup forwards up to a batch of messages per direction without
+     * blocking. Messages are only read from a source while its target can take
+     * them, so a slow side applies backpressure to its source alone and the
+     * other direction keeps flowing.
+     *
+     * A direction without a hook moves frames straight from one socket to the
+     * other, as zmq_proxy does. A direction with a hook reads whole messages so
+     * the hook can drop them or change them in place, frames are still moved
+     * rather than copied.
+     *
+     * As with zmq_proxy a capture socket, if set, receives a copy of every
+     * message read from either side before any hook sees it. A tagged capture
+     * also tells the sides apart, see set_capture().
+     */
+    class proxy_engine
+    {
+    public:
+        /**
+         * The two directions traffic flows in.
+         */
+        ZMQPP_COMPARABLE_ENUM direction {
+            frontend_to_backend = 0, /*!< messages read from the frontend */
+            backend_to_frontend = 1  /*!< messages read from the backend */
+        };
+
+        /**
+         * Hook type, called with each message before it is forwarded. Return false
+         * to drop the message, otherwise it is sent as the hook left it.
+         */
+        typedef inplace_function<bool (message& msg)> Hook;
+
+        /**
+         * Default most messages forwarded per direction and wakeup.
+         */
+        static const size_t default_batch_size = 256;
+
+        /**
+         * Prepare a proxy between two sockets, call run() to start it.
+         *
+         * \param frontend one side of the proxy.
+         * \param backend the other side.
+         */
+        ZMQPP_EXPORT proxy_engine(socket_t& frontend, socket_t& backend);
+
+        /**
+         * Send a copy of all traffic to a socket, which should be a PUB, DEALER,
+         * PUSH or PAIR socket. Only call it while not running.
+         *
+         * A tagged copy starts with an extra one byte frame holding the direction
+         * the message went in, as read by journal_writer::record().
+         *
+         * \param capture the socket to copy messages to.
+         * \param tagged true to prefix each copy with its direction.
+         */
+        ZMQPP_EXPORT void set_capture(socket_t& capture, bool const tagged = false);
+
+        /**
+         * Take commands on a control socket, as zmq_proxy_steerable does. PAUSE
+         * stops forwarding until RESUME, TERMINATE makes run() return and
+         * STATISTICS is answered with the counters as eight uint64_t frames, see
+         * proxy_controller. A REP control socket gets an empty answer to other
+         * commands, unknown commands are ignored. Only call it while not running.
+         *
+         * \param control a PAIR, SUB or REP socket to read commands from.
+         */
+        ZMQPP_EXPORT void set_control(socket_t& control);
+
+        /**
+         * Set the hook for one direction, replacing any previous one. Only call it
+         * while not running.
+         *
+         * \param way the direction to hook.
+         * \param hook the function called for each message, null to remove the hook.
+         */
+        ZMQPP_EXPORT void set_hook(direction const way, Hook hook);
+
+        /**
+         * Set the most messages forwarded per direction before polling again.
+         *
+         * \param messages the batch size, at least one.
+         */
+        ZMQPP_EXPORT void set_batch_size(size_t const messages);
+
+        /**
+         * Read the counters of a direction, safe to call from any thread.
+         *
+         * \param way the direction.
+         * \return a copy of the counters.
+         */
+        ZMQPP_EXPORT proxy_counters counters(direction const way) const;
+
+        /**
+         * Forward traffic until stop() is called, a TERMINATE command is received
+         * or the context is terminated.
+         * Other zmq errors are thrown as zmq_internal_exception, exceptions thrown
+         * by a hook also end the run.
+         */
+        ZMQPP_EXPORT void run();
+
+#ifndef _WIN32
+        /**
+         * Make run() return after the current batch. Safe to call from any thread.
+         * A stop requested before run() is called makes it return at once.
+         */
+        ZMQPP_EXPORT void stop();
+#endif
+
+    private:
+        struct path_t
+        {
+            path_t();
+
+            socket_t* source;
+            socket_t* target;
+            Hook hook;
+            bool blocked;
+
+            // only written by the thread calling run()
+            std::atomic<uint64_t> messages_received;
+            std::atomic<uint64_t> bytes_received;
+            std::atomic<uint64_t> messages_sent;
+            std::atomic<uint64_t> bytes_sent;
+        };
+
+        path_t paths_[2];
+        socket_t* capture_;
+        bool capture_tagged_;
+        socket_t* control_;
+        bool paused_;
+        size_t batch_size_;
+
+#ifndef _WIN32
+        event_notifier stop_notifier_;
+#endif
+
+        bool control();
+        void send_tag(path_t const& path);
+        bool forward(path_t& path);
+        bool forward_frames(path_t& path);
+        bool forward_message(path_t& path);
+
+        // No copy - private and not implemented
+        proxy_engine(proxy_engine const&) ZMQPP_EXPLICITLY_DELETED;
+        proxy_engine& operator=(proxy_engine const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <algorithm>
+#include <thread>
+#include <unordered_set>
+
+#include "exception.hpp"
+#include "rate_limiter.hpp"
+#include "socket.hpp"
+
+namespace zmqpp
+{
+
+    namespace
+    {
+        size_t bytes_of(message const& msg)
+        {
+            size_t bytes = 0;
+            for (size_t i = 0; i < msg.parts(); ++i)
+                bytes += msg.size(i);
+            return bytes;
+        }
+
+        // fewest keys worth sweeping for
+        size_t const min_sweep = 64;
+    }
+
+    token_bucket::token_bucket() :
+    rate_(0),
+    burst_(0),
+    tokens_(0),
+    refilled_()
+    {
+    }
+
+    token_bucket::token_bucket(double const rate, double const burst, clock::time_point const now) :
+    rate_(std::max(rate, 0.0)),
+    burst_((burst > 0) ? burst : rate_),
+    tokens_(burst_),
+    refilled_(now)
+    {
+    }
+
+    void token_bucket::refill(clock::time_point const now)
+    {
+        if (rate_ <= 0 || now <= refilled_)
+            return;
+
+        std::chrono::duration<double> const elapsed = now - refilled_;
+        tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+        refilled_ = now;
+    }
+
+    bool token_bucket::ready(double const amount) const
+    {
+        // more than a burst goes through once the bucket is full
+        return rate_ <= 0 || tokens_ >= std::min(amount, burst_);
+    }
+
+    std::chrono::nanoseconds token_bucket::wait_for(double const amount) const
+    {
+        if (ready(amount))
+            return std::chrono::nanoseconds::zero();
+
+        std::chrono::duration<double> const wait((std::min(amount, burst_) - tokens_) / rate_);
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(wait) + std::chrono::nanoseconds(1);
+    }
+
+    rate_limiter::rate_limiter(rate_limit const& limit) :
+    default_limit_(limit),
+    limits_(),
+    buckets_(),
+    sweep_at_(min_sweep),
+    ticked_(false),
+    now_()
+    {
+    }
+
+    void rate_limiter::set_limit(std::string const& key, rate_limit const& limit)
+    {
+        limits_[key] = limit;
+        buckets_.erase(key);
+    }
+
+    bool rate_limiter::admit(std::string const& key, size_t const bytes)
+    {
+        buckets_t& buckets = refilled(key);
+        if (!buckets.messages.ready(1) || !buckets.bytes.ready(static_cast<double>(bytes)))
+            return false;
+
+        buckets.messages.take(1);
+        buckets.bytes.take(static_cast<double>(bytes));
+        return true;
+    }
+
+    std::chrono::nanoseconds rate_limiter::delay(std::string const& key, size_t const bytes)
+    {
+        buckets_t& buckets = refilled(key);
+        return std::max(buckets.messages.wait_for(1), buckets.bytes.wait_for(static_cast<double>(bytes)));
+    }
+
+    void rate_limiter::wait(std::string const& key, size_t const bytes)
+    {
+        while (!admit(key, bytes))
+        {
+            std::this_thread::sleep_for(delay(key, bytes));
+
+            // nothing ticks while this thread sleeps
+            if (ticked_)
+                now_ = clock::now();
+        }
+    }
+
+    void rate_limiter::forget(std::string const& key)
+    {
+        buckets_.erase(key);
+    }
+
+    void rate_limiter::tick()
+    {
+        tick(clock::now());
+    }
+
+    void rate_limiter::tick(clock::time_point const now)
+    {
+        ticked_ = true;
+        now_ = now;
+    }
+
+    loop::timer_id_t rate_limiter::attach(loop& events, std::chrono::microseconds const interval)
+    {
+        tick();
+        return events.add(interval, 0, [this]() -> bool {
+            tick();
+            return true;
+        });
+    }
+
+#if (ZMQ_VERSION_MAJOR > 3) || ((ZMQ_VERSION_MAJOR == 3) && (ZMQ_VERSION_MINOR >= 2))
+    proxy_engine::Hook rate_limiter::hook(overflow_policy const policy, bool const per_route)
+    {
+        if (overflow_policy::queue == policy)
+        {
+            throw exception("a proxy hook can only block or drop messages over their limit");
+        }
+
+        return [this, policy, per_route](message& msg) -> bool {
+            std::string const key = (per_route && msg.parts() > 1) ? msg.get(0) : std::string();
+            size_t const bytes = bytes_of(msg);
+
+            if (overflow_policy::drop == policy)
+                return admit(key, bytes);
+
+            wait(key, bytes);
+            return true;
+        };
+    }
+#endif
+
+    rate_limiter::buckets_t& rate_limiter::refilled(std::string const& key)
+    {
+        clock::time_point const now = ticked_ ? now_ : clock::now();
+
+        auto found = buckets_.find(key);
+        if (buckets_.end() == found)
+        {
+            if (buckets_.size() >= sweep_at_)
+                sweep(now);
+
+            auto const limit = limits_.find(key);
+            rate_limit const& chosen = (limits_.end() == limit) ? default_limit_ : limit->second;
+
+            buckets_t buckets;
+            buckets.messages = token_bucket(chosen.messages_per_second, chosen.message_burst, now);
+            buckets.bytes = token_bucket(chosen.bytes_per_second, chosen.byte_burst, now);
+            found = buckets_.emplace(key, buckets).first;
+        }
+
+        found->second.messages.refill(now);
+        found->second.bytes.refill(now);
+        return found->second;
+    }
+
+    void rate_limiter::sweep(clock::time_point const now)
+    {
+        for (auto it = buckets_.begin(); it != buckets_.end();)
+        {
+            it->second.messages.refill(now);
+            it->second.bytes.refill(now);
+            if (it->second.messages.full() && it->second.bytes.full())
+                it = buckets_.erase(it);
+            else
+                ++it;
+        }
+
+        // waiting for the keys left to double keeps sweeps to a constant cost per key
+        sweep_at_ = std::max(min_sweep, 2 * buckets_.size());
+    }
+
+    shaped_socket::shaped_socket(socket_t& socket, rate_limiter& limiter, overflow_policy const policy, size_t const max_queued /* = 1000 */) :
+    socket_(socket),
+    limiter_(limiter),
+    policy_(policy),
+    max_queued_(max_queued),
+    queue_(),
+    queued_keys_()
+    {
+    }
+
+    bool shaped_socket::send(message& msg)
+    {
+        return send(msg, std::string());
+    }
+
+    bool shaped_socket::send(message& msg, std::string const& key)
+    {
+        size_t const bytes = bytes_of(msg);
+
+        // a key with messages waiting sends after them
+        bool const behind = (queued_keys_.end() != queued_keys_.find(key));
+        if (!behind && limiter_.admit(key, bytes))
+            return socket_.send(msg);
+
+        switch (policy_)
+        {
+        case overflow_policy::drop:
+            return false;
+
+        case overflow_policy::block:
+            limiter_.wait(key, bytes);
+            return socket_.send(msg);
+
+        case overflow_policy::queue:
+            break;
+        }
+
+        if (queue_.size() >= max_queued_)
+            return false;
+
+        queue_.push_back(pending_t());
+        queue_.back().key = key;
+        queue_.back().msg = std::move(msg);
+        queue_.back().bytes = bytes;
+        ++queued_keys_[key];
+        return true;
+    }
+
+    size_t shaped_socket::flush()
+    {
+        size_t sent = 0;
+        std::unordered_set<std::string> held;
+
+        for (auto it = queue_.begin(); it != queue_.end();)
+        {
+            if (held.end() != held.find(it->key) || !limiter_.admit(it->key, it->bytes))
+            {
+                // later messages with this key wait for this one
+                held.insert(it->key);
+                ++it;
+                continue;
+            }
+
+            socket_.send(it->msg);
+            ++sent;
+
+            auto const count = queued_keys_.find(it->key);
+            if (0 == --count->second)
+                queued_keys_.erase(count);
+            it = queue_.erase(it);
+        }
+        return sent;
+    }
+
+    std::chrono::nanoseconds shaped_socket::next_flush()
+    {
+        if (queue_.empty())
+            return std::chrono::nanoseconds::zero();
+
+        // only the first message of each key can go next
+        std::unordered_set<std::string> seen;
+        std::chrono::nanoseconds soonest = std::chrono::nanoseconds::max();
+        for (pending_t const& pending : queue_)
+        {
+            if (!seen.insert(pending.key).second)
+                continue;
+            soonest = std::min(soonest, limiter_.delay(pending.key, pending.bytes));
+        }
+        return soonest;
+    }
+
+}
@@ -0,0 +1,296 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "compatibility.hpp"
+#include "loop.hpp"
+#include "message.hpp"
+#include "proxy_engine.hpp"
+
+namespace zmqpp
+{
+    class socket;
+    typedef socket socket_t;
+
+    /**
+     * A rate with a burst allowance, for messages and for bytes. A zero rate
+     * leaves that dimension unlimited, a zero burst allows one second's worth.
+     */
+    struct rate_limit
+    {
+        double messages_per_second;
+        double message_burst;
+        double bytes_per_second;
+        double byte_burst;
+    };
+
+    /**
+     * What to do with a message that is over its limit.
+     */
+    ZMQPP_COMPARABLE_ENUM overflow_policy {
+        block, /*!< wait until the limit allows it */
+        drop,  /*!< discard it */
+        queue  /*!< hold it back and send it once the limit allows */
+    };
+
+    /**
+     * A token bucket: it fills at a fixed rate up to its burst size and each
+     * unit sent takes a token.
+     *
+     * A request larger than the burst is let through once the bucket is full,
+     * leaving it in debt, so oversized messages are slowed rather than stuck.
+     */
+    class token_bucket
+    {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        /**
+         * An unlimited bucket.
+         */
+        ZMQPP_EXPORT token_bucket();
+
+        /**
+         * A full bucket.
+         *
+         * \param rate tokens added per second, zero for unlimited.
+         * \param burst most tokens held, zero for one second's worth.
+         * \param now the time to count refills from.
+         */
+        ZMQPP_EXPORT token_bucket(double const rate, double const burst, clock::time_point const now);
+
+        /**
+         * Add the tokens earned since the last refill.
+         */
+        ZMQPP_EXPORT void refill(clock::time_point const now);
+
+        /**
+         * \return true if there are enough tokens for the amount.
+         */
+        ZMQPP_EXPORT bool ready(double const amount) const;
+
+        /**
+         * Take tokens, whether or not there are enough.
+         */
+        void take(double const amount) { if (rate_ > 0) tokens_ -= amount; }
+
+        /**
+         * \return how long until there are enough tokens for the amount.
+         */
+        ZMQPP_EXPORT std::chrono::nanoseconds wait_for(double const amount) const;
+
+        /**
+         * \return true if the bucket is as full as a new one, as of its last refill.
+         */
+        bool full() const { return rate_ <= 0 || tokens_ >= burst_; }
+
+    private:
+        double rate_;
+        double burst_;
+        double tokens_;
+        clock::time_point refilled_;
+    };
+
+    /**
+     * Rate limits keyed by a string, such as a peer's identity, with "" for
+     * everything sent on a socket.
+     *
+     * Each key gets its own buckets the first time it is seen, with the limit
+     * set for that key or the default one. Buckets are refilled as they are
+     * used, from a time read once per check or, after tick() has been called,
+     * only from the time given to tick(). Ticking from a loop timer with
+     * attach() keeps clock reads off the per message path altogether.
+     *
+     * A key whose buckets have filled back up is no different from a new one,
+     * so such keys are dropped whenever the number of keys has doubled since
+     * the last sweep. Keys that come and go, such as the identities a ROUTER
+     * gives its peers, don't pile up. forget() drops a key at once.
+     * A limiter belongs to one thread, like the sockets it shapes.
+     */
+    class rate_limiter
+    {
+    public:
+        typedef token_bucket::clock clock;
+
+        /**
+         * \param limit the limit for keys without one of their own.
+         */
+        ZMQPP_EXPORT explicit rate_limiter(rate_limit const& limit);
+
+        /**
+         * Give a key its own limit, starting with full buckets.
+         */
+        ZMQPP_EXPORT void set_limit(std::string const& key, rate_limit const& limit);
+
+        /**
+         * Take the tokens for a message if its key's limits allow it now.
+         *
+         * \param key the bucket key.
+         * \param bytes the size of the message.
+         * \return true if the message may be sent.
+         */
+        ZMQPP_EXPORT bool admit(std::string const& key, size_t const bytes);
+
+        /**
+         * \return how long until a message would be admitted, zero if it would now.
+         */
+        ZMQPP_EXPORT std::chrono::nanoseconds delay(std::string const& key, size_t const bytes);
+
+        /**
+         * Block until a message is admitted, then take its tokens.
+         *
+         * \param key the bucket key.
+         * \param bytes the size of the message.
+         */
+        ZMQPP_EXPORT void wait(std::string const& key, size_t const bytes);
+
+        /**
+         * Drop a key's buckets, it starts full if seen again.
+         */
+        ZMQPP_EXPORT void forget(std::string const& key);
+
+        /**
+         * \return the number of keys with buckets, including full ones not yet swept.
+         */
+        size_t keys() const { return buckets_.size(); }
+
+        /**
+         * Use the current time for refills until the next tick.
+         */
+        ZMQPP_EXPORT void tick();
+
+        /**
+         * Use a given time for refills until the next tick.
+         */
+        ZMQPP_EXPORT void tick(clock::time_point const now);
+
+        /**
+         * Tick from a timer on a loop, which must run on the limiter's thread.
+         *
+         * \param events the loop to add the timer to.
+         * \param interval time between ticks, the resolution of refills.
+         * \return the timer, to remove it from the loop.
+         */
+        ZMQPP_EXPORT loop::timer_id_t attach(loop& events, std::chrono::microseconds const interval);
+
+#if (ZMQ_VERSION_MAJOR > 3) || ((ZMQ_VERSION_MAJOR == 3) && (ZMQ_VERSION_MINOR >= 2))
+        /**
+         * Make a proxy_engine hook that limits the traffic of one direction.
+         *
+         * Per route limits key each message by its first frame, the routing
+         * identity when the source is a ROUTER. A blocking hook holds up the
+         * whole proxy, which pushes back on every sender. Queueing is not possible
+         * in a hook, drop or block.
+         *
+         * \param policy block or drop.
+         * \param per_route true to key by the first frame, false for one limit.
+         * \return the hook, the limiter must outlive it.
+         */
+        ZMQPP_EXPORT proxy_engine::Hook hook(overflow_policy const policy, bool const per_route);
+#endif
+
+    private:
+        struct buckets_t
+        {
+            token_bucket messages;
+            token_bucket bytes;
+        };
+
+        rate_limit default_limit_;
+        std::unordered_map<std::string, rate_limit> limits_;
+        std::unordered_map<std::string, buckets_t> buckets_;
+        size_t sweep_at_;
+        bool ticked_;
+        clock::time_point now_;
+
+        buckets_t& refilled(std::string const& key);
+        void sweep(clock::time_point const now);
+    };
+
+    /**
+     * Shapes what is sent on a socket with a rate_limiter, blocking, dropping
+     * or queueing messages over their limit.
+     *
+     * Queued messages are sent by flush(), which a loop timer or the socket
+     * becoming writable should call. Messages with the same key are sent in
+     * order, one key over its limit doesn't hold up the others.
+     */
+    class shaped_socket
+    {
+    public:
+        /**
+         * \param socket the socket to send on, it must outlive the shaper.
+         * \param limiter the limits to apply, it must outlive the shaper.
+         * \param policy what to do with messages over their limit.
+         * \param max_queued most messages held back when queueing, more are dropped.
+         */
+        ZMQPP_EXPORT shaped_socket(socket_t& socket, rate_limiter& limiter, overflow_policy const policy, size_t const max_queued = 1000);
+
+        /**
+         * Send a message under the socket wide limit, keyed "".
+         *
+         * \param msg the message, moved from if it is sent or queued.
+         * \return true if it was sent or queued, false if it was dropped.
+         */
+        ZMQPP_EXPORT bool send(message& msg);
+
+        /**
+         * Send a message under a key's limit.
+         *
+         * \param msg the message, moved from if it is sent or queued.
+         * \param key the bucket key, such as the peer's identity.
+         * \return true if it was sent or queued, false if it was dropped.
+         */
+        ZMQPP_EXPORT bool send(message& msg, std::string const& key);
+
+        /**
+         * Send the queued messages the limits now allow.
+         *
+         * \return the number of messages sent.
+         */
+        ZMQPP_EXPORT size_t flush();
+
+        /**
+         * \return the number of messages held back.
+         */
+        size_t queued() const { return queue_.size(); }
+
+        /**
+         * \return how long until a queued message could be sent, zero if there
+         *         are none or one could be sent now.
+         */
+        ZMQPP_EXPORT std::chrono::nanoseconds next_flush();
+
+    private:
+        struct pending_t
+        {
+            std::string key;
+            message msg;
+            size_t bytes;
+        };
+
+        socket_t& socket_;
+        rate_limiter& limiter_;
+        overflow_policy policy_;
+        size_t max_queued_;
+        std::list<pending_t> queue_;
+        std::unordered_map<std::string, size_t> queued_keys_;
+
+        // No copy - private and not implemented
+        shaped_socket(shaped_socket const&) ZMQPP_EXPLICITLY_DELETED;
+        shaped_socket& operator=(shaped_socket const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
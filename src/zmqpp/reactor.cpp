@@ -22,7 +22,9 @@ namespace zmqpp
 {
 
     reactor::reactor() :
-    dispatching_(false)
+    dispatching_(false),
+    budget_exhausted_(false),
+    next_first_(0)
     {
 
     }
@@ -31,23 +33,52 @@ namespace zmqpp
     {
     }
 
-    void reactor::add(socket& socket, Callable callable, short const event /* = POLL_IN */)
+    void reactor::add(socket& socket, Callable callable, short const event /* = POLL_IN */, dispatch_budget const& budget /* = dispatch_budget() */)
     {
         zmq_pollitem_t item{static_cast<void *> (socket), 0, event, 0};
-        add(item, callable);
+        add(item, std::move(callable), budget);
     }
 
-    void reactor::add(raw_socket_t const descriptor, Callable callable, short const event /* = POLL_IN */)
+    void reactor::add(raw_socket_t const descriptor, Callable callable, short const event /* = POLL_IN */, dispatch_budget const& budget /* = dispatch_budget() */)
     {
         zmq_pollitem_t item{nullptr, descriptor, event, 0};
-        add(item, callable);
+        add(item, std::move(callable), budget);
     }
 
-    void reactor::add(const zmq_pollitem_t& item, Callable callable)
+    void reactor::add(const zmq_pollitem_t& item, Callable callable, dispatch_budget const& budget /* = dispatch_budget() */)
     {
+        // adding a socket again replaces its handler
+        if (nullptr != item.socket)
+        {
+            auto found = socket_slots_.find(item.socket);
+            if (socket_slots_.end() != found)
+                release(found->second);
+        }
+        else
+        {
+            auto found = fd_slots_.find(item.fd);
+            if (fd_slots_.end() != found)
+                release(found->second);
+        }
+        poller_.remove(item);
         poller_.add(item);
 
-        items_.push_back(std::make_pair(item, callable));
+        size_t slot = items_.size();
+        if (free_slots_.empty())
+        {
+            items_.push_back(registration_t{item, std::move(callable), budget, true});
+        }
+        else
+        {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+            items_[slot] = registration_t{item, std::move(callable), budget, true};
+        }
+
+        if (nullptr != item.socket)
+            socket_slots_[item.socket] = slot;
+        else
+            fd_slots_[item.fd] = slot;
     }
 
     bool reactor::has(socket_t const& socket)
@@ -62,40 +93,36 @@ namespace zmqpp
 
     void reactor::remove(socket_t const& socket)
     {
-        if (dispatching_)
+        auto found = socket_slots_.find(static_cast<void *> (socket));
+        if (socket_slots_.end() != found)
         {
-            sockRemoveLater_.push_back(&socket);
-            return;
+            release(found->second);
+            socket_slots_.erase(found);
         }
-        items_.erase(std::remove_if(items_.begin(), items_.end(), [&socket](const PollItemCallablePair & pair) -> bool
-        {
-            const zmq_pollitem_t &item = pair.first;
-            if (nullptr != item.socket && item.socket == static_cast<void *> (socket))
-            {
-                return true;
-            }
-            return false;
-        }), items_.end());
         poller_.remove(socket);
     }
 
     void reactor::remove(raw_socket_t const descriptor)
     {
+        auto found = fd_slots_.find(descriptor);
+        if (fd_slots_.end() != found)
+        {
+            release(found->second);
+            fd_slots_.erase(found);
+        }
+        poller_.remove(descriptor);
+    }
+
+    void reactor::release(size_t const slot)
+    {
+        items_[slot].live = false;
         if (dispatching_)
         {
-            fdRemoveLater_.push_back(descriptor);
+            released_slots_.push_back(slot);
             return;
         }
-        items_.erase(std::remove_if(items_.begin(), items_.end(), [descriptor](const PollItemCallablePair & pair) -> bool
-        {
-            const zmq_pollitem_t &item = pair.first;
-            if (nullptr == item.socket && item.fd == descriptor)
-            {
-                return true;
-            }
-            return false;
-        }), items_.end());
-        poller_.remove(descriptor);
+        items_[slot].callable = nullptr;
+        free_slots_.push_back(slot);
     }
 
     void reactor::check_for(socket const& socket, short const event)
@@ -110,15 +137,26 @@ namespace zmqpp
 
     bool reactor::poll(long timeout /* = WAIT_FOREVER */)
     {
+        // a handler stopped by its budget is still ready, so don't wait for anything else
+        if (budget_exhausted_)
+            timeout = 0;
+        budget_exhausted_ = false;
+
         if (poller_.poll(timeout))
         {
             dispatching_ = true;
-            for (const PollItemCallablePair &pair : items_)
+            // rotate the first registration served so one busy socket can't always go first
+            size_t const count = items_.size();
+            size_t const first = (count > 0) ? next_first_++ % count : 0;
+            for (size_t i = 0; i < count; ++i)
             {
-                const zmq_pollitem_t &pollitem = pair.first;
+                size_t const index = (first + i) % count;
+                if (!items_[index].live)
+                    continue;
+                const zmq_pollitem_t &pollitem = items_[index].item;
 
                 if (poller_.has_input(pollitem) || poller_.has_error(pollitem) || poller_.has_output(pollitem))
-                    pair.second();
+                    dispatch(index);
             }
             dispatching_ = false;
             flush_remove_later();
@@ -127,6 +165,36 @@ namespace zmqpp
         return false;
     }
 
+    void reactor::dispatch(size_t const index)
+    {
+        // copy the budget and item, the handler may add or remove registrations
+        dispatch_budget const budget = items_[index].budget;
+        zmq_pollitem_t const pollitem = items_[index].item;
+        bool const timed = budget.time > std::chrono::microseconds::zero();
+        std::chrono::steady_clock::time_point const start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+        size_t calls = 0;
+        for (;;)
+        {
+            items_[index].callable();
+            ++calls;
+
+            bool const spent = (budget.calls > 0 && calls >= budget.calls) ||
+                (timed && std::chrono::steady_clock::now() - start >= budget.time);
+
+            // the default single call budget leaves it to the next poll, as it always has
+            if (1 == budget.calls || !items_[index].live)
+                return;
+            if (0 == poller::current_events(pollitem))
+                return;
+            if (spent)
+            {
+                budget_exhausted_ = true;
+                return;
+            }
+        }
+    }
+
     short reactor::events(socket const& socket) const
     {
         return poller_.events(socket);
@@ -149,12 +217,12 @@ namespace zmqpp
 
     void reactor::flush_remove_later()
     {
-        for (raw_socket_t fd : fdRemoveLater_)
-            remove(fd);
-        for (const socket_t *sock : sockRemoveLater_)
-            remove(*sock);
-        fdRemoveLater_.clear();
-        sockRemoveLater_.clear();
+        for (size_t const slot : released_slots_)
+        {
+            items_[slot].callable = nullptr;
+            free_slots_.push_back(slot);
+        }
+        released_slots_.clear();
     }
 
 }
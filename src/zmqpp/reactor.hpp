@@ -10,12 +10,15 @@
 #pragma once
 
 #include <unordered_map>
+#include <deque>
 #include <vector>
 #include <map>
 #include <functional>
 
 #include "compatibility.hpp"
 #include "poller.hpp"
+#include "dispatch_budget.hpp"
+#include "inplace_function.hpp"
 
 namespace zmqpp
 {
@@ -32,7 +35,10 @@ namespace zmqpp
     class ZMQPP_EXPORT reactor
     {
     public:
-        typedef std::function<void (void) > Callable;
+        /**
+         * Handler type, captures of up to 64 bytes are held without allocating.
+         */
+        typedef inplace_function<void (void) > Callable;
         typedef std::pair<zmq_pollitem_t, Callable> PollItemCallablePair;
         /**
          * Construct an empty polling model.
@@ -49,11 +55,14 @@ namespace zmqpp
         /**
          * Add a socket to the reactor, providing a handler that will be called when the monitored events occur.
          *
+         * Adding a socket that is already monitored replaces its handler.
+         *
          * \param socket the socket to monitor.
          * \param callable the function that will be called by the reactor when a registered event occurs on socket.
          * \param event the event flags to monitor on the socket.
+         * \param budget how many times, or for how long, the handler may be called per poll.
          */
-        void add(socket_t& socket, Callable callable, short const event = poller::poll_in);
+        void add(socket_t& socket, Callable callable, short const event = poller::poll_in, dispatch_budget const& budget = dispatch_budget());
 
         /*!
          * Add a standard socket to the reactor, providing a handler that will be called when the monitored events occur.
@@ -61,8 +70,9 @@ namespace zmqpp
          * \param descriptor the standard socket to monitor (SOCKET under Windows, a file descriptor otherwise).
          * \param callable the function that will be called by the reactor when a registered event occurs on fd.
          * \param event the event flags to monitor.
+         * \param budget how many times, or for how long, the handler may be called per poll.
          */
-        void add(raw_socket_t const descriptor, Callable callable, short const event = poller::poll_in | poller::poll_error);
+        void add(raw_socket_t const descriptor, Callable callable, short const event = poller::poll_in | poller::poll_error, dispatch_budget const& budget = dispatch_budget());
 
         /**
          * Check if we are monitoring a given socket with this reactor.
@@ -83,6 +93,9 @@ namespace zmqpp
         /**
          * Stop monitoring a socket.
          *
+         * Takes constant time and may be called from a handler, a removed socket's
+         * handler is not called again even if it was ready in the same wakeup.
+         *
          * \param socket the socket to stop monitoring.
          */
         void remove(socket_t const& socket);
@@ -118,6 +131,9 @@ namespace zmqpp
          *
          * If a timeout is set and was reached then this function returns false.
          *
+         * If the previous call stopped a handler on its budget while the socket was
+         * still ready the timeout is ignored and the poll does not block.
+         *
          * \param timeout milliseconds to timeout.
          * \return true if there is an event..
          */
@@ -153,21 +169,44 @@ namespace zmqpp
         const poller &get_poller() const;
 
     protected:
-        void add(const zmq_pollitem_t &item, Callable callable);
+        void add(const zmq_pollitem_t &item, Callable callable, dispatch_budget const& budget = dispatch_budget());
 
     private:
-        std::vector<PollItemCallablePair> items_;
-        std::vector<const socket_t *> sockRemoveLater_;
-        std::vector<raw_socket_t> fdRemoveLater_;
-      
+        struct registration_t {
+            zmq_pollitem_t item;
+            Callable callable;
+            dispatch_budget budget;
+            bool live;
+        };
+
+        // a deque so handlers adding registrations don't move the one being called,
+        // removed registrations are left as tombstones until their slot is reused
+        std::deque<registration_t> items_;
+        std::unordered_map<void *, size_t> socket_slots_;
+        std::unordered_map<raw_socket_t, size_t> fd_slots_;
+        std::vector<size_t> free_slots_;
+        std::vector<size_t> released_slots_;
+
       /**
-       * Flush the fdRemoveLater_ and sockRemoveLater_ vector, effectively removing
-       * the item for the reactor and poller.
+       * Tombstone a registration, its handler is kept alive until dispatch is over.
+       */
+      void release(size_t const slot);
+
+      /**
+       * Make the slots released while dispatching available for reuse.
        */
       void flush_remove_later();
 
+      /**
+       * Call a ready registration's handler until it is no longer ready or its budget
+       * is spent.
+       */
+      void dispatch(size_t const index);
+
       poller poller_;
       bool dispatching_;
+      bool budget_exhausted_;
+      size_t next_first_;
     };
 
 }
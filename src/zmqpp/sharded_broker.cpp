@@ -0,0 +1,320 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <deque>
+#include <functional>
+
+#include "exception.hpp"
+#include "message.hpp"
+#include "poller.hpp"
+#include "sharded_broker.hpp"
+
+#ifndef _WIN32
+
+namespace zmqpp
+{
+
+    namespace
+    {
+        // shard pipes share the caller's context, the prefix keeps them apart
+        // from its other inproc endpoints and the counter apart from each other
+        std::atomic<uint64_t> next_broker_id(0);
+
+        // most messages moved from one socket before polling the others again
+        size_t const batch_size = 256;
+
+        bool terminated(zmq_internal_exception const& e)
+        {
+            return ETERM == e.zmq_error();
+        }
+    }
+
+    char const* const sharded_broker::ready = "READY";
+
+    sharded_broker::shard_t::shard_t(context_t const& context, std::string const& endpoint, std::string const& pipe) :
+    front_pipe(context, socket_type::pair),
+    shard_pipe(context, socket_type::pair),
+    backend(context, socket_type::router),
+    stop_notifier(),
+    thread(),
+    error()
+    {
+        backend.bind(endpoint);
+        front_pipe.bind(pipe);
+        shard_pipe.connect(pipe);
+    }
+
+    sharded_broker::sharded_broker(context_t const& context, std::string const& frontend, std::vector<std::string> const& backends) :
+    frontend_(context, socket_type::router),
+    shards_(),
+    stop_notifier_(),
+    thread_(),
+    error_()
+    {
+        if (backends.empty())
+        {
+            throw exception("sharded broker needs at least one backend");
+        }
+
+        std::string const prefix = "inproc://zmqpp::sharded_broker-" +
+            std::to_string(next_broker_id.fetch_add(1, std::memory_order_relaxed)) + "-";
+
+        // everything is bound before any thread starts, so bind errors reach the caller
+        frontend_.bind(frontend);
+        for (size_t i = 0; i < backends.size(); ++i)
+        {
+            shards_.emplace_back(new shard_t(context, backends[i], prefix + std::to_string(i)));
+        }
+
+        try
+        {
+            for (std::unique_ptr<shard_t> const& shard : shards_)
+            {
+                shard->thread = std::thread(&sharded_broker::run_shard, this, std::ref(*shard));
+            }
+            thread_ = std::thread(&sharded_broker::run_frontend, this);
+        }
+        catch (...)
+        {
+            try { stop(); } catch (...) { }
+            throw;
+        }
+    }
+
+    sharded_broker::~sharded_broker()
+    {
+        try
+        {
+            stop();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    size_t sharded_broker::size() const
+    {
+        return shards_.size();
+    }
+
+    size_t sharded_broker::shard_for(std::string const& identity) const
+    {
+        return std::hash<std::string>()(identity) % shards_.size();
+    }
+
+    void sharded_broker::stop()
+    {
+        if (thread_.joinable())
+        {
+            stop_notifier_.notify();
+        }
+        for (std::unique_ptr<shard_t> const& shard : shards_)
+        {
+            if (shard->thread.joinable())
+            {
+                shard->stop_notifier.notify();
+            }
+        }
+
+        std::exception_ptr error;
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+        std::swap(error, error_);
+
+        for (std::unique_ptr<shard_t> const& shard : shards_)
+        {
+            if (shard->thread.joinable())
+            {
+                shard->thread.join();
+            }
+            if (!error && shard->error)
+            {
+                error = shard->error;
+            }
+            shard->error = nullptr;
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void sharded_broker::run_frontend()
+    {
+        try
+        {
+            poller poller;
+            poller.add(frontend_, poller::poll_in);
+            for (std::unique_ptr<shard_t> const& shard : shards_)
+            {
+                poller.add(shard->front_pipe, poller::poll_in);
+            }
+            poller.add(stop_notifier_.fd(), poller::poll_in);
+
+            // a request its shard had no room for, new requests wait until it is sent
+            message held;
+            size_t held_shard = 0;
+            bool holding = false;
+
+            message msg;
+            for(;;)
+            {
+                poller.check_for(frontend_, holding ? 0 : poller::poll_in);
+                if (holding)
+                {
+                    poller.check_for(shards_[held_shard]->front_pipe, poller::poll_in | poller::poll_out);
+                }
+
+                poller.poll();
+
+                if (poller.has_input(stop_notifier_.fd()))
+                {
+                    stop_notifier_.consume();
+                    return;
+                }
+
+                // replies first, sends to a router never block
+                for (std::unique_ptr<shard_t> const& shard : shards_)
+                {
+                    if (!poller.has_input(shard->front_pipe))
+                        continue;
+
+                    for (size_t i = 0; i < batch_size && shard->front_pipe.receive(msg, true); ++i)
+                    {
+                        frontend_.send(msg);
+                    }
+                }
+
+                if (holding && poller.has_output(shards_[held_shard]->front_pipe))
+                {
+                    if (shards_[held_shard]->front_pipe.send(held, true))
+                    {
+                        poller.check_for(shards_[held_shard]->front_pipe, poller::poll_in);
+                        holding = false;
+                    }
+                }
+
+                if (holding || !poller.has_input(frontend_))
+                    continue;
+
+                for (size_t i = 0; i < batch_size && frontend_.receive(msg, true); ++i)
+                {
+                    size_t const shard = shard_for(msg.get(0));
+                    if (!shards_[shard]->front_pipe.send(msg, true))
+                    {
+                        held = std::move(msg);
+                        held_shard = shard;
+                        holding = true;
+                        break;
+                    }
+                }
+            }
+        }
+        catch (zmq_internal_exception const& e)
+        {
+            if (!terminated(e))
+                error_ = std::current_exception();
+        }
+        catch (...)
+        {
+            error_ = std::current_exception();
+        }
+    }
+
+    void sharded_broker::run_shard(shard_t& shard)
+    {
+        try
+        {
+            poller poller;
+            poller.add(shard.backend, poller::poll_in);
+            poller.add(shard.shard_pipe, 0);
+            poller.add(shard.stop_notifier.fd(), poller::poll_in);
+
+            // ready workers, least recently used first
+            std::deque<std::string> workers;
+
+            // a reply the frontend had no room for, the backend isn't read until it is sent
+            message held;
+            bool holding = false;
+
+            message msg;
+            for(;;)
+            {
+                // requests stay queued in the pipe until a worker can take them
+                poller.check_for(shard.backend, holding ? 0 : poller::poll_in);
+                poller.check_for(shard.shard_pipe, (workers.empty() ? 0 : poller::poll_in) | (holding ? poller::poll_out : 0));
+
+                poller.poll();
+
+                if (poller.has_input(shard.stop_notifier.fd()))
+                {
+                    shard.stop_notifier.consume();
+                    return;
+                }
+
+                if (holding && poller.has_output(shard.shard_pipe))
+                {
+                    holding = !shard.shard_pipe.send(held, true);
+                }
+
+                if (!holding && poller.has_input(shard.backend))
+                {
+                    for (size_t i = 0; i < batch_size && shard.backend.receive(msg, true); ++i)
+                    {
+                        // [worker, "", payload...] where the payload is a reply or READY
+                        if (msg.parts() < 3)
+                            continue;
+
+                        workers.push_back(msg.get(0));
+                        msg.pop_front();
+                        msg.pop_front();
+
+                        if (1 == msg.parts() && msg.get(0) == ready)
+                            continue;
+
+                        if (!shard.shard_pipe.send(msg, true))
+                        {
+                            held = std::move(msg);
+                            holding = true;
+                            break;
+                        }
+                    }
+                }
+
+                if (!poller.has_input(shard.shard_pipe))
+                    continue;
+
+                for (size_t i = 0; i < batch_size && !workers.empty() && shard.shard_pipe.receive(msg, true); ++i)
+                {
+                    msg.push_front("");
+                    msg.push_front(workers.front());
+                    workers.pop_front();
+                    shard.backend.send(msg);
+                }
+            }
+        }
+        catch (zmq_internal_exception const& e)
+        {
+            if (!terminated(e))
+                shard.error = std::current_exception();
+        }
+        catch (...)
+        {
+            shard.error = std::current_exception();
+        }
+    }
+
+}
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "compatibility.hpp"
+#include "socket.hpp"
+
+#ifndef _WIN32
+
+#include "event_notifier.hpp"
+
+namespace zmqpp
+{
+    class context;
+    typedef context context_t;
+
+    /**
+     * Load balancing request broker spread over several threads.
+     *
+     * Clients send requests to a frontend ROUTER, REQ or DEALER with an empty
+     * delimiter frame. Workers connect REQ sockets to one of the shards' backend
+     * ROUTERs, announce themselves with a single "READY" frame, then receive
+     * requests as [client identity, empty, request...] and send back replies in
+     * the same form. This is the load balancing broker pattern, each shard hands
+     * a request to its least recently used ready worker.
+     *
+     * A client's identity is hashed to pick its shard, so all the requests of a
+     * client go through the same shard and its workers. Give clients a fixed
+     * identity to keep that across reconnections.
+     *
+     * zmq sockets belong to one thread, so the frontend is served by one thread
+     * that only moves messages between the frontend and the shards. Each shard
+     * runs on its own thread with its own backend, worker tracking and queueing,
+     * so that work grows with the number of shards. A shard with no ready worker
+     * leaves requests queued on its pipe, and once that is full the frontend
+     * stops reading new requests until the shard catches up.
+     */
+    class sharded_broker
+    {
+    public:
+        /**
+         * The message a worker sends to announce it is ready.
+         */
+        static char const* const ready;
+
+        /**
+         * Bind the sockets and start the threads, one shard per backend endpoint.
+         *
+         * \param context the context to create sockets with, it must outlive the broker.
+         * \param frontend endpoint to bind for clients.
+         * \param backends endpoints to bind for workers, one per shard.
+         */
+        ZMQPP_EXPORT sharded_broker(context_t const& context, std::string const& frontend, std::vector<std::string> const& backends);
+
+        /**
+         * Stop the threads and close the sockets. Errors are dropped, call stop()
+         * first to see them.
+         */
+        ZMQPP_EXPORT ~sharded_broker();
+
+        /**
+         * \return the number of shards.
+         */
+        ZMQPP_EXPORT size_t size() const;
+
+        /**
+         * \param identity a client identity.
+         * \return index of the shard serving the client.
+         */
+        ZMQPP_EXPORT size_t shard_for(std::string const& identity) const;
+
+        /**
+         * Stop the threads and wait for them. If a thread failed, the first error
+         * is rethrown once all have ended. Calling stop again does nothing.
+         */
+        ZMQPP_EXPORT void stop();
+
+    private:
+        struct shard_t
+        {
+            shard_t(context_t const& context, std::string const& endpoint, std::string const& pipe);
+
+            socket front_pipe;
+            socket shard_pipe;
+            socket backend;
+            event_notifier stop_notifier;
+            std::thread thread;
+            std::exception_ptr error;
+        };
+
+        socket frontend_;
+        std::vector<std::unique_ptr<shard_t>> shards_;
+        event_notifier stop_notifier_;
+        std::thread thread_;
+        std::exception_ptr error_;
+
+        void run_frontend();
+        void run_shard(shard_t& shard);
+
+        // No copy - private and not implemented
+        sharded_broker(sharded_broker const&) ZMQPP_EXPLICITLY_DELETED;
+        sharded_broker& operator=(sharded_broker const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+}
+
+#endif
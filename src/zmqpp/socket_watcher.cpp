@@ -0,0 +1,186 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include "exception.hpp"
+#include "socket.hpp"
+#include "socket_watcher.hpp"
+
+#include <zmq.h>
+
+#ifdef ZMQPP_HAVE_EPOLL
+#include <algorithm>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+namespace zmqpp
+{
+
+    socket_watcher::socket_watcher(socket_t& socket, Callable callable, short const events /* = poller::poll_in */, size_t const budget /* = 0 */) :
+    socket_(socket),
+    callable_(std::move(callable)),
+    events_(events),
+    budget_(budget),
+    fd_()
+    {
+        size_t size = sizeof(fd_);
+        if (0 != zmq_getsockopt(static_cast<void *> (socket_), ZMQ_FD, &fd_, &size))
+        {
+            throw zmq_internal_exception();
+        }
+    }
+
+    short socket_watcher::pending() const
+    {
+        zmq_pollitem_t const item{static_cast<void *> (socket_), 0, events_, 0};
+        return poller::current_events(item);
+    }
+
+    bool socket_watcher::on_readable()
+    {
+        size_t calls = 0;
+        for (;;)
+        {
+            // checked after every call, the descriptor won't fire again for work that
+            // was already queued when it was read
+            short const ready = pending();
+            if (poller::poll_none == ready)
+                return false;
+            if (budget_ > 0 && calls >= budget_)
+                return true;
+
+            callable_(ready);
+            ++calls;
+        }
+    }
+
+    size_t socket_watcher::drain()
+    {
+        size_t calls = 0;
+        for (short ready = pending(); poller::poll_none != ready; ready = pending())
+        {
+            callable_(ready);
+            ++calls;
+        }
+        return calls;
+    }
+
+#ifdef ZMQPP_HAVE_EPOLL
+    epoll_adapter::epoll_adapter() :
+    epoll_fd_(-1),
+    wakeup_(),
+    watchers_(),
+    ready_(),
+    serving_()
+    {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0)
+        {
+            throw exception("unable to create epoll descriptor");
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        if (0 != epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_.fd(), &event))
+        {
+            close(epoll_fd_);
+            throw exception("unable to watch wakeup descriptor");
+        }
+    }
+
+    epoll_adapter::~epoll_adapter()
+    {
+        close(epoll_fd_);
+    }
+
+    void epoll_adapter::add(socket_watcher& watcher)
+    {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLET;
+        event.data.ptr = &watcher;
+        if (0 != epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, watcher.fd(), &event))
+        {
+            throw exception("unable to watch socket descriptor");
+        }
+
+        watchers_.insert(&watcher);
+
+        // messages queued before now won't trigger the edge, so check it once
+        ready_.push_back(&watcher);
+        wakeup_.notify();
+    }
+
+    void epoll_adapter::remove(socket_watcher& watcher)
+    {
+        if (0 == watchers_.erase(&watcher))
+            return;
+
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, watcher.fd(), nullptr);
+        ready_.erase(std::remove(ready_.begin(), ready_.end(), &watcher), ready_.end());
+    }
+
+    size_t epoll_adapter::process()
+    {
+        wakeup_.consume();
+
+        serving_.clear();
+        serving_.swap(ready_);
+
+        epoll_event events[64];
+        int count = 0;
+        do
+        {
+            // retry epoll_wait when a signal interrupts it
+            while ((count = epoll_wait(epoll_fd_, events, 64, 0)) < 0)
+            {
+                if (EINTR != errno)
+                    throw exception("unable to wait on epoll descriptor");
+            }
+            for (int i = 0; i < count; ++i)
+            {
+                if (nullptr != events[i].data.ptr)
+                    serving_.push_back(static_cast<socket_watcher *> (events[i].data.ptr));
+            }
+        }
+        while (64 == count);
+
+        size_t served = 0;
+        size_t index = 0;
+        try
+        {
+            for (; index < serving_.size(); ++index)
+            {
+                // a handler may have removed a watcher that was signalled in the same batch
+                socket_watcher *watcher = serving_[index];
+                if (0 == watchers_.count(watcher))
+                    continue;
+
+                ++served;
+                if (watcher->on_readable())
+                    ready_.push_back(watcher);
+            }
+        }
+        catch (...)
+        {
+            // the edges for the rest were consumed already, keep them for the next call
+            ready_.insert(ready_.end(), serving_.begin() + index, serving_.end());
+            wakeup_.notify();
+            throw;
+        }
+
+        if (!ready_.empty())
+            wakeup_.notify();
+
+        return served;
+    }
+#endif
+
+}
@@ -0,0 +1,176 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <unordered_set>
+#include <vector>
+
+#include "compatibility.hpp"
+#include "inplace_function.hpp"
+#include "poller.hpp"
+
+#ifndef _WIN32
+#include "event_notifier.hpp"
+#endif
+
+namespace zmqpp
+{
+    class socket;
+    typedef socket socket_t;
+
+    /**
+     * Drives a zmq socket from an event loop that is not zmq aware.
+     *
+     * A zmq socket exposes a descriptor (ZMQ_FD) that can be put into epoll, kqueue
+     * or io_uring, but it is not a normal descriptor. It only signals that the
+     * socket's internal state may have changed, it is effectively edge triggered,
+     * and reading ZMQ_EVENTS, sending or receiving can all consume the signal.
+     * Waiting on the descriptor again while messages are still queued stalls the
+     * socket until the peer happens to send more.
+     *
+     * The watcher follows the only safe protocol: whenever the descriptor fires,
+     * call on_readable(), which calls the handler for as long as ZMQ_EVENTS
+     * reports the watched events. Only go back to waiting on the descriptor once it
+     * returns false. If it returns true the handler budget was spent while the
+     * socket is still ready, so call it again soon without waiting for the
+     * descriptor, which will not fire for that work.
+     *
+     * Anything done to the socket outside the handler, such as a send from
+     * elsewhere in the application, can swallow a wakeup too, so call
+     * on_readable() after it as well.
+     */
+    class socket_watcher
+    {
+    public:
+        /**
+         * Handler type, called with the currently ready events out of the watched ones.
+         */
+        typedef inplace_function<void (short const events)> Callable;
+
+        /**
+         * Watch a socket, the socket must outlive the watcher.
+         *
+         * \param socket the socket to watch.
+         * \param callable called while the socket has any of the watched events.
+         * \param events the events to watch, input by default.
+         * \param budget most handler calls per on_readable(), 0 for no limit.
+         */
+        ZMQPP_EXPORT socket_watcher(socket_t& socket, Callable callable, short const events = poller::poll_in, size_t const budget = 0);
+
+        /**
+         * \return the descriptor to register, read only, with an external loop.
+         */
+        raw_socket_t fd() const { return fd_; }
+
+        /**
+         * \return the watched socket.
+         */
+        socket_t& get_socket() { return socket_; }
+
+        /**
+         * Check ZMQ_EVENTS for the watched events. This never blocks.
+         *
+         * \return the ready events out of the watched ones.
+         */
+        ZMQPP_EXPORT short pending() const;
+
+        /**
+         * Call once the descriptor has fired, or after using the socket outside the
+         * handler. Calls the handler while the socket is ready, up to the budget.
+         *
+         * \return true if the budget ran out with the socket still ready, in which
+         * case on_readable() must be called again without waiting on the descriptor.
+         */
+        ZMQPP_EXPORT bool on_readable();
+
+        /**
+         * Call the handler until the socket has none of the watched events left,
+         * ignoring the budget.
+         *
+         * \return how many times the handler was called.
+         */
+        ZMQPP_EXPORT size_t drain();
+
+    private:
+        socket_t& socket_;
+        Callable callable_;
+        short events_;
+        size_t budget_;
+        raw_socket_t fd_;
+
+        // No copy - private and not implemented
+        socket_watcher(socket_watcher const&) ZMQPP_EXPLICITLY_DELETED;
+        socket_watcher& operator=(socket_watcher const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+
+#ifdef ZMQPP_HAVE_EPOLL
+    /**
+     * Bridges a set of socket watchers into an existing epoll based loop.
+     *
+     * The adapter keeps its own epoll set holding the watchers' descriptors in edge
+     * triggered mode, and exposes it as one descriptor to add to the application's
+     * epoll set as a level triggered input. Whenever that descriptor is readable
+     * call process().
+     *
+     * Watchers that still have work when their budget runs out are kept on a ready
+     * list and the adapter's descriptor is held readable until they are served, so
+     * the application loop never has to manage timeouts for them.
+     */
+    class epoll_adapter
+    {
+    public:
+        /**
+         * Create the inner epoll set, throws zmqpp::exception on failure.
+         */
+        ZMQPP_EXPORT epoll_adapter();
+
+        ZMQPP_EXPORT ~epoll_adapter();
+
+        /**
+         * \return the descriptor to add to the application's epoll set with EPOLLIN.
+         */
+        int fd() const { return epoll_fd_; }
+
+        /**
+         * Start serving a watcher, it is checked on the next process() as its socket
+         * may already be ready. The watcher must stay alive until removed.
+         *
+         * \param watcher the watcher to add.
+         */
+        ZMQPP_EXPORT void add(socket_watcher& watcher);
+
+        /**
+         * Stop serving a watcher, safe to call from a handler.
+         *
+         * \param watcher the watcher to remove.
+         */
+        ZMQPP_EXPORT void remove(socket_watcher& watcher);
+
+        /**
+         * Serve every watcher that was signalled or left ready, never blocks.
+         *
+         * \return the number of watchers served.
+         */
+        ZMQPP_EXPORT size_t process();
+
+    private:
+        int epoll_fd_;
+        event_notifier wakeup_;
+        std::unordered_set<socket_watcher *> watchers_;
+        std::vector<socket_watcher *> ready_;
+        std::vector<socket_watcher *> serving_;
+
+        // No copy - private and not implemented
+        epoll_adapter(epoll_adapter const&) ZMQPP_EXPLICITLY_DELETED;
+        epoll_adapter& operator=(epoll_adapter const&) NOEXCEPT ZMQPP_EXPLICITLY_DELETED;
+    };
+#endif
+
+}
@@ -0,0 +1,158 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include "context.hpp"
+#include "exception.hpp"
+#include "thread_placement.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace zmqpp
+{
+
+#if defined(__linux__)
+    namespace
+    {
+        // from linux/mempolicy.h, which is not always installed
+        int const mpol_preferred = 1;
+    }
+#endif
+
+    thread_placement::thread_placement() :
+    cpus_(),
+    numa_node_(-1),
+    name_()
+    {
+    }
+
+    thread_placement& thread_placement::add_cpu(unsigned int const cpu)
+    {
+        cpus_.push_back(cpu);
+        return *this;
+    }
+
+    thread_placement& thread_placement::add_cpus(unsigned int const first, unsigned int const last)
+    {
+        for (unsigned int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus_.push_back(cpu);
+        }
+        return *this;
+    }
+
+    thread_placement& thread_placement::set_numa_node(int const node)
+    {
+        numa_node_ = node;
+        return *this;
+    }
+
+    thread_placement& thread_placement::set_name(std::string const& name)
+    {
+        name_ = name;
+        return *this;
+    }
+
+    void thread_placement::apply() const
+    {
+#if defined(__linux__)
+        if (!cpus_.empty())
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (unsigned int const cpu : cpus_)
+            {
+                if (cpu >= CPU_SETSIZE)
+                {
+                    throw exception("thread placement cpu index out of range");
+                }
+                CPU_SET(cpu, &set);
+            }
+
+            if (0 != pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+            {
+                throw exception("unable to set thread cpu affinity");
+            }
+        }
+
+        if (numa_node_ >= 0)
+        {
+            unsigned long const bits = sizeof(unsigned long) * 8;
+            if (static_cast<unsigned long>(numa_node_) >= bits)
+            {
+                throw exception("thread placement numa node out of range");
+            }
+
+            // the kernel reads one bit fewer than maxnode, so this covers the whole mask
+            unsigned long const nodes = 1UL << numa_node_;
+            if (0 != syscall(SYS_set_mempolicy, mpol_preferred, &nodes, bits + 1))
+            {
+                throw exception("unable to set thread numa memory policy");
+            }
+        }
+
+        if (!name_.empty())
+        {
+            // the kernel limit is 16 bytes including the terminator
+            pthread_setname_np(pthread_self(), name_.substr(0, 15).c_str());
+        }
+#endif
+    }
+
+    void thread_placement::apply(context& ctx) const
+    {
+#if (ZMQ_VERSION_MAJOR > 4) || ((ZMQ_VERSION_MAJOR == 4) && (ZMQ_VERSION_MINOR >= 3))
+        for (unsigned int const cpu : cpus_)
+        {
+            ctx.set(context_option::thread_affinity_cpu_add, static_cast<int>(cpu));
+        }
+#else
+        if (!cpus_.empty())
+        {
+            throw exception("placing context I/O threads needs zmq 4.3 or later");
+        }
+        (void) ctx;
+#endif
+    }
+
+    thread_topology::thread_topology() :
+    io_threads_(),
+    actors_(),
+    shards_()
+    {
+    }
+
+    thread_topology& thread_topology::set_io_threads(thread_placement const& placement)
+    {
+        io_threads_ = placement;
+        return *this;
+    }
+
+    thread_topology& thread_topology::set_actors(thread_placement const& placement)
+    {
+        actors_ = placement;
+        return *this;
+    }
+
+    thread_topology& thread_topology::add_shard(thread_placement const& placement)
+    {
+        shards_.push_back(placement);
+        return *this;
+    }
+
+    void thread_topology::apply(context& ctx) const
+    {
+        io_threads_.apply(ctx);
+    }
+
+}
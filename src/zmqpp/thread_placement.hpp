@@ -0,0 +1,176 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "compatibility.hpp"
+
+namespace zmqpp
+{
+    class context;
+
+    /**
+     * Where a thread should run: the cpus it may be scheduled on, the numa node
+     * its memory should preferably come from and the name it shows up under.
+     *
+     * A placement can be given to a context for its I/O threads, to actors, to
+     * the shards of a loop_group, or applied by a thread before it starts a
+     * loop. A thread_topology groups them so a pipeline is described once.
+     *
+     * Placement is only applied on linux, elsewhere apply() does nothing.
+     */
+    class thread_placement
+    {
+    public:
+        /**
+         * A placement that leaves threads where the system puts them.
+         */
+        ZMQPP_EXPORT thread_placement();
+
+        /**
+         * Allow a cpu, threads are limited to the allowed cpus once any is added.
+         *
+         * \param cpu index of the cpu.
+         * \return this placement, to chain calls.
+         */
+        ZMQPP_EXPORT thread_placement& add_cpu(unsigned int const cpu);
+
+        /**
+         * Allow a range of cpus, such as all the cores of one socket.
+         *
+         * \param first index of the first cpu.
+         * \param last index of the last cpu, included.
+         * \return this placement, to chain calls.
+         */
+        ZMQPP_EXPORT thread_placement& add_cpus(unsigned int const first, unsigned int const last);
+
+        /**
+         * Prefer memory from a numa node for allocations made by the thread.
+         *
+         * \param node index of the node, -1 to leave the memory policy alone.
+         * \return this placement, to chain calls.
+         */
+        ZMQPP_EXPORT thread_placement& set_numa_node(int const node);
+
+        /**
+         * Name the thread, linux keeps at most the first 15 characters.
+         *
+         * \param name the thread name, empty to keep the current one.
+         * \return this placement, to chain calls.
+         */
+        ZMQPP_EXPORT thread_placement& set_name(std::string const& name);
+
+        /**
+         * \return the allowed cpus, empty if any cpu may be used.
+         */
+        std::vector<unsigned int> const& get_cpus() const { return cpus_; }
+
+        /**
+         * \return the preferred numa node, -1 if none.
+         */
+        int get_numa_node() const { return numa_node_; }
+
+        /**
+         * \return the thread name, empty if unchanged.
+         */
+        std::string const& get_name() const { return name_; }
+
+        /**
+         * Apply the placement to the calling thread.
+         *
+         * Throws zmqpp::exception if the cpus or numa node are not usable.
+         */
+        ZMQPP_EXPORT void apply() const;
+
+        /**
+         * Limit a context's I/O threads to the allowed cpus, which needs zmq 4.3
+         * or later. Call it before the context's first socket is created as that
+         * is when the I/O threads start.
+         *
+         * Throws zmqpp::exception if the zmq version can't place I/O threads.
+         *
+         * \param ctx the context to configure.
+         */
+        ZMQPP_EXPORT void apply(context& ctx) const;
+
+    private:
+        std::vector<unsigned int> cpus_;
+        int numa_node_;
+        std::string name_;
+    };
+
+    /**
+     * Where each kind of thread of a pipeline runs: the context's I/O threads,
+     * its actors and the shards of its loop_group, such as all on the cores of
+     * one socket.
+     *
+     * Declare it once, then apply it to the context, start the loop_group from
+     * it and start actors with get_actors().
+     */
+    class thread_topology
+    {
+    public:
+        /**
+         * A topology that leaves every thread where the system puts it, with no
+         * shards.
+         */
+        ZMQPP_EXPORT thread_topology();
+
+        /**
+         * \param placement where the context's I/O threads run.
+         * \return this topology, to chain calls.
+         */
+        ZMQPP_EXPORT thread_topology& set_io_threads(thread_placement const& placement);
+
+        /**
+         * \param placement where actors run.
+         * \return this topology, to chain calls.
+         */
+        ZMQPP_EXPORT thread_topology& set_actors(thread_placement const& placement);
+
+        /**
+         * Add a loop_group shard.
+         *
+         * \param placement where the shard runs.
+         * \return this topology, to chain calls.
+         */
+        ZMQPP_EXPORT thread_topology& add_shard(thread_placement const& placement);
+
+        /**
+         * \return where the context's I/O threads run.
+         */
+        thread_placement const& get_io_threads() const { return io_threads_; }
+
+        /**
+         * \return where actors run.
+         */
+        thread_placement const& get_actors() const { return actors_; }
+
+        /**
+         * \return where each loop_group shard runs.
+         */
+        std::vector<thread_placement> const& get_shards() const { return shards_; }
+
+        /**
+         * Place a context's I/O threads, see thread_placement::apply(context&).
+         *
+         * \param ctx the context to configure.
+         */
+        ZMQPP_EXPORT void apply(context& ctx) const;
+
+    private:
+        thread_placement io_threads_;
+        thread_placement actors_;
+        std::vector<thread_placement> shards_;
+    };
+
+}
@@ -0,0 +1,211 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#include <cstring>
+#include <random>
+
+#include "zap_cache.hpp"
+#include "zap_request.hpp"
+
+#if (ZMQ_VERSION_MAJOR > 3)
+
+namespace zmqpp
+{
+
+    namespace
+    {
+        uint64_t rotate(uint64_t const value, int const bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        // SipHash-2-4 with a 128 bit output, fed a piece at a time
+        class siphash
+        {
+        public:
+            siphash(uint64_t const* const seed) :
+            v0_(0x736f6d6570736575ULL ^ seed[0]),
+            v1_(0x646f72616e646f6dULL ^ seed[1] ^ 0xee),
+            v2_(0x6c7967656e657261ULL ^ seed[0]),
+            v3_(0x7465646279746573ULL ^ seed[1]),
+            tail_(0),
+            length_(0)
+            {
+            }
+
+            // pieces are length prefixed, so no two requests feed the same bytes
+            void add(void const* const data, size_t const size)
+            {
+                uint64_t const prefix = size;
+                add_bytes(&prefix, sizeof(prefix));
+                add_bytes(data, size);
+            }
+
+            void add(std::string const& text)
+            {
+                add(text.data(), text.size());
+            }
+
+            zap_cache::key_t finish()
+            {
+                compress(tail_ | (static_cast<uint64_t>(length_) << 56));
+
+                v2_ ^= 0xee;
+                for (int i = 0; i < 4; ++i)
+                    round();
+                zap_cache::key_t key;
+                key.high = v0_ ^ v1_ ^ v2_ ^ v3_;
+
+                v1_ ^= 0xdd;
+                for (int i = 0; i < 4; ++i)
+                    round();
+                key.low = v0_ ^ v1_ ^ v2_ ^ v3_;
+                return key;
+            }
+
+        private:
+            uint64_t v0_, v1_, v2_, v3_;
+            uint64_t tail_;
+            size_t length_;
+
+            void round()
+            {
+                v0_ += v1_; v1_ = rotate(v1_, 13); v1_ ^= v0_; v0_ = rotate(v0_, 32);
+                v2_ += v3_; v3_ = rotate(v3_, 16); v3_ ^= v2_;
+                v0_ += v3_; v3_ = rotate(v3_, 21); v3_ ^= v0_;
+                v2_ += v1_; v1_ = rotate(v1_, 17); v1_ ^= v2_; v2_ = rotate(v2_, 32);
+            }
+
+            void compress(uint64_t const word)
+            {
+                v3_ ^= word;
+                round();
+                round();
+                v0_ ^= word;
+            }
+
+            // little endian words, as the reference takes them
+            void add_bytes(void const* const data, size_t size)
+            {
+                uint8_t const* bytes = static_cast<uint8_t const*>(data);
+                for (; size > 0 && 0 != (length_ & 7); --size, ++length_)
+                {
+                    tail_ |= static_cast<uint64_t>(*bytes++) << (8 * (length_ & 7));
+                    if (7 == (length_ & 7))
+                    {
+                        compress(tail_);
+                        tail_ = 0;
+                    }
+                }
+
+                for (; size >= 8; size -= 8, bytes += 8, length_ += 8)
+                {
+                    uint64_t word = 0;
+                    for (int i = 7; i >= 0; --i)
+                        word = (word << 8) | bytes[i];
+                    compress(word);
+                }
+
+                for (; size > 0; --size, ++length_)
+                    tail_ |= static_cast<uint64_t>(*bytes++) << (8 * (length_ & 7));
+            }
+        };
+    }
+
+    size_t const zap_cache::ways;
+
+    zap_cache::zap_cache(size_t const entries, clock::duration const ttl) :
+    entries_(),
+    ttl_(ttl),
+    seed_()
+    {
+        size_t capacity = ways;
+        while (capacity * 2 <= entries)
+            capacity *= 2;
+        entries_.resize(capacity);
+        clear();
+
+        std::random_device random;
+        for (uint64_t& seed : seed_)
+            seed = (static_cast<uint64_t>(random()) << 32) ^ random();
+    }
+
+    zap_cache::key_t zap_cache::digest(zap_request const& request) const
+    {
+        siphash hash(seed_);
+        hash.add(request.get_mechanism());
+        hash.add(request.get_domain());
+        hash.add(request.get_address());
+
+        std::string const& mechanism = request.get_mechanism();
+        if ("PLAIN" == mechanism)
+        {
+            hash.add(request.get_username());
+            hash.add(request.get_password());
+        }
+        else if ("CURVE" == mechanism)
+        {
+            void const* const client_key = request.get_client_key_data();
+            hash.add(client_key, (nullptr != client_key) ? 32 : 0);
+        }
+        else if ("GSSAPI" == mechanism)
+        {
+            hash.add(request.get_principal());
+        }
+        return hash.finish();
+    }
+
+    zap_cache::decision_t const* zap_cache::find(key_t const& key, clock::time_point const now) const
+    {
+        size_t const first = first_of_set(key);
+        for (size_t i = first; i < first + ways; ++i)
+        {
+            entry_t const& entry = entries_[i];
+            if (entry.used && entry.key.low == key.low && entry.key.high == key.high)
+                return (now < entry.expires) ? &entry.decision : nullptr;
+        }
+        return nullptr;
+    }
+
+    void zap_cache::insert(key_t const& key, clock::time_point const now, bool const allowed, std::string const& user_id)
+    {
+        // the same key, a free slot, or else the one that expires first
+        size_t const first = first_of_set(key);
+        entry_t* replaced = &entries_[first];
+        for (size_t i = first; i < first + ways; ++i)
+        {
+            entry_t& entry = entries_[i];
+            if (!entry.used || (entry.key.low == key.low && entry.key.high == key.high))
+            {
+                replaced = &entry;
+                break;
+            }
+            if (entry.expires < replaced->expires)
+                replaced = &entry;
+        }
+
+        replaced->key = key;
+        replaced->expires = now + ttl_;
+        replaced->used = true;
+        replaced->decision.allowed = allowed;
+        replaced->decision.user_id = user_id;
+    }
+
+    void zap_cache::clear()
+    {
+        for (entry_t& entry : entries_)
+        {
+            entry.used = false;
+            entry.decision.user_id.clear();
+        }
+    }
+
+}
+
+#endif
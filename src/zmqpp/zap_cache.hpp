@@ -0,0 +1,124 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * This file is part of zmqpp.
+ * Copyright (c) 2011-2015 Contributors as noted in the AUTHORS file.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <zmq.h>
+#include "compatibility.hpp"
+
+// Authentication is something from zmq 4
+#if (ZMQ_VERSION_MAJOR > 3)
+
+namespace zmqpp
+{
+    class zap_request;
+
+    /**
+     * Recent ZAP decisions, so a client connecting again is answered without
+     * going through the policy.
+     *
+     * A decision is keyed by a digest of the request's mechanism, domain,
+     * address and credentials. The digest is a 128 bit SipHash, keyed at
+     * random per cache, so neither passwords nor keys are kept and clients
+     * can't make their requests collide.
+     *
+     * Decisions sit in sets of four in a table sized once, a new one replaces
+     * the oldest of its set. Each lasts for a fixed time and the cache must
+     * be cleared when the policy changes.
+     *
+     * A cache isn't thread safe, auth keeps one per worker.
+     */
+    class zap_cache
+    {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        /**
+         * The digest of a request.
+         */
+        struct key_t
+        {
+            uint64_t high;
+            uint64_t low;
+        };
+
+        /**
+         * A cached answer.
+         */
+        struct decision_t
+        {
+            bool allowed;           //!< 200 or 400
+            std::string user_id;    //!< the User-Id to reply with when allowed
+        };
+
+        /**
+         * \param entries the most decisions kept, rounded down to a power of
+         *        two and at least four.
+         * \param ttl how long a decision is kept.
+         */
+        ZMQPP_EXPORT zap_cache(size_t const entries, clock::duration const ttl);
+
+        /**
+         * \return the digest keying the request's decision.
+         */
+        ZMQPP_EXPORT key_t digest(zap_request const& request) const;
+
+        /**
+         * \param key the request's digest.
+         * \param now the current time.
+         * \return the decision, or null if none was made or it expired.
+         */
+        ZMQPP_EXPORT decision_t const* find(key_t const& key, clock::time_point const now) const;
+
+        /**
+         * Keep a decision until now + ttl.
+         */
+        ZMQPP_EXPORT void insert(key_t const& key, clock::time_point const now, bool const allowed, std::string const& user_id);
+
+        /**
+         * Forget every decision.
+         */
+        ZMQPP_EXPORT void clear();
+
+        /**
+         * \return the most decisions kept.
+         */
+        size_t capacity() const { return entries_.size(); }
+
+        /**
+         * \return how long a decision is kept.
+         */
+        clock::duration ttl() const { return ttl_; }
+
+    private:
+        static size_t const ways = 4;
+
+        struct entry_t
+        {
+            key_t key;
+            clock::time_point expires;
+            bool used;
+            decision_t decision;
+        };
+
+        std::vector<entry_t> entries_;
+        clock::duration ttl_;
+        uint64_t seed_[2];
+
+        size_t first_of_set(key_t const& key) const { return static_cast<size_t>(key.low) & (entries_.size() - ways); }
+    };
+
+}
+
+#endif
@@ -21,7 +21,7 @@
 #include "byte_ordering.hpp"
 #include <unordered_map>
 #include <iterator>
-
+
 #ifndef _WIN32
 #include <netinet/in.h>
 #endif
@@ -36,35 +36,44 @@ namespace zmqpp
  */
 zap_request::zap_request(socket& handler, bool logging) :
   zap_socket(handler),
-  verbose(logging)
+  verbose(logging),
+  request(),
+  envelope(0)
 {
-    message msg;
+    message& msg = request;
     zap_socket.receive(msg);
 
-    if(0 == msg.parts())
+    // a dealer doesn't strip the envelope as a reply socket does
+    if (socket_type::dealer == zap_socket.type()) {
+        while (envelope < msg.parts() && 0 != msg.size(envelope))
+            ++envelope;
+        envelope = (envelope < msg.parts()) ? envelope + 1 : 0;
+    }
+
+    if(msg.parts() <= envelope)
         return;     // Interrupted
 
     // Get all standard frames off the handler socket
-    version   = msg.get(0);
-    sequence  = msg.get(1);
-    domain    = msg.get(2);
-    address   = msg.get(3);
-    identity  = msg.get(4);
-    mechanism = msg.get(5); 
+    version   = msg.get(envelope + 0);
+    sequence  = msg.get(envelope + 1);
+    domain    = msg.get(envelope + 2);
+    address   = msg.get(envelope + 3);
+    identity  = msg.get(envelope + 4);
+    mechanism = msg.get(envelope + 5); 
 
     // If the version is wrong, we're linked with a bogus libzmq, so die
     assert(version == "1.0");
 
     // Get mechanism-specific frames
     if("PLAIN" == mechanism) {
-        username = msg.get(6); 
-        password = msg.get(7);             
+        username = msg.get(envelope + 6); 
+        password = msg.get(envelope + 7);             
 
     } else if("CURVE" == mechanism) {
-        client_key = z85::encode(msg.get(6)); 
+        // the key is only encoded when asked for, checks use it in binary
 
     } else if("GSSAPI" == mechanism) {
-        principal = msg.get(6);
+        principal = msg.get(envelope + 6);
     }
 
     if (verbose) {
@@ -73,6 +82,24 @@ zap_request::zap_request(socket& handler, bool logging) :
     }
 }
 
+const std::string & zap_request::get_client_key() const
+{
+    const void * const data = get_client_key_data();
+    if (client_key.empty() && (nullptr != data)) {
+        client_key = z85::encode(static_cast<const uint8_t *>(data), request.size(envelope + 6));
+    }
+    return client_key;
+}
+
+const void * zap_request::get_client_key_data() const
+{
+    // a CURVE key frame is always 32 bytes
+    if (("CURVE" != mechanism) || (request.parts() < envelope + 7) || (32 != request.size(envelope + 6))) {
+        return nullptr;
+    }
+    return request.raw_data(envelope + 6);
+}
+
 /*! 
  * Send a ZAP reply to the handler socket
  */
@@ -87,6 +114,8 @@ void zap_request::reply(const std::string &status_code, const std::string &statu
     }
 
     message reply;
+    for (size_t i = 0; i < envelope; ++i)
+        reply.push_back(request.raw_data(i), request.size(i));
     reply.push_back(version);
     reply.push_back(sequence);
     reply.push_back(status_code);
@@ -18,6 +18,7 @@
 #define ZMQPP_ZAP_REQUEST_HPP_
 
 #include <string>
+#include "message.hpp"
 #include "socket.hpp"
 #include <unordered_map>
 #include <vector>
@@ -36,6 +37,10 @@ class ZMQPP_EXPORT zap_request {
 public:
     /**
      * Receive a ZAP valid request from the handler socket
+     *
+     * A dealer handler gets the request behind the routing envelope of the
+     * router it came through, up to an empty delimiter frame. The envelope is
+     * sent back ahead of the reply.
      */
     zap_request(socket& handler, bool logging);
     
@@ -104,11 +109,17 @@ public:
 
     /*! 
      * Get client_key for CURVE security mechanism.
-     * The key is z85 encoded.
+     * The key is z85 encoded, which is only done the first time it is asked for.
      */
-    const std::string & get_client_key() const {
-        return client_key;
-    }
+    const std::string & get_client_key() const;
+
+    /*!
+     * Get the 32 binary bytes of the client key for CURVE security mechanism,
+     * straight from the request.
+     *
+     * @return the key, or null if this isn't a CURVE request.
+     */
+    const void * get_client_key_data() const;
 
     /** 
      * Get principal for GSSAPI security mechanism
@@ -127,9 +138,11 @@ private:
     std::string     mechanism;      //!< Security mechansim
     std::string     username;       //!< PLAIN user name
     std::string     password;       //!< PLAIN password, in clear text
-    std::string     client_key;     //!< CURVE client public key in ASCII
+    mutable std::string client_key; //!< CURVE client public key in ASCII, once asked for
     std::string     principal;      //!< GSSAPI client principal
     bool            verbose;        //!< Log ZAP requests and replies?
+    message         request;        //!< The request, CURVE keys are read from it
+    size_t          envelope;       //!< Routing frames ahead of the request, from a dealer
 
     // No copy - private and not implemented
     zap_request(zap_request const&) ZMQPP_EXPLICITLY_DELETED;
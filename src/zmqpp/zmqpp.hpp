@@ -64,9 +64,15 @@
 #include "message.hpp"
 #include "poller.hpp"
 #include "socket.hpp"
+#include "thread_placement.hpp"
 #include "actor.hpp"
+#include "actor_executor.hpp"
+#include "actor_mailbox.hpp"
 #include "reactor.hpp"
 #include "loop.hpp"
+#include "loop_group.hpp"
+#include "coroutine.hpp"
+#include "socket_watcher.hpp"
 #include "zap_request.hpp"
 #include "auth.hpp"
 